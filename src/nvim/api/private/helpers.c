@@ -215,6 +215,8 @@ Object dict_set_var(dict_T *dict, String key, Object value, bool del,
     }
   }
 
+  stl_expr_invalidate();
+
   if (del) {
     // Delete the key
     if (di == NULL) {
@@ -994,6 +996,9 @@ static void init_ui_event_metadata(Dictionary *metadata)
   for (UIExtension i = 0; i < kUIExtCount; i++) {
     ADD(ui_options, STRING_OBJ(cstr_to_string(ui_ext_names[i])));
   }
+  ADD(ui_options, STRING_OBJ(cstr_to_string("packed_lines")));
+  ADD(ui_options, STRING_OBJ(cstr_to_string("max_fps")));
+  ADD(ui_options, STRING_OBJ(cstr_to_string("shm_grid")));
   PUT(*metadata, "ui_options", ARRAY_OBJ(ui_options));
 }
 
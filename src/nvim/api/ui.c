@@ -6,23 +6,65 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
 #include "nvim/vim.h"
 #include "nvim/ui.h"
 #include "nvim/memory.h"
 #include "nvim/map.h"
 #include "nvim/msgpack_rpc/channel.h"
+#include "nvim/msgpack_rpc/helpers.h"
 #include "nvim/api/ui.h"
 #include "nvim/api/private/defs.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/popupmnu.h"
 #include "nvim/cursor_shape.h"
 #include "nvim/highlight.h"
+#include "nvim/event/time.h"
+#include "nvim/main.h"
+#include "nvim/os/time.h"
+#include "nvim/os/os.h"
+#include "nvim/assert.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "api/ui.c.generated.h"
 # include "ui_events_remote.generated.h"
 #endif
 
+// Layout of the grid shared with the client by the shm_grid option, see
+// |ui-shm-grid|. Native byte order.
+#define SHM_GRID_MAGIC 0x4753564e  // "NVSG"
+#define SHM_GRID_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t cell_size;
+  uint32_t seq;  ///< odd while Nvim updates the cells
+  uint32_t reserved[2];
+} ShmGridHeader;
+
+typedef struct {
+  char text[30];  ///< NUL-terminated UTF-8
+  uint16_t hl_id;
+} ShmGridCell;
+
+STATIC_ASSERT(sizeof(schar_T) <= sizeof(((ShmGridCell *)0)->text),
+              "schar_T must fit in ShmGridCell");
+
+/// Copy of the grid as last sent to a client, used by the max_fps option.
+/// Rows touched since the last frame are tracked as dirty column ranges.
+typedef struct {
+  Integer handle;
+  int width, height;
+  schar_T *chars;
+  sattr_T *attrs;
+  int *dirty_start, *dirty_end;  ///< per row, empty if start >= end
+} UIShadowGrid;
+
 typedef struct {
   uint64_t channel_id;
   Array buffer;
@@ -32,6 +74,31 @@ typedef struct {
 
   // Position of legacy cursor, used both for drawing and visible user cursor.
   Integer client_row, client_col;
+
+  // "packed_lines" option: grid_line cells are sent as a single msgpack bin.
+  bool packed_lines;
+  msgpack_sbuffer sbuffer;  // scratch buffer for packed_lines
+
+  // "max_fps" option: frames are sent at most every `frame_interval` ns.
+  // Grid updates of held back frames are merged into `shadow`.
+  uint64_t frame_interval;  // 0: send every flush
+  uint64_t last_frame;      // os_hrtime() when the last frame was sent
+  TimeWatcher *frame_timer;  // NULL if not started
+  bool frame_scheduled;      // frame_timer is running
+  UIShadowGrid shadow;
+  bool cursor_pending;
+  Integer cursor_grid;
+
+  // "shm_grid" option: grid cells are written to a mapping shared with the
+  // client, and only the changed rectangles are sent.
+  bool shm_grid;
+  void *shm;  // NULL until the first grid_resize
+  size_t shm_size;
+  char *shm_path;
+  Integer shm_handle;
+  int shm_width, shm_height;
+  bool shm_writing;  // header seq is odd
+  int dirty_top, dirty_bot, dirty_left, dirty_right;  // pending, exclusive
 } UIData;
 
 static PMap(uint64_t) *connected_uis = NULL;
@@ -51,6 +118,14 @@ void remote_ui_disconnect(uint64_t channel_id)
   }
   UIData *data = ui->data;
   api_free_array(data->buffer);  // Destroy pending screen updates.
+  msgpack_sbuffer_destroy(&data->sbuffer);
+  if (data->frame_timer) {
+    data->frame_timer->data = NULL;
+    time_watcher_stop(data->frame_timer);
+    time_watcher_close(data->frame_timer, frame_timer_close_cb);
+  }
+  shadow_free(&data->shadow);
+  os_shm_destroy(data->shm, data->shm_size, data->shm_path);
   pmap_del(uint64_t)(connected_uis, channel_id);
   xfree(ui->data);
   ui->data = NULL;  // Flag UI as "stopped".
@@ -103,9 +178,30 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height,
 
   memset(ui->ui_ext, 0, sizeof(ui->ui_ext));
 
+  UIData *data = xmalloc(sizeof(UIData));
+  data->channel_id = channel_id;
+  data->buffer = (Array)ARRAY_DICT_INIT;
+  data->hl_id = 0;
+  data->client_col = -1;
+  data->packed_lines = false;
+  data->frame_interval = 0;
+  data->last_frame = 0;
+  data->frame_timer = NULL;
+  data->frame_scheduled = false;
+  memset(&data->shadow, 0, sizeof(data->shadow));
+  data->cursor_pending = false;
+  data->shm_grid = false;
+  data->shm = NULL;
+  data->shm_size = 0;
+  data->shm_path = NULL;
+  data->shm_writing = false;
+  data->dirty_top = data->dirty_bot = 0;
+  ui->data = data;
+
   for (size_t i = 0; i < options.size; i++) {
     ui_set_option(ui, true, options.items[i].key, options.items[i].value, err);
     if (ERROR_SET(err)) {
+      xfree(data);
       xfree(ui);
       return;
     }
@@ -114,13 +210,16 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height,
   if (ui->ui_ext[kUIHlState]) {
     ui->ui_ext[kUINewgrid] = true;
   }
+  if (!ui->ui_ext[kUINewgrid]) {
+    // pacing and shared grids are only supported by newgrid events
+    data->frame_interval = 0;
+    data->shm_grid = false;
+  }
+  if (data->shm_grid) {
+    data->frame_interval = 0;
+  }
 
-  UIData *data = xmalloc(sizeof(UIData));
-  data->channel_id = channel_id;
-  data->buffer = (Array)ARRAY_DICT_INIT;
-  data->hl_id = 0;
-  data->client_col = -1;
-  ui->data = data;
+  msgpack_sbuffer_init(&data->sbuffer);
 
   pmap_put(uint64_t)(connected_uis, channel_id, ui);
   ui_attach_impl(ui);
@@ -200,6 +299,51 @@ static void ui_set_option(UI *ui, bool init, String name, Object value,
     return;
   }
 
+  if (strequal(name.data, "packed_lines")) {
+    if (value.type != kObjectTypeBoolean) {
+      api_set_error(error, kErrorTypeValidation,
+                    "packed_lines must be a Boolean");
+      return;
+    }
+    if (!init) {
+      api_set_error(error, kErrorTypeValidation,
+                    "packed_lines option cannot be changed");
+      return;
+    }
+    ((UIData *)ui->data)->packed_lines = value.data.boolean;
+    return;
+  }
+
+  if (strequal(name.data, "shm_grid")) {
+    if (value.type != kObjectTypeBoolean) {
+      api_set_error(error, kErrorTypeValidation, "shm_grid must be a Boolean");
+      return;
+    }
+    if (!init) {
+      api_set_error(error, kErrorTypeValidation,
+                    "shm_grid option cannot be changed");
+      return;
+    }
+    ((UIData *)ui->data)->shm_grid = value.data.boolean;
+    return;
+  }
+
+  if (strequal(name.data, "max_fps")) {
+    if (value.type != kObjectTypeInteger || value.data.integer < 0) {
+      api_set_error(error, kErrorTypeValidation,
+                    "max_fps must be a non-negative Integer");
+      return;
+    }
+    if (!init) {
+      api_set_error(error, kErrorTypeValidation,
+                    "max_fps option cannot be changed");
+      return;
+    }
+    ((UIData *)ui->data)->frame_interval = value.data.integer
+        ? 1000000000 / (uint64_t)value.data.integer : 0;
+    return;
+  }
+
   // LEGACY: Deprecated option, use `ext_cmdline` instead.
   bool is_popupmenu = strequal(name.data, "popupmenu_external");
 
@@ -252,10 +396,19 @@ static void push_call(UI *ui, const char *name, Array args)
 
   ADD(call, ARRAY_OBJ(args));
   kv_A(data->buffer, kv_size(data->buffer) - 1).data.array = call;
+  g_stats.ui_events++;
 }
 
 static void remote_ui_grid_clear(UI *ui, Integer grid)
 {
+  UIData *data = ui->data;
+  if (data->shm && grid == data->shm_handle) {
+    shm_clear(ui, 0, data->shm_height, 0, data->shm_width);
+    return;
+  }
+  if (data->frame_interval) {
+    shadow_clear(&data->shadow);
+  }
   Array args = ARRAY_DICT_INIT;
   if (ui->ui_ext[kUINewgrid]) {
     ADD(args, INTEGER_OBJ(grid));
@@ -267,6 +420,10 @@ static void remote_ui_grid_clear(UI *ui, Integer grid)
 static void remote_ui_grid_resize(UI *ui, Integer grid,
                                   Integer width, Integer height)
 {
+  UIData *data = ui->data;
+  if (data->frame_interval) {
+    shadow_resize(&data->shadow, grid, (int)width, (int)height);
+  }
   Array args = ARRAY_DICT_INIT;
   if (ui->ui_ext[kUINewgrid]) {
     ADD(args, INTEGER_OBJ(grid));
@@ -275,6 +432,13 @@ static void remote_ui_grid_resize(UI *ui, Integer grid,
   ADD(args, INTEGER_OBJ(height));
   const char *name = ui->ui_ext[kUINewgrid] ? "grid_resize" : "resize";
   push_call(ui, name, args);
+
+  if (data->shm_grid && shm_resize(ui, grid, (int)width, (int)height)) {
+    args = (Array)ARRAY_DICT_INIT;
+    ADD(args, INTEGER_OBJ(grid));
+    ADD(args, STRING_OBJ(cstr_to_string(data->shm_path)));
+    push_call(ui, "grid_shm", args);
+  }
 }
 
 static void remote_ui_grid_scroll(UI *ui, Integer grid, Integer top,
@@ -282,6 +446,15 @@ static void remote_ui_grid_scroll(UI *ui, Integer grid, Integer top,
                                   Integer rows, Integer cols)
 {
   if (ui->ui_ext[kUINewgrid]) {
+    UIData *data = ui->data;
+    if (data->shm && grid == data->shm_handle) {
+      shm_scroll(ui, (int)top, (int)bot, (int)left, (int)right, (int)rows);
+      return;
+    }
+    if (data->frame_interval) {
+      shadow_scroll(&data->shadow, (int)top, (int)bot, (int)left, (int)right,
+                    (int)rows);
+    }
     Array args = ARRAY_DICT_INIT;
     ADD(args, INTEGER_OBJ(grid));
     ADD(args, INTEGER_OBJ(top));
@@ -383,14 +556,20 @@ static void remote_ui_highlight_set(UI *ui, int id)
 static void remote_ui_grid_cursor_goto(UI *ui, Integer grid, Integer row,
                                        Integer col)
 {
-  if (ui->ui_ext[kUINewgrid]) {
+  UIData *data = ui->data;
+  if (ui->ui_ext[kUINewgrid] && data->frame_interval) {
+    // Superseded by later positions, sent with the frame.
+    data->cursor_pending = true;
+    data->cursor_grid = grid;
+    data->cursor_row = row;
+    data->cursor_col = col;
+  } else if (ui->ui_ext[kUINewgrid]) {
     Array args = ARRAY_DICT_INIT;
     ADD(args, INTEGER_OBJ(grid));
     ADD(args, INTEGER_OBJ(row));
     ADD(args, INTEGER_OBJ(col));
     push_call(ui, "grid_cursor_goto", args);
   } else {
-    UIData *data = ui->data;
     data->cursor_row = row;
     data->cursor_col = col;
     remote_ui_cursor_goto(ui, row, col);
@@ -427,42 +606,18 @@ static void remote_ui_raw_line(UI *ui, Integer grid, Integer row,
                                const schar_T *chunk, const sattr_T *attrs)
 {
   UIData *data = ui->data;
-  if (ui->ui_ext[kUINewgrid]) {
-    Array args = ARRAY_DICT_INIT;
-    ADD(args, INTEGER_OBJ(grid));
-    ADD(args, INTEGER_OBJ(row));
-    ADD(args, INTEGER_OBJ(startcol));
-    Array cells = ARRAY_DICT_INIT;
-    int repeat = 0;
-    size_t ncells = (size_t)(endcol-startcol);
-    int last_hl = -1;
-    for (size_t i = 0; i < ncells; i++) {
-      repeat++;
-      if (i == ncells-1 || attrs[i] != attrs[i+1]
-          || STRCMP(chunk[i], chunk[i+1])) {
-        Array cell = ARRAY_DICT_INIT;
-        ADD(cell, STRING_OBJ(cstr_to_string((const char *)chunk[i])));
-        if (attrs[i] != last_hl || repeat > 1) {
-          ADD(cell, INTEGER_OBJ(attrs[i]));
-          last_hl = attrs[i];
-        }
-        if (repeat > 1) {
-          ADD(cell, INTEGER_OBJ(repeat));
-        }
-        ADD(cells, ARRAY_OBJ(cell));
-        repeat = 0;
-      }
-    }
-    if (endcol < clearcol) {
-      Array cell = ARRAY_DICT_INIT;
-      ADD(cell, STRING_OBJ(cstr_to_string(" ")));
-      ADD(cell, INTEGER_OBJ(clearattr));
-      ADD(cell, INTEGER_OBJ(clearcol-endcol));
-      ADD(cells, ARRAY_OBJ(cell));
-    }
-    ADD(args, ARRAY_OBJ(cells));
-
-    push_call(ui, "grid_line", args);
+  if (data->shm && grid == data->shm_handle && row < data->shm_height
+      && endcol <= data->shm_width && clearcol <= data->shm_width) {
+    shm_put_line(ui, (int)row, (int)startcol, (int)endcol, (int)clearcol,
+                 (sattr_T)clearattr, chunk, attrs);
+  } else if (ui->ui_ext[kUINewgrid] && data->frame_interval
+      && grid == data->shadow.handle && row < data->shadow.height
+      && endcol <= data->shadow.width && clearcol <= data->shadow.width) {
+    shadow_put_line(&data->shadow, (int)row, (int)startcol, (int)endcol,
+                    (int)clearcol, (sattr_T)clearattr, chunk, attrs);
+  } else if (ui->ui_ext[kUINewgrid]) {
+    remote_ui_grid_line(ui, grid, row, startcol, endcol, clearcol, clearattr,
+                        chunk, attrs);
   } else {
     for (int i = 0; i < endcol-startcol; i++) {
       remote_ui_cursor_goto(ui, row, startcol+i);
@@ -489,14 +644,549 @@ static void remote_ui_raw_line(UI *ui, Integer grid, Integer row,
   }
 }
 
+/// Pushes a "grid_line" event.
+static void remote_ui_grid_line(UI *ui, Integer grid, Integer row,
+                                Integer startcol, Integer endcol,
+                                Integer clearcol, Integer clearattr,
+                                const schar_T *chunk, const sattr_T *attrs)
+{
+  UIData *data = ui->data;
+  if (data->packed_lines) {
+    remote_ui_packed_line(ui, grid, row, startcol, endcol, clearcol, clearattr,
+                          chunk, attrs);
+    return;
+  }
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, INTEGER_OBJ(grid));
+  ADD(args, INTEGER_OBJ(row));
+  ADD(args, INTEGER_OBJ(startcol));
+  Array cells = ARRAY_DICT_INIT;
+  int repeat = 0;
+  size_t ncells = (size_t)(endcol-startcol);
+  int last_hl = -1;
+  for (size_t i = 0; i < ncells; i++) {
+    repeat++;
+    if (i == ncells-1 || attrs[i] != attrs[i+1]
+        || STRCMP(chunk[i], chunk[i+1])) {
+      Array cell = ARRAY_DICT_INIT;
+      ADD(cell, STRING_OBJ(cstr_to_string((const char *)chunk[i])));
+      if (attrs[i] != last_hl || repeat > 1) {
+        ADD(cell, INTEGER_OBJ(attrs[i]));
+        last_hl = attrs[i];
+      }
+      if (repeat > 1) {
+        ADD(cell, INTEGER_OBJ(repeat));
+      }
+      ADD(cells, ARRAY_OBJ(cell));
+      repeat = 0;
+    }
+  }
+  if (endcol < clearcol) {
+    Array cell = ARRAY_DICT_INIT;
+    ADD(cell, STRING_OBJ(cstr_to_string(" ")));
+    ADD(cell, INTEGER_OBJ(clearattr));
+    ADD(cell, INTEGER_OBJ(clearcol-endcol));
+    ADD(cells, ARRAY_OBJ(cell));
+  }
+  ADD(args, ARRAY_OBJ(cells));
+
+  push_call(ui, "grid_line", args);
+}
+
+/// "grid_line" for the packed_lines option: same cells as the unpacked event,
+/// but packed directly as a stream of msgpack arrays, without building an
+/// Object for each cell. Sent as msgpack bin by remote_ui_flush().
+static void remote_ui_packed_line(UI *ui, Integer grid, Integer row,
+                                  Integer startcol, Integer endcol,
+                                  Integer clearcol, Integer clearattr,
+                                  const schar_T *chunk, const sattr_T *attrs)
+{
+  UIData *data = ui->data;
+  msgpack_packer pac;
+  msgpack_packer_init(&pac, &data->sbuffer, msgpack_sbuffer_write);
+  int repeat = 0;
+  size_t ncells = (size_t)(endcol-startcol);
+  int last_hl = -1;
+  for (size_t i = 0; i < ncells; i++) {
+    repeat++;
+    if (i == ncells-1 || attrs[i] != attrs[i+1]
+        || STRCMP(chunk[i], chunk[i+1])) {
+      bool send_hl = attrs[i] != last_hl || repeat > 1;
+      msgpack_pack_array(&pac, (size_t)(1 + send_hl + (repeat > 1)));
+      size_t len = STRLEN(chunk[i]);
+      msgpack_pack_str(&pac, len);
+      msgpack_pack_str_body(&pac, chunk[i], len);
+      if (send_hl) {
+        msgpack_pack_int(&pac, attrs[i]);
+        last_hl = attrs[i];
+      }
+      if (repeat > 1) {
+        msgpack_pack_int(&pac, repeat);
+      }
+      repeat = 0;
+    }
+  }
+  if (endcol < clearcol) {
+    msgpack_pack_array(&pac, 3);
+    msgpack_pack_str(&pac, 1);
+    msgpack_pack_str_body(&pac, " ", 1);
+    msgpack_pack_int64(&pac, clearattr);
+    msgpack_pack_int64(&pac, clearcol-endcol);
+  }
+
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, INTEGER_OBJ(grid));
+  ADD(args, INTEGER_OBJ(row));
+  ADD(args, INTEGER_OBJ(startcol));
+  ADD(args, STRING_OBJ(((String) {
+    .data = xmemdup(data->sbuffer.data, data->sbuffer.size),
+    .size = data->sbuffer.size,
+  })));
+  msgpack_sbuffer_clear(&data->sbuffer);
+  push_call(ui, "grid_line", args);
+}
+
+/// Sends the "redraw" batch of a packed_lines UI. Serialized here instead of
+/// by rpc_send_event() so that the packed cells go out as msgpack bin.
+static void remote_ui_send_packed(UIData *data)
+{
+  msgpack_packer pac;
+  msgpack_packer_init(&pac, &data->sbuffer, msgpack_sbuffer_write);
+  msgpack_pack_array(&pac, 3);
+  msgpack_pack_int(&pac, 2);
+  msgpack_rpc_from_string(STATIC_CSTR_AS_STRING("redraw"), &pac);
+  msgpack_pack_array(&pac, data->buffer.size);
+  for (size_t i = 0; i < data->buffer.size; i++) {
+    Array call = data->buffer.items[i].data.array;
+    if (!strequal(call.items[0].data.string.data, "grid_line")) {
+      msgpack_rpc_from_array(call, &pac);
+      continue;
+    }
+    msgpack_pack_array(&pac, call.size);
+    msgpack_rpc_from_string(call.items[0].data.string, &pac);
+    for (size_t j = 1; j < call.size; j++) {
+      Array args = call.items[j].data.array;
+      msgpack_pack_array(&pac, args.size);
+      for (size_t k = 0; k < args.size; k++) {
+        if (args.items[k].type == kObjectTypeString) {
+          String cells = args.items[k].data.string;
+          msgpack_pack_bin(&pac, cells.size);
+          msgpack_pack_bin_body(&pac, cells.data, cells.size);
+        } else {
+          msgpack_rpc_from_object(args.items[k], &pac);
+        }
+      }
+    }
+  }
+  remote_ui_send_sbuffer(data);
+  api_free_array(data->buffer);
+}
+
+/// Sends the "redraw" batch of a UI.  Serialized here instead of by
+/// rpc_send_event() so that its size can be counted.
+static void remote_ui_send_redraw(UIData *data)
+{
+  msgpack_packer pac;
+  msgpack_packer_init(&pac, &data->sbuffer, msgpack_sbuffer_write);
+  msgpack_rpc_serialize_request(0, STATIC_CSTR_AS_STRING("redraw"),
+                                data->buffer, &pac);
+  remote_ui_send_sbuffer(data);
+  api_free_array(data->buffer);
+}
+
+/// Sends the message serialized in the scratch buffer and clears it.
+static void remote_ui_send_sbuffer(UIData *data)
+{
+  g_stats.ui_frames++;
+  g_stats.ui_bytes += (int64_t)data->sbuffer.size;
+  rpc_send_raw(data->channel_id, xmemdup(data->sbuffer.data,
+                                         data->sbuffer.size),
+               data->sbuffer.size);
+  msgpack_sbuffer_clear(&data->sbuffer);
+}
+
 static void remote_ui_flush(UI *ui)
+{
+  UIData *data = ui->data;
+  if (data->shm) {
+    shm_flush(ui);
+  }
+  if (!data->frame_interval) {
+    remote_ui_send(ui);
+    return;
+  }
+  uint64_t elapsed = os_hrtime() - data->last_frame;
+  if (elapsed >= data->frame_interval) {
+    remote_ui_send_frame(ui);
+  } else if (!data->frame_scheduled) {
+    if (!data->frame_timer) {
+      data->frame_timer = xmalloc(sizeof(TimeWatcher));
+      time_watcher_init(&main_loop, data->frame_timer, ui);
+      // Not a fast event: never send a frame in the middle of a redraw.
+      data->frame_timer->events = main_loop.events;
+    }
+    data->frame_scheduled = true;
+    time_watcher_start(data->frame_timer, frame_timer_cb,
+                       (data->frame_interval - elapsed) / 1000000 + 1, 0);
+  }
+}
+
+static void frame_timer_cb(TimeWatcher *watcher, void *arg)
+{
+  UI *ui = arg;
+  if (!ui) {
+    return;  // UI was detached.
+  }
+  UIData *data = ui->data;
+  data->frame_scheduled = false;
+  remote_ui_send_frame(ui);
+}
+
+static void frame_timer_close_cb(TimeWatcher *watcher, void *arg)
+{
+  xfree(watcher);
+}
+
+/// Sends the pending frame of a max_fps UI: the events queued so far, then
+/// the grid rows changed since the last frame, as they are now.
+static void remote_ui_send_frame(UI *ui)
+{
+  UIData *data = ui->data;
+  UIShadowGrid *shadow = &data->shadow;
+  for (int row = 0; row < shadow->height; row++) {
+    int start = shadow->dirty_start[row];
+    int end = shadow->dirty_end[row];
+    if (start >= end) {
+      continue;
+    }
+    size_t off = (size_t)row * (size_t)shadow->width;
+    schar_T *chars = shadow->chars + off;
+    sattr_T *attrs = shadow->attrs + off;
+    // Send trailing blanks as a clear.
+    int endcol = end;
+    if (end == shadow->width) {
+      while (endcol > start && attrs[endcol - 1] == 0
+             && chars[endcol - 1][0] == ' ' && chars[endcol - 1][1] == NUL) {
+        endcol--;
+      }
+    }
+    remote_ui_grid_line(ui, shadow->handle, row, start, endcol, end, 0,
+                        chars + start, attrs + start);
+    shadow->dirty_start[row] = shadow->width;
+    shadow->dirty_end[row] = 0;
+  }
+  if (data->cursor_pending) {
+    Array args = ARRAY_DICT_INIT;
+    ADD(args, INTEGER_OBJ(data->cursor_grid));
+    ADD(args, INTEGER_OBJ(data->cursor_row));
+    ADD(args, INTEGER_OBJ(data->cursor_col));
+    push_call(ui, "grid_cursor_goto", args);
+    data->cursor_pending = false;
+  }
+  data->last_frame = os_hrtime();
+  remote_ui_send(ui);
+}
+
+static void shadow_free(UIShadowGrid *shadow)
+{
+  xfree(shadow->chars);
+  xfree(shadow->attrs);
+  xfree(shadow->dirty_start);
+  xfree(shadow->dirty_end);
+  memset(shadow, 0, sizeof(*shadow));
+}
+
+static void shadow_resize(UIShadowGrid *shadow, Integer handle, int width,
+                          int height)
+{
+  shadow_free(shadow);
+  size_t ncells = (size_t)width * (size_t)height;
+  shadow->handle = handle;
+  shadow->width = width;
+  shadow->height = height;
+  shadow->chars = xmalloc(ncells * sizeof(schar_T));
+  shadow->attrs = xmalloc(ncells * sizeof(sattr_T));
+  shadow->dirty_start = xmalloc((size_t)height * sizeof(int));
+  shadow->dirty_end = xmalloc((size_t)height * sizeof(int));
+  shadow_clear(shadow);
+  // Grid contents are undefined after a resize, until cleared.
+  for (int row = 0; row < height; row++) {
+    shadow_mark_dirty(shadow, row, 0, width);
+  }
+}
+
+/// Clears the shadow grid, as the client does on "grid_clear".
+static void shadow_clear(UIShadowGrid *shadow)
+{
+  size_t ncells = (size_t)shadow->width * (size_t)shadow->height;
+  for (size_t i = 0; i < ncells; i++) {
+    shadow->chars[i][0] = ' ';
+    shadow->chars[i][1] = NUL;
+    shadow->attrs[i] = 0;
+  }
+  for (int row = 0; row < shadow->height; row++) {
+    shadow->dirty_start[row] = shadow->width;
+    shadow->dirty_end[row] = 0;
+  }
+}
+
+static void shadow_mark_dirty(UIShadowGrid *shadow, int row, int start,
+                              int end)
+{
+  shadow->dirty_start[row] = MIN(shadow->dirty_start[row], start);
+  shadow->dirty_end[row] = MAX(shadow->dirty_end[row], end);
+}
+
+static void shadow_put_line(UIShadowGrid *shadow, int row, int startcol,
+                            int endcol, int clearcol, sattr_T clearattr,
+                            const schar_T *chunk, const sattr_T *attrs)
+{
+  size_t off = (size_t)row * (size_t)shadow->width;
+  memcpy(shadow->chars + off + startcol, chunk,
+         (size_t)(endcol - startcol) * sizeof(schar_T));
+  memcpy(shadow->attrs + off + startcol, attrs,
+         (size_t)(endcol - startcol) * sizeof(sattr_T));
+  for (int col = endcol; col < clearcol; col++) {
+    shadow->chars[off + (size_t)col][0] = ' ';
+    shadow->chars[off + (size_t)col][1] = NUL;
+    shadow->attrs[off + (size_t)col] = clearattr;
+  }
+  shadow_mark_dirty(shadow, row, startcol, MAX(endcol, clearcol));
+}
+
+/// Applies "grid_scroll" to the shadow grid. The event itself is still sent,
+/// so dirty ranges move along with the rows. Vacated rows are cleared.
+static void shadow_scroll(UIShadowGrid *shadow, int top, int bot, int left,
+                          int right, int rows)
+{
+  if (bot > shadow->height || right > shadow->width || rows == 0) {
+    return;
+  }
+  int start, stop, step;
+  if (rows > 0) {
+    start = top;
+    stop = bot - rows;
+    step = 1;
+  } else {
+    start = bot - 1;
+    stop = top - rows - 1;
+    step = -1;
+  }
+  size_t ncols = (size_t)(right - left);
+  for (int row = start; row != stop; row += step) {
+    size_t dst = (size_t)row * (size_t)shadow->width + (size_t)left;
+    size_t src = (size_t)(row + rows) * (size_t)shadow->width + (size_t)left;
+    memcpy(shadow->chars + dst, shadow->chars + src, ncols * sizeof(schar_T));
+    memcpy(shadow->attrs + dst, shadow->attrs + src, ncols * sizeof(sattr_T));
+    int src_start = MAX(shadow->dirty_start[row + rows], left);
+    int src_end = MIN(shadow->dirty_end[row + rows], right);
+    if (src_start < src_end) {
+      shadow_mark_dirty(shadow, row, src_start, src_end);
+    }
+  }
+  int clear_top = rows > 0 ? stop : top;
+  int clear_bot = rows > 0 ? bot : stop + 1;
+  for (int row = clear_top; row < clear_bot; row++) {
+    size_t off = (size_t)row * (size_t)shadow->width;
+    for (int col = left; col < right; col++) {
+      shadow->chars[off + (size_t)col][0] = ' ';
+      shadow->chars[off + (size_t)col][1] = NUL;
+      shadow->attrs[off + (size_t)col] = 0;
+    }
+    shadow_mark_dirty(shadow, row, left, right);
+  }
+}
+
+static ShmGridCell *shm_cells(UIData *data)
+{
+  return (ShmGridCell *)((char *)data->shm + sizeof(ShmGridHeader));
+}
+
+/// Stores the sequence number of the shared grid. An even number is stored
+/// after the cells were written; writes of the cells that follow an odd
+/// number must not become visible before it.
+static void shm_set_seq(ShmGridHeader *header, uint32_t seq)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __atomic_store_n(&header->seq, seq, __ATOMIC_RELEASE);
+  if (seq & 1) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+  }
+#else
+  // A full barrier on both sides.
+  _InterlockedExchange((volatile long *)&header->seq, (long)seq);
+#endif
+}
+
+/// Marks the shared grid as being updated, before the first write of a batch.
+static void shm_begin_write(UIData *data)
+{
+  if (!data->shm_writing) {
+    ShmGridHeader *header = data->shm;
+    shm_set_seq(header, header->seq + 1);
+    data->shm_writing = true;
+  }
+}
+
+/// (Re)creates the shared grid for a new grid size.
+///
+/// @return false if it could not be created. Normal grid events are sent from
+///         then on.
+static bool shm_resize(UI *ui, Integer grid, int width, int height)
+{
+  UIData *data = ui->data;
+  os_shm_destroy(data->shm, data->shm_size, data->shm_path);
+  data->shm_size = sizeof(ShmGridHeader)
+                   + (size_t)width * (size_t)height * sizeof(ShmGridCell);
+  data->shm = os_shm_create(data->shm_size, &data->shm_path);
+  if (!data->shm) {
+    data->shm_grid = false;
+    data->shm_size = 0;
+    return false;
+  }
+  ShmGridHeader *header = data->shm;
+  header->magic = SHM_GRID_MAGIC;
+  header->version = SHM_GRID_VERSION;
+  header->width = (uint32_t)width;
+  header->height = (uint32_t)height;
+  header->cell_size = sizeof(ShmGridCell);
+  header->seq = 0;
+  data->shm_handle = grid;
+  data->shm_width = width;
+  data->shm_height = height;
+  data->shm_writing = false;
+  data->dirty_top = data->dirty_bot = 0;
+  shm_clear(ui, 0, height, 0, width);
+  return true;
+}
+
+/// Adds a changed rectangle, merged with the pending one when they touch.
+static void shm_mark_dirty(UI *ui, int top, int bot, int left, int right)
+{
+  UIData *data = ui->data;
+  if (data->dirty_top < data->dirty_bot) {
+    if (top <= data->dirty_bot && bot >= data->dirty_top
+        && left <= data->dirty_right && right >= data->dirty_left) {
+      data->dirty_top = MIN(data->dirty_top, top);
+      data->dirty_bot = MAX(data->dirty_bot, bot);
+      data->dirty_left = MIN(data->dirty_left, left);
+      data->dirty_right = MAX(data->dirty_right, right);
+      return;
+    }
+    shm_push_dirty(ui);
+  }
+  data->dirty_top = top;
+  data->dirty_bot = bot;
+  data->dirty_left = left;
+  data->dirty_right = right;
+}
+
+static void shm_push_dirty(UI *ui)
+{
+  UIData *data = ui->data;
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, INTEGER_OBJ(data->shm_handle));
+  ADD(args, INTEGER_OBJ(data->dirty_top));
+  ADD(args, INTEGER_OBJ(data->dirty_bot));
+  ADD(args, INTEGER_OBJ(data->dirty_left));
+  ADD(args, INTEGER_OBJ(data->dirty_right));
+  push_call(ui, "grid_dirty", args);
+  data->dirty_top = data->dirty_bot = 0;
+}
+
+/// Publishes the updates of this batch, before it is sent.
+static void shm_flush(UI *ui)
+{
+  UIData *data = ui->data;
+  if (data->dirty_top < data->dirty_bot) {
+    shm_push_dirty(ui);
+  }
+  if (data->shm_writing) {
+    ShmGridHeader *header = data->shm;
+    shm_set_seq(header, header->seq + 1);
+    data->shm_writing = false;
+  }
+}
+
+static void shm_clear(UI *ui, int top, int bot, int left, int right)
+{
+  UIData *data = ui->data;
+  shm_begin_write(data);
+  ShmGridCell *cells = shm_cells(data);
+  for (int row = top; row < bot; row++) {
+    for (int col = left; col < right; col++) {
+      ShmGridCell *cell = &cells[(size_t)row * (size_t)data->shm_width
+                                 + (size_t)col];
+      cell->text[0] = ' ';
+      cell->text[1] = NUL;
+      cell->hl_id = 0;
+    }
+  }
+  shm_mark_dirty(ui, top, bot, left, right);
+}
+
+static void shm_put_line(UI *ui, int row, int startcol, int endcol,
+                         int clearcol, sattr_T clearattr,
+                         const schar_T *chunk, const sattr_T *attrs)
+{
+  UIData *data = ui->data;
+  shm_begin_write(data);
+  ShmGridCell *cells = shm_cells(data) + (size_t)row * (size_t)data->shm_width;
+  for (int col = startcol; col < endcol; col++) {
+    memcpy(cells[col].text, chunk[col - startcol], sizeof(schar_T));
+    cells[col].hl_id = (uint16_t)attrs[col - startcol];
+  }
+  for (int col = endcol; col < clearcol; col++) {
+    cells[col].text[0] = ' ';
+    cells[col].text[1] = NUL;
+    cells[col].hl_id = (uint16_t)clearattr;
+  }
+  shm_mark_dirty(ui, row, row + 1, startcol, MAX(endcol, clearcol));
+}
+
+/// Applies "grid_scroll" to the shared grid. Vacated rows are cleared.
+static void shm_scroll(UI *ui, int top, int bot, int left, int right,
+                       int rows)
+{
+  UIData *data = ui->data;
+  if (bot > data->shm_height || right > data->shm_width || rows == 0) {
+    return;
+  }
+  shm_begin_write(data);
+  ShmGridCell *cells = shm_cells(data);
+  size_t width = (size_t)data->shm_width;
+  size_t ncols = (size_t)(right - left);
+  if (rows > 0) {
+    for (int row = top; row < bot - rows; row++) {
+      memmove(&cells[(size_t)row * width + (size_t)left],
+              &cells[(size_t)(row + rows) * width + (size_t)left],
+              ncols * sizeof(ShmGridCell));
+    }
+    shm_clear(ui, bot - rows, bot, left, right);
+  } else {
+    for (int row = bot - 1; row >= top - rows; row--) {
+      memmove(&cells[(size_t)row * width + (size_t)left],
+              &cells[(size_t)(row + rows) * width + (size_t)left],
+              ncols * sizeof(ShmGridCell));
+    }
+    shm_clear(ui, top, top - rows, left, right);
+  }
+  shm_mark_dirty(ui, top, bot, left, right);
+}
+
+/// Sends all pending events.
+static void remote_ui_send(UI *ui)
 {
   UIData *data = ui->data;
   if (data->buffer.size > 0) {
     if (!ui->ui_ext[kUINewgrid]) {
       remote_ui_cursor_goto(ui, data->cursor_row, data->cursor_col);
     }
-    rpc_send_event(data->channel_id, "redraw", data->buffer);
+    if (data->packed_lines && ui->ui_ext[kUINewgrid]) {
+      remote_ui_send_packed(data);
+    } else {
+      remote_ui_send_redraw(data);
+    }
     data->buffer = (Array)ARRAY_DICT_INIT;
   }
 }
@@ -577,4 +1267,10 @@ static void remote_ui_inspect(UI *ui, Dictionary *info)
 {
   UIData *data = ui->data;
   PUT(*info, "chan", INTEGER_OBJ((Integer)data->channel_id));
+  PUT(*info, "packed_lines", BOOLEAN_OBJ(data->packed_lines));
+  PUT(*info, "shm_grid", BOOLEAN_OBJ(data->shm_grid));
+  PUT(*info, "max_fps", INTEGER_OBJ(data->frame_interval
+                                    ? (Integer)(1000000000
+                                                / data->frame_interval)
+                                    : 0));
 }
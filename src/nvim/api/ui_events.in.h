@@ -29,7 +29,7 @@ void bell(void)
 void visual_bell(void)
   FUNC_API_SINCE(3);
 void flush(void)
-  FUNC_API_SINCE(3) FUNC_API_REMOTE_IMPL;
+  FUNC_API_SINCE(3) FUNC_API_REMOTE_IMPL FUNC_API_BRIDGE_IMPL;
 void suspend(void)
   FUNC_API_SINCE(3) FUNC_API_BRIDGE_IMPL;
 void set_title(String title)
@@ -78,6 +78,11 @@ void grid_cursor_goto(Integer grid, Integer row, Integer col)
   FUNC_API_SINCE(5) FUNC_API_REMOTE_IMPL;
 void grid_line(Integer grid, Integer row, Integer col_start, Array data)
   FUNC_API_SINCE(5) FUNC_API_REMOTE_ONLY;
+void grid_shm(Integer grid, String path)
+  FUNC_API_SINCE(5) FUNC_API_REMOTE_ONLY FUNC_API_REMOTE_IMPL;
+void grid_dirty(Integer grid, Integer top, Integer bot, Integer left,
+                Integer right)
+  FUNC_API_SINCE(5) FUNC_API_REMOTE_ONLY FUNC_API_REMOTE_IMPL;
 void grid_scroll(Integer grid, Integer top, Integer bot,
                  Integer left, Integer right, Integer rows, Integer cols)
   FUNC_API_SINCE(5) FUNC_API_REMOTE_IMPL;
@@ -26,6 +26,7 @@
 #include "nvim/types.h"
 #include "nvim/ex_docmd.h"
 #include "nvim/screen.h"
+#include "nvim/search.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
 #include "nvim/eval.h"
@@ -1749,6 +1750,59 @@ Dictionary nvim__stats(void)
   Dictionary rv = ARRAY_DICT_INIT;
   PUT(rv, "fsync", INTEGER_OBJ(g_stats.fsync));
   PUT(rv, "redraw", INTEGER_OBJ(g_stats.redraw));
+  PUT(rv, "redraw_time", INTEGER_OBJ(g_stats.redraw_time));
+  PUT(rv, "ui_events", INTEGER_OBJ(g_stats.ui_events));
+  PUT(rv, "ui_frames", INTEGER_OBJ(g_stats.ui_frames));
+  PUT(rv, "ui_bytes", INTEGER_OBJ(g_stats.ui_bytes));
+  PUT(rv, "regprog_hits", INTEGER_OBJ(g_stats.regprog_hits));
+  PUT(rv, "regprog_misses", INTEGER_OBJ(g_stats.regprog_misses));
+  PUT(rv, "regprog_evictions", INTEGER_OBJ(g_stats.regprog_evictions));
+  PUT(rv, "syn_idle_lines", INTEGER_OBJ(g_stats.syn_idle_lines));
+  return rv;
+}
+
+/// Counts the matches of the last search pattern in the current buffer.
+/// See |searchcount()|.  In a large buffer counting continues while Nvim
+/// waits for input, "incomplete" is true until it is done.
+///
+/// @param  opts  Optional parameters:
+///               - "pattern": count this pattern instead of the last search
+///                 pattern
+/// @param[out]  err   Error details, if any.
+///
+/// @returns Map with "current", "total" and "incomplete", empty when there is
+///          no search pattern.
+Dictionary nvim_get_search_count(Dictionary opts, Error *err)
+  FUNC_API_SINCE(5)
+{
+  Dictionary rv = ARRAY_DICT_INIT;
+  const char *pat = NULL;
+
+  for (size_t i = 0; i < opts.size; i++) {
+    String k = opts.items[i].key;
+    Object v = opts.items[i].value;
+    if (!strequal("pattern", k.data)) {
+      api_set_error(err, kErrorTypeValidation, "unexpected key: %s", k.data);
+      return rv;
+    }
+    if (v.type != kObjectTypeString) {
+      api_set_error(err, kErrorTypeValidation, "pattern must be a String");
+      return rv;
+    }
+    pat = v.data.string.data;
+  }
+
+  SearchCount count;
+  try_start();
+  bool found = search_count((const char_u *)pat, &count);
+  if (try_end(err)) {
+    return rv;
+  }
+  if (found) {
+    PUT(rv, "current", INTEGER_OBJ(count.current));
+    PUT(rv, "total", INTEGER_OBJ(count.total));
+    PUT(rv, "incomplete", BOOLEAN_OBJ(count.incomplete));
+  }
   return rv;
 }
 
@@ -82,6 +82,42 @@ typedef enum {
   kBLSDeleted = 2,
 } BufhlLineStatus;
 
+/// State that the result of a %{} item in 'statusline', 'tabline' or
+/// 'rulerformat' is assumed to depend on. Compared with memcmp().
+typedef struct {
+  handle_T win;             ///< window the item is drawn for
+  handle_T buf;             ///< buffer of that window
+  handle_T curbuf;          ///< g:actual_curbuf
+  bool is_curwin;
+  varnumber_T changedtick;
+  int changed;              ///< 'modified'
+  char_u *fname;
+  pos_T cursor;
+  colnr_T curswant;
+  linenr_T topline;
+  int width;
+  int height;
+  int state;
+  int visual_active;
+  int visual_mode;
+  uint64_t tick;            ///< stl_expr_tick
+} StlExprKey;
+
+/// Result of a %{} item for one window.
+typedef struct {
+  StlExprKey key;
+  char_u *result;           ///< NULL when the evaluation failed
+} StlExprResult;
+
+/// A %{} item expression, with its results and profiling counts.
+typedef struct {
+  char *expr;
+  kvec_t(StlExprResult) results;
+  int count;                ///< times drawn while profiling
+  int evals;                ///< times evaluated while profiling
+  proftime_T total;         ///< time spent evaluating while profiling
+} StlExprItem;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "buffer.c.generated.h"
 #endif
@@ -93,6 +129,13 @@ static char *e_auabort = N_("E855: Autocommands caused command to abort");
 // Number of times free_buffer() was called.
 static int buf_free_count = 0;
 
+// %{} items of 'statusline' and friends, by expression.
+static Map(cstr_t, ptr_t) *stl_expr_items = NULL;
+// Incremented by stl_expr_invalidate().
+static uint64_t stl_expr_tick = 0;
+// Evaluating a %{} item: changes do not invalidate results.
+static int stl_expr_busy = 0;
+
 // Read data from buffer for retrying.
 static int
 read_buffer(
@@ -731,6 +774,7 @@ void buf_freeall(buf_T *buf, int flags)
     u_clearall(buf);                /* reset all undo information */
   }
   syntax_clear(&buf->b_s);          /* reset syntax info */
+  search_hl_cache_free(buf);
   buf->b_flags &= ~BF_READERR;      /* a read error is no longer relevant */
 }
 
@@ -796,6 +840,7 @@ free_buffer_stuff (
   uc_clear(&buf->b_ucmds);              // clear local user commands
   buf_delete_signs(buf);                // delete any signs
   bufhl_clear_all(buf);                // delete any highligts
+  search_hl_cache_free(buf);            // b:changedtick starts over
   map_clear_int(buf, MAP_ALL_MODES, true, false);    // clear local mappings
   map_clear_int(buf, MAP_ALL_MODES, true, true);     // clear local abbrevs
   xfree(buf->b_start_fenc);
@@ -3147,6 +3192,231 @@ typedef enum {
 } NumberBase;
 
 
+/// Evaluates %{} item "expr" of 'statusline', 'tabline' or 'rulerformat' for
+/// window "wp".
+///
+/// The result is reused as long as nothing the item is assumed to depend on
+/// changed: the buffer text, the cursor, the window size, the mode, and the
+/// state that stl_expr_invalidate() is called for, including options and
+/// variables outside of functions.
+///
+/// @return the allocated result, NULL on failure.
+static char_u *stl_eval_expr(win_T *wp, char_u *expr, int use_sandbox)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (stl_expr_items == NULL) {
+    stl_expr_items = map_new(cstr_t, ptr_t)();
+  }
+  StlExprItem *item = map_get(cstr_t, ptr_t)(stl_expr_items, (char *)expr);
+  if (item == NULL) {
+    item = xcalloc(1, sizeof(*item));
+    item->expr = xstrdup((char *)expr);
+    map_put(cstr_t, ptr_t)(stl_expr_items, item->expr, item);
+  }
+  const bool profiling = do_profiling == PROF_YES;
+  if (profiling) {
+    item->count++;
+  }
+
+  StlExprKey key;
+  stl_expr_key(wp, &key);
+  StlExprResult *res = NULL;
+  for (size_t i = 0; i < kv_size(item->results); i++) {
+    if (kv_A(item->results, i).key.win == wp->handle) {
+      res = &kv_A(item->results, i);
+      break;
+    }
+  }
+  if (res != NULL && memcmp(&res->key, &key, sizeof(key)) == 0) {
+    return res->result ? vim_strsave(res->result) : NULL;
+  }
+
+  proftime_T start = profile_zero();
+  if (profiling) {
+    start = profile_start();
+  }
+  stl_expr_busy++;
+
+  // Store the current buffer number as a string variable
+  char_u tmp[NUMBUFLEN];
+  vim_snprintf((char *)tmp, sizeof(tmp), "%d", curbuf->b_fnum);
+  set_internal_string_var((char_u *)"g:actual_curbuf", tmp);
+
+  buf_T *o_curbuf = curbuf;
+  win_T *o_curwin = curwin;
+  curwin = wp;
+  curbuf = wp->w_buffer;
+
+  // Note: The result stored in `t` is unused.
+  char_u *t;
+  char_u *str = eval_to_string_safe(expr, &t, use_sandbox);
+
+  curwin = o_curwin;
+  curbuf = o_curbuf;
+
+  // Remove the variable we just stored
+  do_unlet(S_LEN("g:actual_curbuf"), true);
+
+  stl_expr_busy--;
+  if (profiling) {
+    item->evals++;
+    item->total = profile_add(item->total, profile_end(start));
+  }
+
+  if (res == NULL) {
+    kv_push(item->results, ((StlExprResult) { .result = NULL }));
+    res = &kv_last(item->results);
+  }
+  // The evaluation may have changed what the key is made of, such as the
+  // cursor position.
+  stl_expr_key(wp, &res->key);
+  xfree(res->result);
+  res->result = str ? vim_strsave(str) : NULL;
+  return str;
+}
+
+/// Gets the state that %{} items drawn for window "wp" are assumed to depend
+/// on.
+static void stl_expr_key(win_T *wp, StlExprKey *key)
+  FUNC_ATTR_NONNULL_ALL
+{
+  memset(key, 0, sizeof(*key));
+  key->win = wp->handle;
+  key->buf = wp->w_buffer->handle;
+  key->curbuf = curbuf->handle;
+  key->is_curwin = wp == curwin;
+  key->changedtick = buf_get_changedtick(wp->w_buffer);
+  key->changed = wp->w_buffer->b_changed;
+  key->fname = wp->w_buffer->b_fname;
+  key->cursor = wp->w_cursor;
+  key->curswant = wp->w_curswant;
+  key->topline = wp->w_topline;
+  key->width = wp->w_width;
+  key->height = wp->w_height;
+  key->state = State;
+  key->visual_active = VIsual_active;
+  key->visual_mode = VIsual_mode;
+  key->tick = stl_expr_tick;
+}
+
+/// Makes %{} items of 'statusline' and friends evaluate again when drawn
+/// next. Called for changes of state they may depend on, besides what
+/// stl_eval_expr() checks itself.
+void stl_expr_invalidate(void)
+{
+  if (stl_expr_busy == 0) {
+    stl_expr_tick++;
+  }
+}
+
+/// Forgets the %{} item results of window "wp", which is being freed.
+/// Items left without results or profiling counts are freed.
+void stl_expr_win_free(win_T *wp)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (stl_expr_items == NULL) {
+    return;
+  }
+  kvec_t(StlExprItem *) unused = KV_INITIAL_VALUE;
+  StlExprItem *item;
+  map_foreach_value(stl_expr_items, item, {
+    for (size_t i = 0; i < kv_size(item->results); i++) {
+      if (kv_A(item->results, i).key.win == wp->handle) {
+        xfree(kv_A(item->results, i).result);
+        kv_A(item->results, i) = kv_last(item->results);
+        (void)kv_pop(item->results);
+        break;
+      }
+    }
+    if (kv_size(item->results) == 0 && item->count == 0) {
+      kv_push(unused, item);
+    }
+  });
+  // Not deleted above, the map must not change while iterating over it.
+  for (size_t i = 0; i < kv_size(unused); i++) {
+    item = kv_A(unused, i);
+    map_del(cstr_t, ptr_t)(stl_expr_items, item->expr);
+    stl_expr_item_free(item);
+  }
+  kv_destroy(unused);
+}
+
+static void stl_expr_item_free(StlExprItem *item)
+  FUNC_ATTR_NONNULL_ALL
+{
+  for (size_t i = 0; i < kv_size(item->results); i++) {
+    xfree(kv_A(item->results, i).result);
+  }
+  kv_destroy(item->results);
+  xfree(item->expr);
+  xfree(item);
+}
+
+#if defined(EXITFREE)
+void stl_expr_free_all(void)
+{
+  if (stl_expr_items == NULL) {
+    return;
+  }
+  StlExprItem *item;
+  map_foreach_value(stl_expr_items, item, {
+    stl_expr_item_free(item);
+  });
+  map_free(cstr_t, ptr_t)(stl_expr_items);
+  stl_expr_items = NULL;
+}
+
+#endif
+
+/// Dumps the profiling results of %{} items in file "fd".
+void stl_expr_dump_profile(FILE *fd)
+{
+  if (stl_expr_items == NULL) {
+    return;
+  }
+  kvec_t(StlExprItem *) sorted = KV_INITIAL_VALUE;
+  StlExprItem *item;
+  map_foreach_value(stl_expr_items, item, {
+    if (item->count > 0) {
+      kv_push(sorted, item);
+    }
+  });
+  if (kv_size(sorted) > 0) {
+    qsort(sorted.items, kv_size(sorted), sizeof(StlExprItem *),
+          stl_expr_compare_total);
+    fprintf(fd, "STATUSLINE ITEMS SORTED ON TOTAL TIME\n");
+    fprintf(fd, "count  evals  total (s)   item\n");
+    for (size_t i = 0; i < kv_size(sorted); i++) {
+      item = kv_A(sorted, i);
+      fprintf(fd, "%5d  %5d  %s  %%{%s}\n", item->count, item->evals,
+              profile_msg(item->total), item->expr);
+    }
+    fprintf(fd, "\n");
+  }
+  kv_destroy(sorted);
+}
+
+static int stl_expr_compare_total(const void *a, const void *b)
+{
+  const StlExprItem *ia = *(const StlExprItem *const *)a;
+  const StlExprItem *ib = *(const StlExprItem *const *)b;
+  return profile_cmp(ia->total, ib->total);
+}
+
+/// Resets the profiling counts of %{} items.
+void stl_expr_profile_reset(void)
+{
+  if (stl_expr_items == NULL) {
+    return;
+  }
+  StlExprItem *item;
+  map_foreach_value(stl_expr_items, item, {
+    item->count = 0;
+    item->evals = 0;
+    item->total = profile_zero();
+  });
+}
+
 /// Build a string from the status line items in "fmt".
 /// Return length of string in screen cells.
 ///
@@ -3610,27 +3880,7 @@ int build_stl_str_hl(
       // to the beginning of the expression
       out_p = t;
 
-      // { Evaluate the expression
-
-      // Store the current buffer number as a string variable
-      vim_snprintf((char *)tmp, sizeof(tmp), "%d", curbuf->b_fnum);
-      set_internal_string_var((char_u *)"g:actual_curbuf", tmp);
-
-      buf_T *o_curbuf = curbuf;
-      win_T *o_curwin = curwin;
-      curwin = wp;
-      curbuf = wp->w_buffer;
-
-      // Note: The result stored in `t` is unused.
-      str = eval_to_string_safe(out_p, &t, use_sandbox);
-
-      curwin = o_curwin;
-      curbuf = o_curbuf;
-
-      // Remove the variable we just stored
-      do_unlet(S_LEN("g:actual_curbuf"), true);
-
-      // }
+      str = stl_eval_expr(wp, out_p, use_sandbox);
 
       // Check if the evaluated result is a number.
       // If so, convert the number to an int and free the string.
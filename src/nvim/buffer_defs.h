@@ -446,6 +446,22 @@ typedef struct {
 /// Primary exists so that literals of relevant type can be made.
 typedef TV_DICTITEM_STRUCT(sizeof("changedtick")) ChangedtickDictItem;
 
+/// Result of searching for a 'hlsearch' or match pattern from one position.
+typedef struct {
+  int pat_id;           ///< id of the pattern, zero for an unused entry
+  linenr_T lnum;        ///< line where the search started
+  colnr_T col;          ///< column where the search started
+  long nmatched;        ///< what vim_regexec_multi() returned
+  lpos_T startpos;      ///< start of the match, relative to "lnum"
+  lpos_T endpos;        ///< end of the match, relative to "lnum"
+} hlcache_entry_T;
+
+/// Cache of 'hlsearch' and match positions in a buffer.
+typedef struct {
+  hlcache_entry_T *entries;  ///< direct-mapped table, NULL when empty
+  varnumber_T tick;          ///< b:changedtick the entries are valid for
+} hlcache_T;
+
 #define BUF_HAS_QF_ENTRY 1
 #define BUF_HAS_LL_ENTRY 2
 
@@ -784,6 +800,8 @@ struct file_buffer {
 
   kvec_t(BufhlLine *) b_bufhl_move_space;  // temporary space for highlights
 
+  hlcache_T b_hlcache;          // cached 'hlsearch' and match positions
+
   // array of channelids which have asked to receive updates for this
   // buffer.
   kvec_t(uint64_t) update_channels;
@@ -866,6 +884,41 @@ typedef struct w_line {
   linenr_T wl_lastlnum;         /* last buffer line number for logical line */
 } wline_T;
 
+/// Checkpoint of a virtual column index: the virtual column where the
+/// character at a byte offset of the line starts.
+typedef struct {
+  colnr_T vc_col;               ///< byte offset in the line
+  colnr_T vc_vcol;              ///< virtual column of the character there
+} vcolcp_T;
+
+/// Everything the virtual columns of a line in a window depend on, besides
+/// the text of the line. Compared with memcmp().
+typedef struct {
+  int vk_fnum;                  ///< b_fnum of the buffer
+  linenr_T vk_lnum;             ///< line number, 0 when there is no index
+  int vk_ts;                    ///< 'tabstop'
+  int vk_wrap;                  ///< 'wrap'
+  int vk_width;                 ///< w_width
+  int vk_col_off;               ///< win_col_off()
+  int vk_col_off2;              ///< win_col_off2()
+  unsigned vk_dy;               ///< dy_flags
+  int vk_emoji;                 ///< 'emoji'
+  char_u *vk_isp;               ///< 'isprint'
+  char_u *vk_ambw;              ///< 'ambiwidth'
+  uint64_t vk_opt_tick;         ///< get_string_option_tick()
+} vcolkey_T;
+
+/// Index of virtual columns of one long line, one checkpoint at the first
+/// character at or after every VCOL_INDEX_STEP bytes. Built lazily by
+/// getvcol(), so that it and the functions computing virtual columns do not
+/// have to walk the line from its start each time. Edits of the line drop
+/// the checkpoints after the change, see vcol_index_changed().
+typedef struct {
+  vcolkey_T vi_key;
+  varnumber_T vi_tick;          ///< b:changedtick the index is valid for
+  kvec_t(vcolcp_T) vi_cps;
+} vcolidx_T;
+
 /*
  * Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
  * or row (FR_ROW) layout or is a leaf, which has a window.
@@ -908,6 +961,8 @@ typedef struct {
   colnr_T endcol;       // in win_line() points to char where HL ends
   bool is_addpos;       // position specified directly by matchaddpos()
   proftime_T tm;        // for a time limit
+  int cache_id;         // pattern id in the buffer match cache, zero when
+                        // matches of the pattern are not cached
 } match_T;
 
 /// number of positions supported by matchaddpos()
@@ -1083,6 +1138,10 @@ struct window_S {
   int w_lines_valid;                /* number of valid entries */
   wline_T     *w_lines;
 
+  struct line_cache *w_line_cache;  ///< rendered screen rows of lines, see
+                                    ///< win_line_cached() in screen.c
+  vcolidx_T w_vcol_index;           ///< virtual columns of a long line
+
   garray_T w_folds;                 /* array of nested folds */
   bool w_fold_manual;               /* when true: some folds are opened/closed
                                        manually */
@@ -30,12 +30,17 @@
 #include "nvim/state.h"
 #include "nvim/strings.h"
 #include "nvim/path.h"
+#include "nvim/screen.h"
 #include "nvim/cursor.h"
+#include "nvim/buffer.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "charset.c.generated.h"
 #endif
 
+/// Bytes between checkpoints of the virtual column index, see vcolidx_T.
+#define VCOL_INDEX_STEP 4096
+
 
 static bool chartab_initialized = false;
 
@@ -271,6 +276,15 @@ int buf_init_chartab(buf_T *buf, int global)
     }
   }
   chartab_initialized = true;
+
+  // Character classes in patterns may match differently now.
+  if (global) {
+    FOR_ALL_BUFFERS(bp) {
+      search_hl_cache_free(bp);
+    }
+  } else {
+    search_hl_cache_free(buf);
+  }
   return OK;
 }
 
@@ -1196,6 +1210,137 @@ bool in_win_border(win_T *wp, colnr_T vcol)
   return (vcol - width1) % width2 == width2 - 1;
 }
 
+/// Gets what the virtual columns of line "lnum" in window "wp" depend on.
+///
+/// @return false when the virtual columns are not computed by the simple
+///         loop of getvcol(), which is the only one that is indexed.
+static bool vcol_index_key(win_T *wp, linenr_T lnum, vcolkey_T *key)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if ((wp->w_p_list && lcs_tab1 == NUL)
+      || wp->w_p_lbr
+      || *p_sbr != NUL
+      || wp->w_p_bri) {
+    return false;
+  }
+  memset(key, 0, sizeof(*key));
+  key->vk_fnum = wp->w_buffer->b_fnum;
+  key->vk_lnum = lnum;
+  key->vk_ts = (int)wp->w_buffer->b_p_ts;
+  key->vk_wrap = wp->w_p_wrap;
+  key->vk_width = wp->w_width;
+  key->vk_col_off = win_col_off(wp);
+  key->vk_col_off2 = win_col_off2(wp);
+  key->vk_dy = dy_flags;
+  key->vk_emoji = p_emoji;
+  key->vk_isp = p_isp;
+  key->vk_ambw = p_ambw;
+  key->vk_opt_tick = get_string_option_tick();
+  return true;
+}
+
+/// Returns the virtual column index of window "wp" if it is valid for "key",
+/// NULL otherwise.
+static vcolidx_T *vcol_index_lookup(win_T *wp, const vcolkey_T *key)
+  FUNC_ATTR_NONNULL_ALL
+{
+  vcolidx_T *vi = &wp->w_vcol_index;
+  if (memcmp(&vi->vi_key, key, sizeof(*key)) != 0
+      || vi->vi_tick != buf_get_changedtick(wp->w_buffer)) {
+    return NULL;
+  }
+  return vi;
+}
+
+/// Empties the virtual column index of window "wp" and makes it one for
+/// "key". Only done for lines that turn out to be long, so that computing
+/// columns in short lines keeps the index of a long one.
+static vcolidx_T *vcol_index_reset(win_T *wp, const vcolkey_T *key)
+  FUNC_ATTR_NONNULL_ALL
+{
+  vcolidx_T *vi = &wp->w_vcol_index;
+  memcpy(&vi->vi_key, key, sizeof(*key));
+  vi->vi_tick = buf_get_changedtick(wp->w_buffer);
+  kv_size(vi->vi_cps) = 0;
+  return vi;
+}
+
+/// Finds the last checkpoint of virtual column index "vi" at or before byte
+/// offset "col", or when "col" is -1, before virtual column "vcol".
+///
+/// @return the checkpoint, or NULL when there is none.
+static vcolcp_T *vcol_index_find(vcolidx_T *vi, colnr_T col, colnr_T vcol)
+  FUNC_ATTR_NONNULL_ALL
+{
+  size_t lo = 0;
+  size_t hi = kv_size(vi->vi_cps);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    vcolcp_T *cp = &kv_A(vi->vi_cps, mid);
+    if (col >= 0 ? cp->vc_col <= col : cp->vc_vcol < vcol) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 ? &kv_A(vi->vi_cps, lo - 1) : NULL;
+}
+
+/// Finds where to start walking line "lnum" of window "wp" to find the
+/// character at virtual column "vcol", with win_lbr_chartabsize().
+///
+/// @param[out] col  Byte offset of a character before virtual column
+///                  "vcol", 0 if there is no checkpoint.
+///
+/// @return the virtual column of the character at "col".
+colnr_T vcol_index_seek(win_T *wp, linenr_T lnum, colnr_T vcol, colnr_T *col)
+  FUNC_ATTR_NONNULL_ALL
+{
+  *col = 0;
+  vcolkey_T key;
+  if (!vcol_index_key(wp, lnum, &key)) {
+    return 0;
+  }
+  vcolidx_T *vi = vcol_index_lookup(wp, &key);
+  if (vi == NULL) {
+    return 0;
+  }
+  vcolcp_T *cp = vcol_index_find(vi, -1, vcol);
+  if (cp == NULL) {
+    return 0;
+  }
+  *col = cp->vc_col;
+  return cp->vc_vcol;
+}
+
+/// Updates the virtual column index of window "wp" for a change of lines
+/// "lnum" to "lnume" (exclusive) of its buffer, from byte "col" of "lnum",
+/// and "xtra" lines inserted (deleted when negative) after them.
+void vcol_index_changed(win_T *wp, linenr_T lnum, colnr_T col,
+                        linenr_T lnume, long xtra)
+  FUNC_ATTR_NONNULL_ALL
+{
+  vcolidx_T *vi = &wp->w_vcol_index;
+  linenr_T ilnum = vi->vi_key.vk_lnum;
+  if (ilnum == 0 || vi->vi_tick + 1 != buf_get_changedtick(wp->w_buffer)) {
+    // Already invalid, or changed without being updated here.
+    vi->vi_key.vk_lnum = 0;
+    return;
+  }
+  if (ilnum == lnum && lnume == lnum + 1 && xtra == 0) {
+    // Only this line changed: checkpoints before the change stay valid.
+    while (kv_size(vi->vi_cps) > 0 && kv_last(vi->vi_cps).vc_col > col) {
+      (void)kv_pop(vi->vi_cps);
+    }
+  } else if (ilnum >= lnum && ilnum < lnume) {
+    vi->vi_key.vk_lnum = 0;
+    return;
+  } else if (ilnum >= lnume) {
+    vi->vi_key.vk_lnum += (linenr_T)xtra;
+  }
+  vi->vi_tick = buf_get_changedtick(wp->w_buffer);
+}
+
 /// Get virtual column number of pos.
 ///  start: on the first position of this character (TAB, ctrl)
 /// cursor: where the cursor is on this character (first char, except for TAB)
@@ -1240,10 +1385,21 @@ void getvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor,
   // When 'list', 'linebreak', 'showbreak' and 'breakindent' are not set
   // use a simple loop.
   // Also use this when 'list' is set but tabs take their normal size.
-  if ((!wp->w_p_list || (lcs_tab1 != NUL))
-      && !wp->w_p_lbr
-      && (*p_sbr == NUL)
-      && !wp->w_p_bri ) {
+  // The columns computed by that loop are indexed for long lines: start at
+  // the last checkpoint before "pos", and add checkpoints when walking past
+  // the last one.
+  vcolkey_T key;
+  if (vcol_index_key(wp, pos->lnum, &key)) {
+    vcolidx_T *vi = vcol_index_lookup(wp, &key);
+    size_t ncps = vi != NULL ? kv_size(vi->vi_cps) : 0;
+    if (vi != NULL) {
+      vcolcp_T *cp = vcol_index_find(vi, posptr == NULL
+                                     ? MAXCOL : (colnr_T)(posptr - line), 0);
+      if (cp != NULL) {
+        ptr = line + cp->vc_col;
+        vcol = cp->vc_vcol;
+      }
+    }
     for (;;) {
       head = 0;
       c = *ptr;
@@ -1255,6 +1411,14 @@ void getvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor,
         break;
       }
 
+      if ((size_t)(ptr - line) >= (ncps + 1) * VCOL_INDEX_STEP) {
+        if (vi == NULL) {
+          vi = vcol_index_reset(wp, &key);
+        }
+        kv_push(vi->vi_cps, ((vcolcp_T) { (colnr_T)(ptr - line), vcol }));
+        ncps++;
+      }
+
       // A tab gets expanded, depending on the current column
       if (c == TAB) {
         incr = ts - (vcol % ts);
@@ -140,7 +140,10 @@ static int coladvance2(
       }
     }
 
-    ptr = line;
+    // In a long line, start at a checkpoint of the virtual column index.
+    colnr_T start;
+    col = vcol_index_seek(curwin, pos->lnum, wcol, &start);
+    ptr = line + start;
     while (col <= wcol && *ptr != NUL) {
       /* Count a tab for what it's worth (if list mode not on) */
       csize = win_lbr_chartabsize(curwin, line, ptr, col, &head);
@@ -2342,6 +2342,11 @@ static void set_var_lval(lval_T *lp, char_u *endp, typval_T *rettv,
   listitem_T  *ri;
   dictitem_T  *di;
 
+  if (lp->ll_tv != NULL) {
+    // A List or Dictionary item, which may be anywhere.
+    stl_expr_invalidate();
+  }
+
   if (lp->ll_tv == NULL) {
     cc = *endp;
     *endp = NUL;
@@ -2949,6 +2954,7 @@ int do_unlet(const char *const name, const size_t name_len, const int forceit)
   hashtab_T *ht = find_var_ht_dict(name, name_len, &varname, &dict);
 
   if (ht != NULL && *varname != NUL) {
+    var_changed(dict);
     dict_T *d;
     if (ht == &globvarht) {
       d = &globvardict;
@@ -14054,6 +14060,32 @@ static void f_search(typval_T *argvars, typval_T *rettv, FunPtr fptr)
   rettv->vval.v_number = search_cmn(argvars, NULL, &flags);
 }
 
+/// "searchcount()" function
+static void f_searchcount(typval_T *argvars, typval_T *rettv, FunPtr fptr)
+{
+  const char *pat = NULL;
+
+  tv_dict_alloc_ret(rettv);
+  if (argvars[0].v_type != VAR_UNKNOWN) {
+    if (argvars[0].v_type != VAR_DICT) {
+      EMSG(_(e_dictreq));
+      return;
+    }
+    dict_T *const d = argvars[0].vval.v_dict;
+    if (d != NULL) {
+      pat = tv_dict_get_string(d, "pattern", false);
+    }
+  }
+
+  SearchCount count;
+  if (search_count((const char_u *)pat, &count)) {
+    dict_T *const d = rettv->vval.v_dict;
+    tv_dict_add_nr(d, S_LEN("current"), (varnumber_T)count.current);
+    tv_dict_add_nr(d, S_LEN("total"), (varnumber_T)count.total);
+    tv_dict_add_nr(d, S_LEN("incomplete"), count.incomplete);
+  }
+}
+
 /*
  * "searchdecl()" function
  */
@@ -18951,6 +18983,17 @@ end:
   return *d ? &(*d)->dv_hashtab : NULL;
 }
 
+/// Called when a variable in scope "dict" is set or removed.
+static void var_changed(const dict_T *dict)
+{
+  // 'statusline' items may depend on any variable not local to a function.
+  if (current_funccal == NULL
+      || (dict != &get_funccal()->l_vars
+          && dict != &get_funccal()->l_avars)) {
+    stl_expr_invalidate();
+  }
+}
+
 /// Find the hashtable used for a variable
 ///
 /// @param[in]  name  Variable name, possibly with scope prefix.
@@ -19173,6 +19216,7 @@ static void set_var(const char *name, const size_t name_len, typval_T *const tv,
     EMSG2(_(e_illvar), name);
     return;
   }
+  var_changed(dict);
   v = find_var_in_ht(ht, 0, varname, name_len - (size_t)(varname - name), true);
 
   // Search in parent scope which is possible to reference from lambda
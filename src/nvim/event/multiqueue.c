@@ -44,6 +44,10 @@
 // the event loop queue and poll job1 queue instead. Same with channels, when
 // calling `rpcrequest` we want to temporarily stop processing events from
 // other sources and focus on a specific channel.
+//
+// Items are recycled through a freelist owned by the root ("parent") queue and
+// shared with all of its children, so a steady stream of events (job output,
+// timers, RPC) does not hit malloc/free for every item and its link node.
 
 #include <assert.h>
 #include <stdarg.h>
@@ -76,8 +80,14 @@ struct multiqueue {
   put_callback put_cb;
   void *data;
   size_t size;
+  QUEUE freelist;  // recycled items, only used in the root queue
+  size_t freelist_size;
 };
 
+// Maximum number of recycled items kept by a root queue. Bounds the memory
+// retained after a burst of events.
+#define MULTIQUEUE_FREELIST_MAX 1024
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "event/multiqueue.c.generated.h"
 #endif
@@ -102,6 +112,8 @@ static MultiQueue *multiqueue_new(MultiQueue *parent, put_callback put_cb,
 {
   MultiQueue *rv = xmalloc(sizeof(MultiQueue));
   QUEUE_INIT(&rv->headtail);
+  QUEUE_INIT(&rv->freelist);
+  rv->freelist_size = 0;
   rv->size = 0;
   rv->parent = parent;
   rv->put_cb = put_cb;
@@ -117,10 +129,16 @@ void multiqueue_free(MultiQueue *this)
     MultiQueueItem *item = multiqueue_node_data(q);
     if (this->parent) {
       QUEUE_REMOVE(&item->data.item.parent_item->node);
-      xfree(item->data.item.parent_item);
+      multiqueueitem_free(this, item->data.item.parent_item);
     }
     QUEUE_REMOVE(q);
-    xfree(item);
+    multiqueueitem_free(this, item);
+  }
+
+  while (!QUEUE_EMPTY(&this->freelist)) {
+    QUEUE *q = QUEUE_HEAD(&this->freelist);
+    QUEUE_REMOVE(q);
+    xfree(multiqueue_node_data(q));
   }
 
   xfree(this);
@@ -182,7 +200,8 @@ size_t multiqueue_size(MultiQueue *this)
 /// Gets an Event from an item.
 ///
 /// @param remove   Remove the node from its queue, and free it.
-static Event multiqueueitem_get_event(MultiQueueItem *item, bool remove)
+static Event multiqueueitem_get_event(MultiQueue *this, MultiQueueItem *item,
+                                      bool remove)
 {
   assert(item != NULL);
   Event ev;
@@ -196,13 +215,13 @@ static Event multiqueueitem_get_event(MultiQueueItem *item, bool remove)
     // remove the child node
     if (remove) {
       QUEUE_REMOVE(&child->node);
-      xfree(child);
+      multiqueueitem_free(linked, child);
     }
   } else {
     // remove the corresponding link node in the parent queue
     if (remove && item->data.item.parent_item) {
       QUEUE_REMOVE(&item->data.item.parent_item->node);
-      xfree(item->data.item.parent_item);
+      multiqueueitem_free(this, item->data.item.parent_item);
       item->data.item.parent_item = NULL;
     }
     ev = item->data.item.event;
@@ -217,22 +236,22 @@ static Event multiqueue_remove(MultiQueue *this)
   QUEUE_REMOVE(h);
   MultiQueueItem *item = multiqueue_node_data(h);
   assert(!item->link || !this->parent);  // Only a parent queue has link-nodes
-  Event ev = multiqueueitem_get_event(item, true);
+  Event ev = multiqueueitem_get_event(this, item, true);
   this->size--;
-  xfree(item);
+  multiqueueitem_free(this, item);
   return ev;
 }
 
 static void multiqueue_push(MultiQueue *this, Event event)
 {
-  MultiQueueItem *item = xmalloc(sizeof(MultiQueueItem));
+  MultiQueueItem *item = multiqueueitem_alloc(this);
   item->link = false;
   item->data.item.event = event;
   item->data.item.parent_item = NULL;
   QUEUE_INSERT_TAIL(&this->headtail, &item->node);
   if (this->parent) {
     // push link node to the parent queue
-    item->data.item.parent_item = xmalloc(sizeof(MultiQueueItem));
+    item->data.item.parent_item = multiqueueitem_alloc(this);
     item->data.item.parent_item->link = true;
     item->data.item.parent_item->data.queue = this;
     QUEUE_INSERT_TAIL(&this->parent->headtail,
@@ -245,3 +264,36 @@ static MultiQueueItem *multiqueue_node_data(QUEUE *q)
 {
   return QUEUE_DATA(q, MultiQueueItem, node);
 }
+
+/// Gets the queue owning the item freelist shared by `this` and its relatives.
+static inline MultiQueue *multiqueue_root(MultiQueue *this)
+{
+  return this->parent ? this->parent : this;
+}
+
+/// Allocates an item, reusing one from the root freelist when available.
+static MultiQueueItem *multiqueueitem_alloc(MultiQueue *this)
+{
+  MultiQueue *root = multiqueue_root(this);
+  if (QUEUE_EMPTY(&root->freelist)) {
+    return xmalloc(sizeof(MultiQueueItem));
+  }
+  QUEUE *q = QUEUE_HEAD(&root->freelist);
+  QUEUE_REMOVE(q);
+  root->freelist_size--;
+  return multiqueue_node_data(q);
+}
+
+/// Returns an item to the root freelist, or frees it if the freelist is full.
+///
+/// @param this  Any queue in the tree the item was allocated from.
+static void multiqueueitem_free(MultiQueue *this, MultiQueueItem *item)
+{
+  MultiQueue *root = multiqueue_root(this);
+  if (root->freelist_size >= MULTIQUEUE_FREELIST_MAX) {
+    xfree(item);
+    return;
+  }
+  QUEUE_INSERT_HEAD(&root->freelist, &item->node);
+  root->freelist_size++;
+}
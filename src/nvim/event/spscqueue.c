@@ -0,0 +1,163 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// Single-producer/single-consumer queue of Events.
+//
+// The producer reserves records (an Event plus payload bytes) and fills them
+// in place, then publishes a whole batch at once. The consumer runs the
+// handlers directly from the ring buffer and only releases a record after its
+// handler returned, so Event arguments may point into the record's payload.
+//
+// Positions are free-running counters; only `head` and `tail` are shared
+// between the threads, each written by exactly one side.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+#include "nvim/event/spscqueue.h"
+#include "nvim/memory.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+# define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+# define EXCHANGE(p, v) __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#else
+// MSVC: volatile accesses have acquire/release semantics (/volatile:ms).
+# define LOAD_ACQUIRE(p) (*(volatile size_t *)(p))
+# define STORE_RELEASE(p, v) (*(volatile size_t *)(p) = (v))
+# define EXCHANGE(p, v) ((int)_InterlockedExchange((volatile long *)(p), (v)))
+#endif
+
+// Low bit of SPSCRecord.size: the record is padding up to the end of the
+// buffer. Sizes are multiples of 8, so the bit is otherwise unused.
+#define PADDING 1
+#define RECORD_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+typedef struct {
+  size_t size;  // size of the record including this header
+  Event event;
+} SPSCRecord;
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "event/spscqueue.c.generated.h"
+#endif
+
+/// Initializes a queue.
+///
+/// @param capacity  Size of the ring buffer in bytes, a power of two.
+void spscqueue_init(SPSCQueue *q, size_t capacity)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(capacity >= 2 * sizeof(SPSCRecord)
+         && (capacity & (capacity - 1)) == 0);
+  q->buf = xmalloc(capacity);
+  q->capacity = capacity;
+  q->head = q->tail = q->write = 0;
+  q->wakeup = 0;
+}
+
+void spscqueue_destroy(SPSCQueue *q)
+  FUNC_ATTR_NONNULL_ALL
+{
+  xfree(q->buf);
+  q->buf = NULL;
+}
+
+/// Largest payload a single record can carry.
+size_t spscqueue_max_payload(const SPSCQueue *q)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  return q->capacity / 2 - sizeof(SPSCRecord);
+}
+
+/// Producer: reserves a record that is not visible to the consumer until
+/// spscqueue_publish() is called.
+///
+/// @param payload_size  Number of extra bytes to reserve with the record,
+///                      at most spscqueue_max_payload().
+/// @param[out] payload  Set to the payload storage (8-byte aligned).
+///
+/// @return the Event to fill in, or NULL if the queue is currently full.
+Event *spscqueue_reserve(SPSCQueue *q, size_t payload_size, void **payload)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  assert(payload_size <= spscqueue_max_payload(q));
+  size_t need = RECORD_ALIGN(sizeof(SPSCRecord) + payload_size);
+  size_t pos = q->write & (q->capacity - 1);
+  size_t to_end = q->capacity - pos;
+  size_t skip = need > to_end ? to_end : 0;
+  if (q->write + skip + need - LOAD_ACQUIRE(&q->tail) > q->capacity) {
+    return NULL;
+  }
+  if (skip) {
+    ((SPSCRecord *)(q->buf + pos))->size = skip | PADDING;
+    q->write += skip;
+    pos = 0;
+  }
+  SPSCRecord *rec = (SPSCRecord *)(q->buf + pos);
+  rec->size = need;
+  q->write += need;
+  *payload = rec + 1;
+  return &rec->event;
+}
+
+/// Producer: makes all reserved records visible to the consumer.
+///
+/// @return true if the consumer must be woken up, i.e. no wakeup is pending
+///         since the consumer last started processing.
+bool spscqueue_publish(SPSCQueue *q)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (q->write == q->head) {
+    return false;
+  }
+  STORE_RELEASE(&q->head, q->write);
+  return EXCHANGE(&q->wakeup, 1) == 0;
+}
+
+/// Producer: checks if there are reserved records not yet published.
+bool spscqueue_has_unpublished(const SPSCQueue *q)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  return q->write != q->head;
+}
+
+/// Producer: checks if a record of `payload_size` can be reserved without
+/// waiting for the consumer.
+bool spscqueue_has_room(SPSCQueue *q, size_t payload_size)
+  FUNC_ATTR_NONNULL_ALL
+{
+  size_t need = RECORD_ALIGN(sizeof(SPSCRecord) + payload_size);
+  size_t to_end = q->capacity - (q->write & (q->capacity - 1));
+  size_t skip = need > to_end ? to_end : 0;
+  return q->write + skip + need - LOAD_ACQUIRE(&q->tail) <= q->capacity;
+}
+
+/// Consumer: runs the handlers of all published records, in order.
+///
+/// @return number of events processed.
+size_t spscqueue_process(SPSCQueue *q)
+  FUNC_ATTR_NONNULL_ALL
+{
+  // Clear the flag before looking at `head`: anything published after this
+  // point requests a new wakeup.
+  (void)EXCHANGE(&q->wakeup, 0);
+  size_t count = 0;
+  size_t tail = q->tail;
+  while (tail != LOAD_ACQUIRE(&q->head)) {
+    SPSCRecord *rec = (SPSCRecord *)(q->buf + (tail & (q->capacity - 1)));
+    size_t size = rec->size;
+    if (!(size & PADDING)) {
+      rec->event.handler(rec->event.argv);
+      count++;
+    }
+    tail += size & ~(size_t)PADDING;
+    STORE_RELEASE(&q->tail, tail);
+  }
+  return count;
+}
@@ -0,0 +1,25 @@
+#ifndef NVIM_EVENT_SPSCQUEUE_H
+#define NVIM_EVENT_SPSCQUEUE_H
+
+#include <stddef.h>
+
+#include "nvim/event/defs.h"
+
+typedef struct spsc_queue SPSCQueue;
+
+// Lock-free queue of Events for exactly one producer and one consumer thread.
+// Records are stored inline in a ring buffer, together with an optional
+// payload that the Event arguments may point into.
+struct spsc_queue {
+  char *buf;
+  size_t capacity;  // power of two
+  size_t head;      // published write position, stored by the producer
+  size_t tail;      // read position, stored by the consumer
+  size_t write;     // unpublished write position, producer only
+  int wakeup;       // consumer wakeup is pending
+};
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "event/spscqueue.h.generated.h"
+#endif
+#endif  // NVIM_EVENT_SPSCQUEUE_H
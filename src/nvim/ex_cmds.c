@@ -107,6 +107,37 @@ typedef struct {
   linenr_T lines_needed;  // lines neede in the preview window
 } PreviewLines;
 
+// Range of lines changed by :substitute
+typedef struct {
+  linenr_T lnum;   // first line
+  linenr_T count;  // number of lines
+} SubRange;
+
+// Lines changed by :substitute are put in the buffer in batches of
+// consecutive lines, with one undo entry for each batch.
+typedef struct {
+  linenr_T lnum;               // line number of the first line in "lines"
+  kvec_t(char_u *) lines;      // new text of the lines
+  kvec_t(SubRange) ranges;     // batches put in the buffer
+  long nsubs;                  // number of substitutions in "lines"
+  bool only_batched;           // no other changes were made
+} SubBatch;
+
+typedef kvec_t(linenr_T) LinenrVec;
+
+/// Lines that may match the pattern of the last 'inccommand' preview.  When
+/// more of the pattern is typed the other lines can't match, the preview
+/// skips them.
+static struct {
+  char_u *pat;               ///< pattern, NULL when not valid
+  bool ic;                   ///< "pat" was matched ignoring case
+  handle_T buf_handle;       ///< buffer the lines are in
+  varnumber_T changedtick;   ///< b:changedtick of that buffer
+  linenr_T first;            ///< first line searched
+  linenr_T last;             ///< last line searched
+  LinenrVec lines;           ///< lines from "first" to "last" that may match
+} sub_preview_known = { NULL, false, 0, 0, 0, 0, KV_INITIAL_VALUE };
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "ex_cmds.c.generated.h"
 #endif
@@ -812,6 +843,8 @@ int do_move(linenr_T line1, linenr_T line2, linenr_T dest)
    * And Finally we adjust the marks we put at the end of the file back to
    * their final destination at the new text position -- webb
    */
+  // The moved lines are no longer marked by ":global".
+  global_marks_adjust(line1, line2, MAXLNUM, 0L);
   last_line = curbuf->b_ml.ml_line_count;
   mark_adjust_nofold(line1, line2, last_line - line2, 0L, true);
   changed_lines(last_line - num_lines + 1, 0, last_line + 1, num_lines, false);
@@ -1242,6 +1275,9 @@ static void do_filter(
     }
 
     if (do_in) {
+      // The filtered lines are replaced, they are no longer marked by
+      // ":global".
+      global_marks_adjust(line1, line2, MAXLNUM, 0L);
       if (cmdmod.keepmarks || vim_strchr(p_cpo, CPO_REMMARK) == NULL) {
         if (read_linecount >= linecount) {
           // move all marks from old lines to new lines
@@ -3181,6 +3217,64 @@ static char_u *sub_parse_flags(char_u *cmd, subflags_T *subflags,
   return cmd;
 }
 
+/// Add line "lnum" with new text "line" and "nsubs" substitutions to
+/// "batch".  Puts the lines collected so far in the buffer when "lnum"
+/// doesn't follow them.
+///
+/// @return FAIL when putting the lines in the buffer failed, "line" is freed.
+static int sub_batch_add(SubBatch *batch, linenr_T lnum, char_u *line,
+                         long nsubs)
+{
+  if (kv_size(batch->lines) > 0
+      && lnum != batch->lnum + (linenr_T)kv_size(batch->lines)
+      && sub_batch_flush(batch) == FAIL) {
+    xfree(line);
+    return FAIL;
+  }
+  if (kv_size(batch->lines) == 0) {
+    batch->lnum = lnum;
+  }
+  kv_push(batch->lines, line);
+  batch->nsubs += nsubs;
+  return OK;
+}
+
+/// Put the lines collected in "batch" in the buffer, after saving the old
+/// lines for undo.  When saving for undo fails the lines are dropped and no
+/// longer counted as substituted.
+///
+/// @return FAIL when saving for undo failed.
+static int sub_batch_flush(SubBatch *batch)
+{
+  linenr_T count = (linenr_T)kv_size(batch->lines);
+  int ret = OK;
+
+  if (count == 0) {
+    return OK;
+  }
+  // Undo puts the cursor on the first changed line, like for ":s" on a
+  // single line.
+  pos_T save_cursor = curwin->w_cursor;
+  curwin->w_cursor.lnum = batch->lnum;
+  curwin->w_cursor.col = 0;
+  ret = u_savesub_lines(batch->lnum, count);
+  curwin->w_cursor = save_cursor;
+
+  if (ret == OK) {
+    ml_replace_lines(batch->lnum, batch->lines.items, count);
+    kv_push(batch->ranges, ((SubRange){ batch->lnum, count }));
+  } else {
+    for (linenr_T i = 0; i < count; i++) {
+      xfree(kv_A(batch->lines, i));
+    }
+    sub_nsubs -= batch->nsubs;
+    sub_nlines -= count;
+  }
+  kv_size(batch->lines) = 0;
+  batch->nsubs = 0;
+  return ret;
+}
+
 /// Perform a substitution from line eap->line1 to line eap->line2 using the
 /// command pointed to by eap->arg which should be of the form:
 ///
@@ -3219,6 +3313,7 @@ static buf_T *do_sub(exarg_T *eap, proftime_T timeout,
   char_u *sub_firstline;    // allocated copy of first sub line
   bool endcolumn = false;   // cursor in last column when done
   PreviewLines preview_lines = { KV_INITIAL_VALUE, 0 };
+  SubBatch batch = { 0, KV_INITIAL_VALUE, KV_INITIAL_VALUE, 0, true };
   static int pre_src_id = 0;  // Source id for the preview highlight
   static int pre_hl_id = 0;
   buf_T *orig_buf = curbuf;  // save to reset highlighting
@@ -3385,16 +3480,59 @@ static buf_T *do_sub(exarg_T *eap, proftime_T timeout,
   if (!(sub[0] == '\\' && sub[1] == '='))
     sub = regtilde(sub, p_magic);
 
+  // While previewing the pattern remember the lines that may match, so that
+  // the other lines are skipped when more of the pattern is typed.  Also
+  // when typing the substitute string, if that can't change line numbers or
+  // other lines.
+  linenr_T first_lnum = eap->line1;
+  if (preview && !has_second_delim && *p_icm == 'n'
+      && !re_multiline(regmatch.regprog)) {
+    // Without a preview window matches above the window are not shown.
+    first_lnum = MAX(first_lnum, curwin->w_topline);
+  }
+  bool record_known = preview && !has_second_delim && pat != NULL
+                      && *pat != NUL;
+  bool use_known = (record_known
+                    || (preview && !re_multiline(regmatch.regprog)
+                        && !(sub[0] == '\\' && sub[1] == '=')))
+                   && sub_preview_known_usable(pat, regmatch.rmm_ic);
+  LinenrVec known = KV_INITIAL_VALUE;
+  size_t known_idx = 0;
+  linenr_T searched = first_lnum - 1;  // last line searched
+  int peek_count = 0;
+
   // Check for a match on each line.
   // If preview: limit to max('cmdwinheight', viewport).
   linenr_T line2 = eap->line2;
-  for (linenr_T lnum = eap->line1;
+  for (linenr_T lnum = first_lnum;
        lnum <= line2 && !got_quit && !aborting()
        && (!preview || preview_lines.lines_needed <= (linenr_T)p_cwh
            || lnum <= curwin->w_botline);
        lnum++) {
+    if (use_known && curbuf->b_ml.ml_line_count != old_line_count) {
+      use_known = false;  // line numbers changed
+    }
+    if (use_known && lnum >= sub_preview_known.first
+        && lnum <= sub_preview_known.last) {
+      // Go to the next line that may match.
+      while (known_idx < kv_size(sub_preview_known.lines)
+             && kv_A(sub_preview_known.lines, known_idx) < lnum) {
+        known_idx++;
+      }
+      linenr_T next = known_idx < kv_size(sub_preview_known.lines)
+                      ? kv_A(sub_preview_known.lines, known_idx)
+                      : sub_preview_known.last + 1;
+      if (next > lnum) {
+        searched = next - 1;
+        lnum = next - 1;
+        continue;
+      }
+    }
+
+    const linenr_T match_lnum = lnum;
     long nmatch = vim_regexec_multi(&regmatch, curwin, curbuf, lnum,
                                     (colnr_T)0, NULL);
+    const bool matched = nmatch != 0;
     if (nmatch) {
       colnr_T copycol;
       colnr_T matchcol;
@@ -3402,6 +3540,7 @@ static buf_T *do_sub(exarg_T *eap, proftime_T timeout,
       char_u      *new_end, *new_start = NULL;
       char_u      *p1;
       int did_sub = FALSE;
+      long line_nsubs = sub_nsubs;      // "sub_nsubs" before this line
       int lastone;
       long nmatch_tl = 0;               // nr of lines matched below lnum
       int do_again;                     // do it again after joining lines
@@ -3855,6 +3994,10 @@ static buf_T *do_sub(exarg_T *eap, proftime_T timeout,
             if (p1[0] == '\\' && p1[1] != NUL) {            // remove backslash
               STRMOVE(p1, p1 + 1);
             } else if (*p1 == CAR) {
+              if (sub_batch_flush(&batch) == FAIL) {
+                got_quit = true;                      // stop after this line
+              }
+              batch.only_batched = false;
               if (u_inssub(lnum) == OK) {             // prepare for undo
                 *p1 = NUL;                            // truncate up to the CR
                 ml_append(lnum - 1, new_start,
@@ -3933,10 +4076,30 @@ skip:
             prev_matchcol = (colnr_T)STRLEN(sub_firstline)
                             - prev_matchcol;
 
-            if (u_savesub(lnum) != OK) {
-              break;
+            if (!subflags.do_ask && nmatch_tl == 0
+                && !re_multiline(regmatch.regprog)
+                && !(sub[0] == '\\' && sub[1] == '=')) {
+              // Matching in other lines doesn't depend on this line, it
+              // can be put in the buffer later.
+              if (sub_batch_add(&batch, lnum, vim_strsave(new_start),
+                                sub_nsubs - line_nsubs) == FAIL) {
+                // Saving for undo failed, this line isn't changed either.
+                sub_nsubs = line_nsubs;
+                did_sub = false;
+                got_quit = true;
+                break;
+              }
+            } else {
+              batch.only_batched = false;
+              if (sub_batch_flush(&batch) == FAIL) {
+                got_quit = true;
+                break;
+              }
+              if (u_savesub(lnum) != OK) {
+                break;
+              }
+              ml_replace(lnum, new_start, true);
             }
-            ml_replace(lnum, new_start, true);
 
             if (nmatch_tl > 0) {
               /*
@@ -4028,12 +4191,32 @@ skip:
       sub_firstline = NULL;
     }
 
+    if (record_known) {
+      // Lines after the first one of a match weren't searched.
+      for (linenr_T l = match_lnum; matched && l <= lnum; l++) {
+        kv_push(known, l);
+      }
+      searched = lnum;
+    }
+
     line_breakcheck();
 
     if (profile_passed_limit(timeout)) {
       got_quit = true;
     }
+    // Stop the preview when a key was typed, it will be done again.
+    if (preview && ++peek_count >= 64) {
+      peek_count = 0;
+      if (char_avail()) {
+        break;
+      }
+    }
   }
+  (void)sub_batch_flush(&batch);
+  if (record_known && !got_quit && !aborting()) {
+    sub_preview_known_set(pat, regmatch.rmm_ic, first_lnum, searched, &known);
+  }
+  kv_destroy(known);
 
   if (first_line != 0) {
     /* Need to subtract the number of added lines from "last_line" to get
@@ -4043,12 +4226,23 @@ skip:
     changed_lines(first_line, 0, last_line - i, i, false);
 
     if (kv_size(curbuf->update_channels)) {
-      int64_t num_added = last_line - first_line;
-      int64_t num_removed = num_added - i;
-      buf_updates_send_changes(curbuf, first_line, num_added, num_removed,
-                               do_buf_event);
+      if (batch.only_batched) {
+        // Only send the lines that changed, not all lines in between.
+        for (size_t j = 0; j < kv_size(batch.ranges); j++) {
+          SubRange range = kv_A(batch.ranges, j);
+          buf_updates_send_changes(curbuf, range.lnum, range.count,
+                                   range.count, do_buf_event);
+        }
+      } else {
+        int64_t num_added = last_line - first_line;
+        int64_t num_removed = num_added - i;
+        buf_updates_send_changes(curbuf, first_line, num_added, num_removed,
+                                 do_buf_event);
+      }
     }
   }
+  kv_destroy(batch.lines);
+  kv_destroy(batch.ranges);
 
   xfree(sub_firstline);   /* may have to free allocated copy of the line */
 
@@ -4186,6 +4380,187 @@ do_sub_msg (
   return false;
 }
 
+/// Check if the lines in "sub_preview_known" can be used to skip lines that
+/// can't match "pat".
+static bool sub_preview_known_usable(const char_u *pat, bool ic)
+{
+  return sub_preview_known.pat != NULL && pat != NULL && *pat != NUL
+         && sub_preview_known.buf_handle == curbuf->handle
+         && sub_preview_known.changedtick == buf_get_changedtick(curbuf)
+         && (sub_preview_known.ic || !ic)
+         && (STRCMP(sub_preview_known.pat, pat) == 0
+             || search_pat_narrows(sub_preview_known.pat, pat));
+}
+
+/// Remember that only "lines" may match "pat" from line "first" to "last".
+/// Takes over the items of "lines".
+static void sub_preview_known_set(const char_u *pat, bool ic, linenr_T first,
+                                  linenr_T last, LinenrVec *lines)
+{
+  xfree(sub_preview_known.pat);
+  sub_preview_known.pat = vim_strsave(pat);
+  sub_preview_known.ic = ic;
+  sub_preview_known.buf_handle = curbuf->handle;
+  sub_preview_known.changedtick = buf_get_changedtick(curbuf);
+  sub_preview_known.first = first;
+  sub_preview_known.last = last;
+  kv_destroy(sub_preview_known.lines);
+  sub_preview_known.lines = *lines;
+  kv_init(*lines);
+}
+
+/// Lines marked for global_exe() by ":global" and ":folddo".  Sorted and
+/// adjusted by mark_adjust() when lines are inserted or deleted.
+static struct {
+  handle_T buf_handle;       ///< buffer the lines are in
+  kvec_t(linenr_T) lines;    ///< line numbers, "offset" is to be added
+  size_t next;               ///< index of the first line that is marked
+  linenr_T offset;           ///< added to every item in "lines"
+} global_marks = { 0, KV_INITIAL_VALUE, 0, 0 };
+
+/// Mark line "lnum" in the current buffer for global_exe().  Fastest when
+/// lines are marked from top to bottom.
+void global_mark_line(linenr_T lnum)
+{
+  if (global_marks.buf_handle != curbuf->handle) {
+    global_clear_marks();
+    global_marks.buf_handle = curbuf->handle;
+  }
+  global_marks_insert(lnum);
+}
+
+/// Clear the marks set with global_mark_line().
+void global_clear_marks(void)
+{
+  kv_destroy(global_marks.lines);
+  kv_init(global_marks.lines);
+  global_marks.buf_handle = 0;
+  global_marks.next = 0;
+  global_marks.offset = 0;
+}
+
+/// Remove the mark from the first marked line and return its number.
+///
+/// @return  0 when no line in the current buffer is marked.
+static linenr_T global_next_marked(void)
+{
+  if (global_marks.buf_handle != curbuf->handle
+      || global_marks.next >= kv_size(global_marks.lines)) {
+    return 0;
+  }
+  return kv_A(global_marks.lines, global_marks.next++) + global_marks.offset;
+}
+
+/// Index of the first marked line below "lnum".
+static size_t global_marks_after(linenr_T lnum)
+{
+  size_t lo = global_marks.next;
+  size_t hi = kv_size(global_marks.lines);
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (kv_A(global_marks.lines, mid) + global_marks.offset <= lnum) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static void global_marks_insert(linenr_T lnum)
+{
+  size_t idx = global_marks_after(lnum);
+
+  kv_push(global_marks.lines, 0);
+  linenr_T *lines = global_marks.lines.items;
+  memmove(lines + idx + 1, lines + idx,
+          (kv_size(global_marks.lines) - idx - 1) * sizeof(*lines));
+  lines[idx] = lnum - global_marks.offset;
+}
+
+/// Add "amount" to the marked lines from index "idx" to the end.  Updates the
+/// marks on the smaller side and "offset" when that is above "idx".
+static void global_marks_shift(size_t idx, linenr_T amount)
+{
+  size_t next = global_marks.next;
+  size_t size = kv_size(global_marks.lines);
+  linenr_T *lines = global_marks.lines.items;
+
+  if (idx - next < size - idx) {
+    global_marks.offset += amount;
+    for (size_t i = next; i < idx; i++) {
+      lines[i] -= amount;
+    }
+  } else {
+    for (size_t i = idx; i < size; i++) {
+      lines[i] += amount;
+    }
+  }
+}
+
+/// Remove the marks with index "lo" to "hi", closing the gap from the
+/// smaller side.
+static void global_marks_remove(size_t lo, size_t hi)
+{
+  size_t next = global_marks.next;
+  size_t size = kv_size(global_marks.lines);
+  linenr_T *lines = global_marks.lines.items;
+  size_t n = hi - lo;
+
+  if (lo - next < size - hi) {
+    memmove(lines + next + n, lines + next, (lo - next) * sizeof(*lines));
+    global_marks.next += n;
+  } else {
+    memmove(lines + lo, lines + hi, (size - hi) * sizeof(*lines));
+    kv_size(global_marks.lines) -= n;
+  }
+}
+
+/// Adjust the marked lines: lines "line1" to "line2" move by "amount",
+/// they are deleted when "amount" is MAXLNUM.  Lines below "line2" move by
+/// "amount_after".  Called by mark_adjust().
+/// Only the marks on the smaller side of the change are updated, so that
+/// changing lines one by one while going through the marks is fast.
+/// Commands that move lines, such as ":move", first remove the marks from
+/// them: like in Vim the moved lines are new lines.
+void global_marks_adjust(linenr_T line1, linenr_T line2, long amount,
+                         long amount_after)
+{
+  size_t next = global_marks.next;
+  size_t size = kv_size(global_marks.lines);
+  linenr_T *lines = global_marks.lines.items;
+
+  if (global_marks.buf_handle != curbuf->handle || next >= size) {
+    return;
+  }
+  size_t hi = global_marks_after(line2);
+  size_t lo = line2 < line1 ? hi : global_marks_after(line1 - 1);
+
+  if (amount_after != 0) {
+    global_marks_shift(hi, (linenr_T)amount_after);
+  }
+
+  if (hi == lo || amount == 0) {
+    return;
+  }
+  if (amount == MAXLNUM) {
+    global_marks_remove(lo, hi);
+  } else if (hi == size) {
+    global_marks_shift(lo, (linenr_T)amount);
+  } else if (amount > 0
+             ? lines[hi] + global_marks.offset > line2 + amount
+             : (lo == next
+                || lines[lo - 1] + global_marks.offset < line1 + amount)) {
+    // The lines keep their place among the other marked lines.
+    for (size_t i = lo; i < hi; i++) {
+      lines[i] += (linenr_T)amount;
+    }
+  } else {
+    global_marks_remove(lo, hi);
+  }
+}
+
 static void global_exe_one(char_u *const cmd, const linenr_T lnum)
 {
   curwin->w_cursor.lnum = lnum;
@@ -4294,7 +4669,7 @@ void ex_global(exarg_T *eap)
       match = vim_regexec_multi(&regmatch, curwin, curbuf, lnum,
                                 (colnr_T)0, NULL);
       if ((type == 'g' && match) || (type == 'v' && !match)) {
-        ml_setmarked(lnum);
+        global_mark_line(lnum);
         ndone++;
       }
       line_breakcheck();
@@ -4312,12 +4687,12 @@ void ex_global(exarg_T *eap)
     } else {
       global_exe(cmd);
     }
-    ml_clearmarked();         // clear rest of the marks
+    global_clear_marks();     // clear rest of the marks
   }
   vim_regfree(regmatch.regprog);
 }
 
-/// Execute `cmd` on lines marked with ml_setmarked().
+/// Execute `cmd` on lines marked with global_mark_line().
 void global_exe(char_u *cmd)
 {
   linenr_T old_lcount;      // b_ml.ml_line_count before the command
@@ -4341,7 +4716,7 @@ void global_exe(char_u *cmd)
   global_busy = 1;
   old_lcount = curbuf->b_ml.ml_line_count;
 
-  while (!got_int && (lnum = ml_firstmarked()) != 0 && global_busy == 1) {
+  while (!got_int && (lnum = global_next_marked()) != 0 && global_busy == 1) {
     global_exe_one(cmd, lnum);
     os_breakcheck();
   }
@@ -4377,6 +4752,9 @@ void global_exe(char_u *cmd)
 void free_old_sub(void)
 {
   sub_set_replacement((SubReplacementString) {NULL, 0, NULL});
+  xfree(sub_preview_known.pat);
+  sub_preview_known.pat = NULL;
+  kv_destroy(sub_preview_known.lines);
 }
 
 #endif
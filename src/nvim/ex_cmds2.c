@@ -995,6 +995,7 @@ void profile_dump(void)
     } else {
       script_dump_profile(fd);
       func_dump_profile(fd);
+      stl_expr_dump_profile(fd);
       fclose(fd);
     }
   }
@@ -1056,6 +1057,8 @@ static void profile_reset(void)
     }
   }
 
+  stl_expr_profile_reset();
+
   xfree(profile_fname);
   profile_fname = NULL;
 }
@@ -7196,6 +7196,9 @@ void post_chdir(CdScope scope)
     }
   }
 
+  // %{} items in 'statusline' may use getcwd().
+  stl_expr_invalidate();
+
   char cwd[MAXPATHL];
   if (os_dirname((char_u *)cwd, MAXPATHL) != OK) {
     return;
@@ -7780,6 +7783,8 @@ static void ex_redrawstatus(exarg_T *eap)
 
   RedrawingDisabled = 0;
   p_lz = FALSE;
+  // Items are evaluated again, in case they depend on external state.
+  stl_expr_invalidate();
   if (eap->forceit)
     status_redraw_all();
   else
@@ -9954,12 +9959,12 @@ static void ex_folddo(exarg_T *eap)
   // First set the marks for all lines closed/open.
   for (linenr_T lnum = eap->line1; lnum <= eap->line2; ++lnum) {
     if (hasFolding(lnum, NULL, NULL) == (eap->cmdidx == CMD_folddoclosed)) {
-      ml_setmarked(lnum);
+      global_mark_line(lnum);
     }
   }
 
   global_exe(eap->arg);  // Execute the command on the marked lines.
-  ml_clearmarked();      // clear rest of the marks
+  global_clear_marks();  // clear rest of the marks
 }
 
 static void ex_terminal(exarg_T *eap)
@@ -164,6 +164,11 @@ typedef struct command_line_state {
   pos_T     match_end;
   int did_incsearch;
   int incsearch_postponed;
+  // The previous 'incsearch' search, a longer pattern continues from there.
+  char_u   *is_prev_pat;                // pattern, NULL when not usable
+  pos_T     is_prev_start;              // "search_start" it was used with
+  pos_T     is_prev_match;              // match position, lnum 0 for none
+  varnumber_T is_prev_tick;             // b:changedtick at the time
   int did_wild_list;                    // did wild_list() recently
   int wim_index;                        // index in wim_flags[]
   int res;
@@ -488,6 +493,7 @@ static uint8_t *command_line_enter(int firstc, long count, int indent)
   setmouse();
   ui_cursor_shape();            // may show different cursor shape
   xfree(s->save_p_icm);
+  xfree(s->is_prev_pat);
   xfree(ccline.last_colors.cmdbuff);
   kv_destroy(ccline.last_colors.colors);
 
@@ -1788,6 +1794,46 @@ static int command_line_not_changed(CommandLineState *s)
   return command_line_changed(s);
 }
 
+/// Check if the 'incsearch' search for the command line can continue where
+/// the previous one found a match, because the pattern only got longer.
+static bool incsearch_narrows(CommandLineState *s)
+{
+  return s->is_prev_pat != NULL
+         && s->count == 1
+         && equalpos(s->is_prev_start, s->search_start)
+         && s->is_prev_tick == buf_get_changedtick(curbuf)
+         && *skip_regexp(ccline.cmdbuff, s->firstc, p_magic, NULL) == NUL
+         && search_pat_narrows(s->is_prev_pat, ccline.cmdbuff);
+}
+
+/// Remember the result of an 'incsearch' search for incsearch_narrows().
+/// "complete" is false when the search was cut short.
+static void incsearch_remember(CommandLineState *s, bool complete)
+{
+  xfree(s->is_prev_pat);
+  s->is_prev_pat = NULL;
+  if (!complete || s->count != 1
+      || *skip_regexp(ccline.cmdbuff, s->firstc, p_magic, NULL) != NUL) {
+    return;
+  }
+  if (s->i == 0) {
+    // Only remember that there is no match for a valid pattern.
+    emsg_off++;
+    regprog_T *prog = vim_regcomp(ccline.cmdbuff, p_magic ? RE_MAGIC : 0);
+    emsg_off--;
+    if (prog == NULL) {
+      return;
+    }
+    vim_regfree(prog);
+    clearpos(&s->is_prev_match);
+  } else {
+    s->is_prev_match = curwin->w_cursor;
+  }
+  s->is_prev_pat = vim_strsave(ccline.cmdbuff);
+  s->is_prev_start = s->search_start;
+  s->is_prev_tick = buf_get_changedtick(curbuf);
+}
+
 /// Guess that the pattern matches everything.  Only finds specific cases, such
 /// as a trailing \|, which can happen while typing a pattern.
 static int empty_pattern(char_u *p)
@@ -1825,6 +1871,7 @@ static int command_line_changed(CommandLineState *s)
       redraw_all_later(SOME_VALID);
     } else {
       int search_flags = SEARCH_OPT + SEARCH_NOOF + SEARCH_PEEK;
+      bool narrows = incsearch_narrows(s);
       ui_busy_start();
       ui_flush();
       ++emsg_off;            // So it doesn't beep if bad expr
@@ -1833,10 +1880,25 @@ static int command_line_changed(CommandLineState *s)
       if (!p_hls) {
         search_flags += SEARCH_KEEP;
       }
-      s->i = do_search(NULL, s->firstc, ccline.cmdbuff, s->count,
-                       search_flags,
-                       &tm);
+      if (narrows && s->is_prev_match.lnum == 0) {
+        // The shorter pattern didn't match anywhere.  Still use the pattern
+        // for 'hlsearch', like do_search() does.
+        s->i = 0;
+        if (!(search_flags & SEARCH_KEEP) && !cmdmod.keeppatterns) {
+          save_re_pat(RE_SEARCH, ccline.cmdbuff, p_magic);
+        }
+      } else {
+        if (narrows) {
+          // No match before where the shorter pattern matched.
+          curwin->w_cursor = s->is_prev_match;
+          search_flags += SEARCH_START;
+        }
+        s->i = do_search(NULL, s->firstc, ccline.cmdbuff, s->count,
+                         search_flags,
+                         &tm);
+      }
       emsg_off--;
+      bool complete = !got_int && !profile_passed_limit(tm);
       // if interrupted while searching, behave like it failed
       if (got_int) {
         (void)vpeekc();               // remove <C-C> from input stream
@@ -1845,7 +1907,9 @@ static int command_line_changed(CommandLineState *s)
       } else if (char_avail()) {
         // cancelled searching because a char was typed
         s->incsearch_postponed = true;
+        complete = false;
       }
+      incsearch_remember(s, complete);
       ui_busy_stop();
     }
 
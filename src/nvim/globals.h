@@ -81,7 +81,15 @@ typedef enum {
 EXTERN struct nvim_stats_s {
   int64_t fsync;
   int64_t redraw;
-} g_stats INIT(= { 0, 0 });
+  int64_t redraw_time;  // nanoseconds spent in update_screen()
+  int64_t ui_events;    // events queued for remote UIs
+  int64_t ui_frames;    // "redraw" notifications sent to remote UIs
+  int64_t ui_bytes;     // size of those notifications
+  int64_t regprog_hits;       // vim_regcomp() found the program in the cache
+  int64_t regprog_misses;     // vim_regcomp() had to compile the pattern
+  int64_t regprog_evictions;  // programs dropped from the full cache
+  int64_t syn_idle_lines;     // lines parsed by syntax_idle_work()
+} g_stats INIT(= { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
 
 /* Values for "starting" */
 #define NO_SCREEN       2       /* no screen updating yet */
@@ -198,4 +198,11 @@
 # define IO_COUNT(x)  (x)
 #endif
 
+// Storage class of variables that have one instance per thread.
+#if defined(_MSC_VER)
+# define NVIM_THREAD_LOCAL __declspec(thread)
+#else
+# define NVIM_THREAD_LOCAL __thread
+#endif
+
 #endif  // NVIM_MACROS_H
@@ -928,6 +928,9 @@ static void mark_adjust_internal(linenr_T line1, linenr_T line2,
   if (line2 < line1 && amount_after == 0L)          /* nothing to do */
     return;
 
+  // lines marked by ":global", also with ":lockmarks"
+  global_marks_adjust(line1, line2, amount, amount_after);
+
   if (!cmdmod.lockmarks) {
     /* named marks, lower case and upper case */
     for (i = 0; i < NMARKS; i++) {
@@ -60,6 +60,9 @@
 
 #define MEMFILE_PAGE_SIZE 4096       /// default page size
 
+/// Incremented when mf_release_all() frees blocks.
+static uint64_t release_count = 0;
+
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "memfile.c.generated.h"
@@ -502,6 +505,7 @@ bool mf_release_all(void)
             mf_free_bhdr(hp);
             hp = mfp->mf_used_last;    // restart, list was changed
             retval = true;
+            release_count++;
           } else {
             hp = hp->bh_prev;
           }
@@ -512,6 +516,13 @@ bool mf_release_all(void)
   return retval;
 }
 
+/// Get the number of times mf_release_all() freed blocks.  Pointers into
+/// blocks that are not locked are invalid after it changed.
+uint64_t mf_release_count(void)
+{
+  return release_count;
+}
+
 /// Allocate a block header and a block of memory for it.
 static bhdr_T *mf_alloc_bhdr(memfile_T *mfp, unsigned page_count)
 {
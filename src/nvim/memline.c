@@ -212,14 +212,6 @@ struct block0 {
 
 #define STACK_INCR      5       /* nr of entries added to ml_stack at a time */
 
-/*
- * The line number where the first mark may be is remembered.
- * If it is 0 there are no marks at all.
- * (always used for the current buffer only, no buffer change possible while
- * executing a global command).
- */
-static linenr_T lowest_marked = 0;
-
 /*
  * arguments for ml_find_line()
  */
@@ -1794,6 +1786,62 @@ errorret:
   return buf->b_ml.ml_line_ptr;
 }
 
+/// Like ml_get_buf(), and also get pointers to all lines of the data block
+/// that contains line "lnum", to read a run of lines without looking up each
+/// of them.  "block" is empty when the lines are not in a data block.
+///
+/// Use ml_block_valid() before using "block" again after other memline
+/// functions were called.  Not valid anymore after the buffer was changed.
+char_u *ml_get_block(buf_T *buf, linenr_T lnum, mllines_T *block)
+{
+  char_u *line = ml_get_buf(buf, lnum, false);
+
+  block->buf = buf;
+  block->low = 1;
+  block->high = 0;
+  // ml_get_buf() doesn't lock the block of the cached line.
+  bhdr_T *hp = buf->b_ml.ml_locked;
+  if (hp == NULL || lnum < buf->b_ml.ml_locked_low
+      || lnum > buf->b_ml.ml_locked_high) {
+    return line;
+  }
+
+  DATA_BL *dp = hp->bh_data;
+  size_t count = (size_t)(buf->b_ml.ml_locked_high
+                          - buf->b_ml.ml_locked_low + 1);
+  if (block->size < count) {
+    block->lines = xrealloc(block->lines, count * sizeof(char_u *));
+    block->size = count;
+  }
+  for (size_t i = 0; i < count; i++) {
+    block->lines[i] = (char_u *)dp + (dp->db_index[i] & DB_INDEX_MASK);
+  }
+  block->low = buf->b_ml.ml_locked_low;
+  block->high = buf->b_ml.ml_locked_high;
+  block->release_count = mf_release_count();
+
+  // A changed line is kept in allocated memory until it's flushed.
+  block->dirty_lnum = 0;
+  if (buf->b_ml.ml_flags & ML_LINE_DIRTY) {
+    block->lines[lnum - block->low] = line;
+    block->dirty_lnum = lnum;
+  }
+  return line;
+}
+
+/// Check if the pointers in "block" can still be used: no blocks were freed
+/// for lack of memory and the changed line wasn't flushed, which moves the
+/// other lines.
+bool ml_block_valid(const mllines_T *block)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const memline_T *ml = &block->buf->b_ml;
+  return block->release_count == mf_release_count()
+         && (block->dirty_lnum == 0
+             || (ml->ml_line_lnum == block->dirty_lnum
+                 && (ml->ml_flags & ML_LINE_DIRTY)));
+}
+
 /*
  * Check if a line that was just obtained by a call to ml_get
  * is in allocated memory.
@@ -1881,9 +1929,6 @@ ml_append_int (
   if (lnum > buf->b_ml.ml_line_count || buf->b_ml.ml_mfp == NULL)
     return FAIL;
 
-  if (lowest_marked && lowest_marked > lnum)
-    lowest_marked = lnum + 1;
-
   if (len == 0)
     len = (colnr_T)STRLEN(line) + 1;            /* space needed for the text */
   space_needed = len + INDEX_SIZE;      /* space needed for text + index */
@@ -2336,6 +2381,101 @@ int ml_replace(linenr_T lnum, char_u *line, bool copy)
   return OK;
 }
 
+/// Replace "count" lines starting at "lnum" in the current buffer with the
+/// allocated strings in "lines", which are freed.  Faster than calling
+/// ml_replace() for every line: the text in each data block is moved only
+/// once.
+///
+/// @note The caller of this function should probably also call
+/// changed_lines() after this.
+///
+/// @return FAIL for failure, OK otherwise
+int ml_replace_lines(linenr_T lnum, char_u **lines, long count)
+{
+  buf_T *buf = curbuf;
+  long done = 0;
+
+  // When starting up, we might still need to create the memfile
+  if (buf->b_ml.ml_mfp == NULL && open_buffer(false, NULL, 0) == FAIL) {
+    goto fail;
+  }
+  ml_flush_line(buf);
+
+  while (done < count) {
+    linenr_T first_lnum = lnum + (linenr_T)done;
+
+    if (buf->b_ml.ml_line_count == 1) {
+      // ml_updatechunk() needs the line in ml_line_ptr.
+      ml_replace(first_lnum, lines[done++], false);
+      ml_flush_line(buf);
+      continue;
+    }
+
+    bhdr_T *hp = ml_find_line(buf, first_lnum, ML_FIND);
+    if (hp == NULL) {
+      IEMSGN(_("E320: Cannot find line %" PRId64), first_lnum);
+      goto fail;
+    }
+    DATA_BL *dp = hp->bh_data;
+    int nlines = buf->b_ml.ml_locked_high - buf->b_ml.ml_locked_low + 1;
+    int first = first_lnum - buf->b_ml.ml_locked_low;
+    int last = (int)MIN(nlines - 1, first + count - done - 1);
+    // The text of a line ends where the text of the line before it starts.
+    unsigned end = first == 0 ? dp->db_txt_end
+                              : (dp->db_index[first - 1] & DB_INDEX_MASK);
+    unsigned last_start = dp->db_index[last] & DB_INDEX_MASK;
+    long extra = -(long)(end - last_start);
+
+    for (int idx = first; idx <= last; idx++) {
+      extra += (long)STRLEN(lines[done + idx - first]) + 1;
+    }
+
+    if (extra > (long)dp->db_free) {
+      // Doesn't fit in this data block, let ml_flush_line() split it.
+      ml_replace(first_lnum, lines[done++], false);
+      ml_flush_line(buf);
+      continue;
+    }
+
+    // Move the text of the lines below the replaced ones.
+    if (extra != 0 && last < nlines - 1) {
+      memmove((char *)dp + dp->db_txt_start - extra,
+              (char *)dp + dp->db_txt_start,
+              (size_t)(last_start - dp->db_txt_start));
+      for (int idx = last + 1; idx < nlines; idx++) {
+        dp->db_index[idx] -= (unsigned)extra;
+      }
+    }
+    dp->db_free -= (unsigned)extra;
+    dp->db_txt_start -= (unsigned)extra;
+
+    // Copy the new lines into the data block, the first one at the end.
+    unsigned old_end = end;
+    for (int idx = first; idx <= last; idx++) {
+      char_u *line = lines[done++];
+      unsigned old_start = dp->db_index[idx] & DB_INDEX_MASK;
+      unsigned len = (unsigned)STRLEN(line) + 1;
+
+      end -= len;
+      memmove((char *)dp + end, line, len);
+      dp->db_index[idx] = end | (dp->db_index[idx] & DB_MARKED);
+      ml_updatechunk(buf, first_lnum + idx - first,
+                     (long)len - (long)(old_end - old_start), ML_CHNK_UPDLINE);
+      old_end = old_start;
+      xfree(line);
+    }
+    buf->b_ml.ml_flags |= (ML_LOCKED_DIRTY | ML_LOCKED_POS);
+  }
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+  return OK;
+
+fail:
+  while (done < count) {
+    xfree(lines[done++]);
+  }
+  return FAIL;
+}
+
 /// Delete line `lnum` in the current buffer.
 ///
 /// @note The caller of this function should probably also call
@@ -2367,9 +2507,6 @@ static int ml_delete_int(buf_T *buf, linenr_T lnum, int message)
   if (lnum < 1 || lnum > buf->b_ml.ml_line_count)
     return FAIL;
 
-  if (lowest_marked && lowest_marked > lnum)
-    lowest_marked--;
-
   /*
    * If the file becomes empty the last line is replaced by an empty line.
    */
@@ -2487,114 +2624,6 @@ static int ml_delete_int(buf_T *buf, linenr_T lnum, int message)
   return OK;
 }
 
-/*
- * set the B_MARKED flag for line 'lnum'
- */
-void ml_setmarked(linenr_T lnum)
-{
-  bhdr_T    *hp;
-  DATA_BL *dp;
-  /* invalid line number */
-  if (lnum < 1 || lnum > curbuf->b_ml.ml_line_count
-      || curbuf->b_ml.ml_mfp == NULL)
-    return;                         /* give error message? */
-
-  if (lowest_marked == 0 || lowest_marked > lnum)
-    lowest_marked = lnum;
-
-  /*
-   * find the data block containing the line
-   * This also fills the stack with the blocks from the root to the data block
-   * This also releases any locked block.
-   */
-  if ((hp = ml_find_line(curbuf, lnum, ML_FIND)) == NULL)
-    return;                 /* give error message? */
-
-  dp = hp->bh_data;
-  dp->db_index[lnum - curbuf->b_ml.ml_locked_low] |= DB_MARKED;
-  curbuf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
-}
-
-/*
- * find the first line with its B_MARKED flag set
- */
-linenr_T ml_firstmarked(void)
-{
-  bhdr_T      *hp;
-  DATA_BL     *dp;
-  linenr_T lnum;
-  int i;
-
-  if (curbuf->b_ml.ml_mfp == NULL)
-    return (linenr_T) 0;
-
-  /*
-   * The search starts with lowest_marked line. This is the last line where
-   * a mark was found, adjusted by inserting/deleting lines.
-   */
-  for (lnum = lowest_marked; lnum <= curbuf->b_ml.ml_line_count; ) {
-    /*
-     * Find the data block containing the line.
-     * This also fills the stack with the blocks from the root to the data
-     * block This also releases any locked block.
-     */
-    if ((hp = ml_find_line(curbuf, lnum, ML_FIND)) == NULL)
-      return (linenr_T)0;                   /* give error message? */
-
-    dp = hp->bh_data;
-
-    for (i = lnum - curbuf->b_ml.ml_locked_low;
-         lnum <= curbuf->b_ml.ml_locked_high; ++i, ++lnum)
-      if ((dp->db_index[i]) & DB_MARKED) {
-        (dp->db_index[i]) &= DB_INDEX_MASK;
-        curbuf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
-        lowest_marked = lnum + 1;
-        return lnum;
-      }
-  }
-
-  return (linenr_T) 0;
-}
-
-/*
- * clear all DB_MARKED flags
- */
-void ml_clearmarked(void)
-{
-  bhdr_T      *hp;
-  DATA_BL     *dp;
-  linenr_T lnum;
-  int i;
-
-  if (curbuf->b_ml.ml_mfp == NULL)          /* nothing to do */
-    return;
-
-  /*
-   * The search starts with line lowest_marked.
-   */
-  for (lnum = lowest_marked; lnum <= curbuf->b_ml.ml_line_count; ) {
-    /*
-     * Find the data block containing the line.
-     * This also fills the stack with the blocks from the root to the data
-     * block and releases any locked block.
-     */
-    if ((hp = ml_find_line(curbuf, lnum, ML_FIND)) == NULL)
-      return;                   /* give error message? */
-
-    dp = hp->bh_data;
-
-    for (i = lnum - curbuf->b_ml.ml_locked_low;
-         lnum <= curbuf->b_ml.ml_locked_high; ++i, ++lnum)
-      if ((dp->db_index[i]) & DB_MARKED) {
-        (dp->db_index[i]) &= DB_INDEX_MASK;
-        curbuf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
-      }
-  }
-
-  lowest_marked = 0;
-  return;
-}
-
 /*
  * flush ml_line if necessary
  */
@@ -5,6 +5,17 @@
 #include "nvim/pos.h" // for pos_T, linenr_T, colnr_T
 #include "nvim/buffer_defs.h" // for buf_T
 
+/// Pointers to the lines of one data block, see ml_get_block().
+typedef struct {
+  buf_T *buf;               ///< buffer the lines are in
+  linenr_T low;             ///< first line in "lines"
+  linenr_T high;            ///< last line in "lines", below "low" when empty
+  linenr_T dirty_lnum;      ///< line in "lines" that is "ml_line_ptr" or 0
+  uint64_t release_count;   ///< mf_release_count() when filled
+  char_u **lines;           ///< lines[i] is the text of line "low + i"
+  size_t size;              ///< allocated length of "lines"
+} mllines_T;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "memline.h.generated.h"
 #endif
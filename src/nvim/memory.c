@@ -655,6 +655,7 @@ void free_all_mem(void)
 
   /* Destroy all windows.  Must come before freeing buffers. */
   win_free_all();
+  stl_expr_free_all();
 
   // Free all option values.  Must come after closing windows.
   free_all_options();
@@ -2066,6 +2066,8 @@ static void changed_common(linenr_T lnum, colnr_T col, linenr_T lnume, long xtra
 
   FOR_ALL_TAB_WINDOWS(tp, wp) {
     if (wp->w_buffer == curbuf) {
+      vcol_index_changed(wp, lnum, col, lnume, xtra);
+
       /* Mark this window to be redrawn later. */
       if (wp->w_redr_type < VALID)
         wp->w_redr_type = VALID;
@@ -109,6 +109,26 @@ bool rpc_send_event(uint64_t id, const char *name, Array args)
   return true;
 }
 
+/// Sends an already serialized msgpack-rpc message to a channel.
+///
+/// @param id The channel id
+/// @param data Serialized message, ownership is transferred (freed with xfree)
+/// @param size Size of `data`
+/// @return True if the message was written
+bool rpc_send_raw(uint64_t id, char *data, size_t size)
+{
+  Channel *channel = find_rpc_channel(id);
+  if (!channel) {
+    xfree(data);
+    return false;
+  }
+#if MIN_LOG_LEVEL <= DEBUG_LOG_LEVEL
+  msgpack_sbuffer sbuffer = { .size = size, .data = data, .alloc = size };
+  log_server_msg(channel->id, &sbuffer);
+#endif
+  return channel_write(channel, wstream_new_buffer(data, size, 1, xfree));
+}
+
 /// Sends a method call to a channel
 ///
 /// @param id The channel id
@@ -2203,17 +2203,27 @@ void check_buf_options(buf_T *buf)
  */
 void free_string_option(char_u *p)
 {
+  string_option_tick++;
   if (p != empty_option)
     xfree(p);
 }
 
 void clear_string_option(char_u **pp)
 {
+  string_option_tick++;
   if (*pp != empty_option)
     xfree(*pp);
   *pp = empty_option;
 }
 
+/// Get a number that changes when a string option is set or the value of one
+/// is freed.  Caches that keep pointers to option values compare it, because
+/// a new value may be allocated where a freed one was.
+uint64_t get_string_option_tick(void)
+{
+  return string_option_tick;
+}
+
 static void check_string_option(char_u **pp)
 {
   if (*pp == NULL)
@@ -2268,6 +2278,9 @@ static void redraw_titles(void) {
 
 static int shada_idx = -1;
 
+// Incremented when a string option is set or its value freed.
+static uint64_t string_option_tick = 0;
+
 /*
  * Set a string option to a new value (without checking the effect).
  * The string is copied into allocated memory.
@@ -2436,6 +2449,9 @@ did_set_string_option (
   bool free_oldval = (options[opt_idx].flags & P_ALLOCED);
   int ft_changed = false;
 
+  stl_expr_invalidate();
+  string_option_tick++;
+
   /* Get the global option to compare with, otherwise we would have to check
    * two values for all local options. */
   gvarp = (char_u **)get_varp_scope(&(options[opt_idx]), OPT_GLOBAL);
@@ -3682,6 +3698,7 @@ static char *set_bool_option(const int opt_idx, char_u *const varp,
     return (char *)e_secure;
   }
 
+  stl_expr_invalidate();
   *(int *)varp = value;             /* set the new value */
   /* Remember where the option was set. */
   set_option_scriptID_idx(opt_idx, opt_flags, current_SID);
@@ -4070,6 +4087,8 @@ static char *set_num_option(int opt_idx, char_u *varp, long value,
   long old_Columns = Columns;           /* remember old Columns */
   long        *pp = (long *)varp;
 
+  stl_expr_invalidate();
+
   /* Disallow changing some options from secure mode. */
   if ((secure || sandbox != 0)
       && (options[opt_idx].flags & P_SECURE)) {
@@ -4135,7 +4154,7 @@ static char *set_num_option(int opt_idx, char_u *varp, long value,
       errmsg = e_invarg;
     }
   } else if (pp == &p_re) {
-    if (value < 0 || value > 2) {
+    if (value < 0 || value > 3) {
       errmsg = e_invarg;
     }
   } else if (pp == &p_report) {
@@ -22,7 +22,9 @@
 #include "nvim/getchar.h"
 #include "nvim/main.h"
 #include "nvim/misc1.h"
+#include "nvim/search.h"
 #include "nvim/state.h"
+#include "nvim/syntax.h"
 #include "nvim/msgpack_rpc/channel.h"
 
 #define READ_BUFFER_SIZE 0xfff
@@ -107,7 +109,7 @@ int os_inchar(uint8_t *buf, int maxlen, int ms, int tb_change_cnt)
       return 0;
     }
   } else {
-    if ((result = inbuf_poll((int)p_ut)) == kInputNone) {
+    if ((result = inbuf_poll_idle((int)p_ut)) == kInputNone) {
       if (read_stream.closed && silent_mode) {
         // Drained eventloop & initial input; exit silent/batch-mode (-es/-Es).
         read_error_exit();
@@ -381,6 +383,30 @@ static InbufPollResult inbuf_poll(int ms)
   return input_eof ? kInputEof : kInputNone;
 }
 
+/// Like inbuf_poll(), but use the time until input arrives for idle work:
+/// counting search matches and precomputing syntax states, in slices with a
+/// check for input before each of them.
+static InbufPollResult inbuf_poll_idle(int ms)
+{
+  const uint64_t deadline = os_hrtime() + (uint64_t)ms * 1000000;
+  for (;;) {
+    // Input that arrived while the last command was executed is handled
+    // before doing any work.
+    InbufPollResult result = inbuf_poll(0);
+    if (result != kInputNone) {
+      return result;
+    }
+    if (!search_count_idle_work() && !syntax_idle_work()) {
+      break;
+    }
+    if (os_hrtime() >= deadline) {
+      return kInputNone;
+    }
+  }
+  const uint64_t now = os_hrtime();
+  return inbuf_poll(now >= deadline ? 0 : (int)((deadline - now) / 1000000));
+}
+
 static void input_read_cb(Stream *stream, RBuffer *buf, size_t c, void *data,
                           bool at_eof)
 {
@@ -14,6 +14,7 @@
 # include "os/env.h.generated.h"
 # include "os/users.h.generated.h"
 # include "os/stdpaths.h.generated.h"
+# include "os/shm.h.generated.h"
 #endif
 
 #endif  // NVIM_OS_OS_H
@@ -0,0 +1,83 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// shm.c -- shared memory mappings, backed by a file in the Nvim tempdir so
+// that another process can map it by path.
+
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "auto/config.h"
+
+#ifdef UNIX
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "nvim/os/os.h"
+#include "nvim/fileio.h"
+#include "nvim/log.h"
+#include "nvim/memory.h"
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "os/shm.c.generated.h"
+#endif
+
+/// Creates a file of `size` zeroed bytes and maps it shared and writable.
+///
+/// @param size  Size of the mapping.
+/// @param[out] path  Allocated path of the file, to be passed to the other
+///                   process. Set to NULL on failure.
+///
+/// @return Address of the mapping, or NULL on failure or if shared memory is
+///         not supported on this platform.
+void *os_shm_create(size_t size, char **path)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  *path = NULL;
+#ifdef UNIX
+  char *name = (char *)vim_tempname();
+  if (!name) {
+    return NULL;
+  }
+  int fd = open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    ELOG("open(%s) failed: %s", name, strerror(errno));
+    xfree(name);
+    return NULL;
+  }
+  void *addr = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0) {
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (addr == MAP_FAILED) {
+    ELOG("mapping %s failed: %s", name, strerror(errno));
+    close(fd);
+    os_remove(name);
+    xfree(name);
+    return NULL;
+  }
+  close(fd);  // The mapping keeps the file open.
+  *path = name;
+  return addr;
+#else
+  return NULL;
+#endif
+}
+
+/// Unmaps and deletes a mapping created by os_shm_create(). The other process
+/// may keep its own mapping of the file.
+void os_shm_destroy(void *addr, size_t size, char *path)
+{
+#ifdef UNIX
+  if (addr) {
+    munmap(addr, size);
+  }
+  if (path) {
+    os_remove(path);
+  }
+#endif
+  xfree(path);
+}
@@ -41,6 +41,7 @@
 #include "nvim/search.h"
 #include "nvim/strings.h"
 #include "nvim/ui.h"
+#include "nvim/vimgrep.h"
 #include "nvim/window.h"
 #include "nvim/os/os.h"
 #include "nvim/os/input.h"
@@ -3566,6 +3567,10 @@ void ex_vimgrep(exarg_T *eap)
   char_u      *dirname_now = NULL;
   char_u      *target_dir = NULL;
   char_u      *au_name =  NULL;
+  vgr_pool_T  *pool = NULL;
+  vgr_match_T *matches;
+  size_t nmatches;
+  int pool_result;
 
   switch (eap->cmdidx) {
   case CMD_vimgrep:     au_name = (char_u *)"vimgrep"; break;
@@ -3654,6 +3659,10 @@ void ex_vimgrep(exarg_T *eap)
    * changing the current quickfix list. */
   cur_qf_start = qi->qf_lists[qi->qf_curlist].qf_start;
 
+  // Files that are not loaded are searched ahead on worker threads.
+  pool = vgr_pool_new((s == NULL || *s == NUL) ? last_search_pat() : s,
+                      regmatch.rmm_ic, flags, tomatch, fnames, fcount);
+
   seconds = (time_t)0;
   for (fi = 0; fi < fcount && !got_int && tomatch > 0; fi++) {
     fname = path_try_shorten_fname(fnames[fi]);
@@ -3676,8 +3685,20 @@ void ex_vimgrep(exarg_T *eap)
       ui_flush();
     }
 
-    buf = buflist_findname_exp(fnames[fi]);
-    if (buf == NULL || buf->b_ml.ml_mfp == NULL) {
+    pool_result = FAIL;
+    if (pool != NULL) {
+      pool_result = vgr_pool_wait(pool, fi, &matches, &nmatches);
+      if (pool_result == NOTDONE) {
+        break;
+      }
+    }
+
+    buf = NULL;
+    using_dummy = FALSE;
+    if (pool_result == OK) {
+      // Searched by a worker thread, no buffer needed.
+    } else if ((buf = buflist_findname_exp(fnames[fi])) == NULL
+               || buf->b_ml.ml_mfp == NULL) {
       /* Remember that a buffer with this name already exists. */
       duplicate_name = (buf != NULL);
       using_dummy = TRUE;
@@ -3696,9 +3717,7 @@ void ex_vimgrep(exarg_T *eap)
 
       p_mls = save_mls;
       au_event_restore(save_ei);
-    } else
-      /* Use existing, loaded buffer. */
-      using_dummy = FALSE;
+    }
 
     if (cur_qf_start != qi->qf_lists[qi->qf_curlist].qf_start) {
       int idx;
@@ -3717,7 +3736,30 @@ void ex_vimgrep(exarg_T *eap)
       }
     }
 
-    if (buf == NULL) {
+    if (pool_result == OK) {
+      for (size_t i = 0; i < nmatches && tomatch > 0; i++) {
+        // The buffer is created when the match is added.
+        if (qf_add_entry(qi,
+                         qi->qf_curlist,
+                         NULL,            // dir
+                         fname,
+                         0,               // bufnum
+                         matches[i].text,
+                         matches[i].lnum,
+                         matches[i].col + 1,
+                         false,           // vis_col
+                         NULL,            // search pattern
+                         0,               // nr
+                         0,               // type
+                         true)            // valid
+            == FAIL) {
+          got_int = true;
+          break;
+        }
+        tomatch--;
+      }
+      cur_qf_start = qi->qf_lists[qi->qf_curlist].qf_start;
+    } else if (buf == NULL) {
       if (!got_int)
         smsg(_("Cannot open file \"%s\""), fname);
     } else {
@@ -3822,6 +3864,7 @@ void ex_vimgrep(exarg_T *eap)
     }
   }
 
+  vgr_pool_free(pool);
   FreeWild(fcount, fnames);
 
   qi->qf_lists[qi->qf_curlist].qf_nonevalid = FALSE;
@@ -63,6 +63,7 @@
 #include "nvim/message.h"
 #include "nvim/misc1.h"
 #include "nvim/garray.h"
+#include "nvim/hashtab.h"
 #include "nvim/strings.h"
 
 #ifdef REGEXP_DEBUG
@@ -675,6 +676,8 @@ static void init_class_tab(void)
 #define RF_HASNL    4   /* can match a NL */
 #define RF_ICOMBINE 8   /* ignore combining characters */
 #define RF_LOOKBH   16  /* uses "\@<=" or "\@<!" */
+#define RF_POSITION 32  // uses the line number, virtual column, cursor,
+                        // Visual area or a mark
 
 /*
  * Global work variables for vim_regcomp().
@@ -688,12 +691,11 @@ static int regnzpar;            /* \z() count. */
 static int re_has_z;            /* \z item detected */
 static char_u   *regcode;       /* Code-emit pointer, or JUST_CALC_SIZE */
 static long regsize;            /* Code size. */
-static int reg_toolong;         /* TRUE when offset out of range */
+// TRUE when offset out of range.  Also read by regnext() while matching, a
+// compile on another thread must not affect that.
+static NVIM_THREAD_LOCAL int reg_toolong;
 static char_u had_endbrace[NSUBEXP];    /* flags, TRUE if end of () found */
 static unsigned regflags;       /* RF_ flags for prog */
-static long brace_min[10];      /* Minimums for complex brace repeats */
-static long brace_max[10];      /* Maximums for complex brace repeats */
-static int brace_count[10];      /* Current counts for complex brace repeats */
 static int had_eol;             /* TRUE when EOL found by vim_regcomp() */
 static int one_exactly = FALSE;         /* only do one char for EXACTLY */
 
@@ -751,6 +753,7 @@ static int nextchr;             /* used for ungetchr() */
 
 static regengine_T bt_regengine;
 static regengine_T nfa_regengine;
+static regengine_T dfa_regengine;
 
 /*
  * Return TRUE if compiled regular expression "prog" can match a line break.
@@ -760,6 +763,22 @@ int re_multiline(regprog_T *prog)
   return prog->regflags & RF_HASNL;
 }
 
+/// Return true if compiled regular expression "prog" can be used with
+/// vim_regexec_shared() for matching a line: it was compiled for the NFA
+/// engine, can't match a line break and does not depend on the buffer
+/// position or \z() matches.
+/// Programs for the backtracking engine are not shared, its matcher was not
+/// written to run on several threads.
+bool re_shareable(const regprog_T *prog)
+  FUNC_ATTR_PURE FUNC_ATTR_NONNULL_ALL
+{
+  if (prog->engine == &bt_regengine) {
+    return false;
+  }
+  return !(prog->regflags & (RF_HASNL | RF_POSITION))
+         && ((const nfa_regprog_T *)prog)->reghasz == 0;
+}
+
 /*
  * Check for an equivalence class name "[=a=]".  "pp" points to the '['.
  * Returns a character representing the class. Zero means that no item was
@@ -2020,10 +2039,12 @@ static char_u *regatom(int *flagp)
 
     case '#':
       ret = regnode(CURSOR);
+      regflags |= RF_POSITION;
       break;
 
     case 'V':
       ret = regnode(RE_VISUAL);
+      regflags |= RF_POSITION;
       break;
 
     case 'C':
@@ -2131,6 +2152,7 @@ static char_u *regatom(int *flagp)
           /* "\%'m", "\%<'m" and "\%>'m": Mark */
           c = getchr();
           ret = regnode(RE_MARK);
+          regflags |= RF_POSITION;
           if (ret == JUST_CALC_SIZE)
             regsize += 2;
           else {
@@ -2141,6 +2163,7 @@ static char_u *regatom(int *flagp)
         } else if (c == 'l' || c == 'c' || c == 'v') {
           if (c == 'l') {
             ret = regnode(RE_LNUM);
+            regflags |= RF_POSITION;
             if (save_prev_at_start) {
               at_start = true;
             }
@@ -2148,6 +2171,7 @@ static char_u *regatom(int *flagp)
             ret = regnode(RE_COL);
           } else {
             ret = regnode(RE_VCOL);
+            regflags |= RF_POSITION;
           }
           if (ret == JUST_CALC_SIZE) {
             regsize += 5;
@@ -3129,16 +3153,6 @@ static int read_limits(long *minval, long *maxval)
  * Global work variables for vim_regexec().
  */
 
-/* The current match-position is remembered with these variables: */
-static linenr_T reglnum;        /* line number, relative to first line */
-static char_u   *regline;       /* start of current line */
-static char_u   *reginput;      /* current input, points into "regline" */
-
-static int need_clear_subexpr;          /* subexpressions still need to be
-                                         * cleared */
-static int need_clear_zsubexpr = FALSE;         /* extmatch subexpressions
-                                                 * still need to be cleared */
-
 
 /* Save the sub-expressions before attempting a match. */
 #define save_se(savep, posp, pp) \
@@ -3159,8 +3173,17 @@ int regnarrate = 0;
 // Sometimes need to save a copy of a line.  Since alloc()/free() is very
 // slow, we keep one allocated piece of memory and only re-allocate it when
 // it's too small.  It's freed in bt_regexec_both() when finished.
-static char_u   *reg_tofree = NULL;
-static unsigned reg_tofreelen;
+// Like the other scratch buffers below it is kept per thread, so that
+// vim_regexec_shared() can be used from worker threads.
+static NVIM_THREAD_LOCAL char_u *reg_tofree = NULL;
+static NVIM_THREAD_LOCAL unsigned reg_tofreelen;
+
+// Lines of the data blocks reg_getline() used last, so that going back and
+// forth between lines doesn't look up each line in the memline again.
+// Only used during vim_regexec_multi(), the buffer doesn't change then.
+#define REG_BLOCKS 2
+static NVIM_THREAD_LOCAL mllines_T reg_blocks[REG_BLOCKS];
+static NVIM_THREAD_LOCAL int reg_block_next = 0;  // entry to fill next
 
 // Structure used to store the execution state of the regex engine.
 // Which ones are set depends on whether a single-line or multi-line match is
@@ -3202,10 +3225,66 @@ typedef struct {
   // Copy of "rmm_maxcol": maximum column to search for a match.  Zero when
   // there is no maximum.
   colnr_T reg_maxcol;
+
+  // Matching from vim_regexec_shared(): no messages, no checks for an
+  // interrupt and no access to buffers.
+  bool reg_shared;
+  // Matching from vim_regexec_multi(): reg_getline() can use "reg_blocks".
+  bool reg_use_blocks;
+  // With "reg_shared": an error was found, the result can't be used.
+  bool reg_exec_error;
+
+  // The current match-position is remembered with these variables:
+  linenr_T lnum;      // line number, relative to first line
+  char_u *line;       // start of current line
+  char_u *input;      // current input, points into "line"
+
+  int need_clear_subexpr;   // subexpressions still need to be cleared
+  int need_clear_zsubexpr;  // extmatch subexpressions still need to be
+                            // cleared
+
+  regsave_T behind_pos;
+
+  char_u *reg_startzp[NSUBEXP];   // Workspace to mark beginning
+  char_u *reg_endzp[NSUBEXP];     //   and end of \z(...\) matches
+  lpos_T reg_startzpos[NSUBEXP];  // idem, beginning pos
+  lpos_T reg_endzpos[NSUBEXP];    // idem, end pos
+
+  // The arguments from BRACE_LIMITS are stored here.  They are actually local
+  // to regmatch(), but they are here to reduce the amount of stack space used
+  // (it can be called recursively many times).
+  long bl_minval;
+  long bl_maxval;
+
+  long brace_min[10];     // Minimums for complex brace repeats
+  long brace_max[10];     // Maximums for complex brace repeats
+  int brace_count[10];    // Current counts for complex brace repeats
+
+  // The NFA matcher state.
+  int nfa_has_zend;       // NFA regexp \ze operator encountered
+  int nfa_has_backref;    // NFA regexp \1 .. \9 encountered
+  int nfa_nsubexpr;       // Number of sub expressions actually being used
+                          // during execution.  1 if only the whole match
+                          // (subexpr 0) is used.
+  int nfa_has_zsubexpr;   // NFA regexp has \z( ), set zsubexpr.
+  save_se_T *nfa_endp;    // if not NULL match must end at this position
+  // listid is kept here, so that it increases on recursive calls to
+  // nfa_regmatch(), which means we don't have to clear the last list of
+  // all the states.
+  int nfa_listid;
+  int nfa_alt_listid;
+  int nfa_ll_index;       // 0 for first call to nfa_regmatch(), 1 for
+                          // recursive call
+  int *nfa_lastlist;      // two list ids for each state of the program
+  int nfa_match;          // whether a match has been found
+  proftime_T *nfa_time_limit;
+  int nfa_time_count;
 } regexec_T;
 
-static regexec_T rex;
-static bool rex_in_use = false;
+// Kept per thread, so that a worker thread can use vim_regexec_shared()
+// while the main thread is matching.
+static NVIM_THREAD_LOCAL regexec_T rex;
+static NVIM_THREAD_LOCAL bool rex_in_use = false;
 
 /*
  * "regstack" and "backpos" are used by regmatch().  They are kept over calls
@@ -3214,8 +3293,14 @@ static bool rex_in_use = false;
  * or regbehind_T.
  * "backpos_T" is a table with backpos_T for BACK
  */
-static garray_T regstack = GA_EMPTY_INIT_VALUE;
-static garray_T backpos = GA_EMPTY_INIT_VALUE;
+static NVIM_THREAD_LOCAL garray_T regstack = GA_EMPTY_INIT_VALUE;
+static NVIM_THREAD_LOCAL garray_T backpos = GA_EMPTY_INIT_VALUE;
+
+// Storage for "rex.nfa_lastlist", kept over calls like "regstack".  Not used
+// by a recursive call while "nfa_lastlist_busy" is set.
+static NVIM_THREAD_LOCAL int *nfa_lastlist_buf = NULL;
+static NVIM_THREAD_LOCAL size_t nfa_lastlist_size = 0;
+static NVIM_THREAD_LOCAL bool nfa_lastlist_busy = false;
 
 /*
  * Both for regstack and backpos tables we use the following strategy of
@@ -3231,17 +3316,54 @@ static garray_T backpos = GA_EMPTY_INIT_VALUE;
 #define REGSTACK_INITIAL        2048
 #define BACKPOS_INITIAL         64
 
-#if defined(EXITFREE)
-void free_regexp_stuff(void)
+/// Free the memory the matcher keeps allocated for the current thread.
+/// A thread that used vim_regexec_shared() must call this before exiting.
+void regexp_free_thread_state(void)
 {
   ga_clear(&regstack);
   ga_clear(&backpos);
+  xfree(nfa_lastlist_buf);
+  nfa_lastlist_buf = NULL;
+  nfa_lastlist_size = 0;
   xfree(reg_tofree);
+  reg_tofree = NULL;
+  reg_tofreelen = 0;
+  for (int i = 0; i < REG_BLOCKS; i++) {
+    xfree(reg_blocks[i].lines);
+    reg_blocks[i].lines = NULL;
+    reg_blocks[i].size = 0;
+  }
+}
+
+#if defined(EXITFREE)
+void free_regexp_stuff(void)
+{
+  regexp_free_thread_state();
+  regprog_cache_clear();
   xfree(reg_prev_sub);
 }
 
 #endif
 
+/// Check for CTRL-C typed, unless matching on a worker thread.
+static inline void reg_fast_breakcheck(void)
+{
+  if (!rex.reg_shared) {
+    fast_breakcheck();
+  }
+}
+
+/// Give error message "msg" for an error found while matching.  On a worker
+/// thread only remember that the result can't be used.
+static void reg_exec_emsg(const char *msg)
+{
+  if (rex.reg_shared) {
+    rex.reg_exec_error = true;
+  } else {
+    EMSG(msg);
+  }
+}
+
 /*
  * Get pointer to the line "lnum", which is relative to "reg_firstlnum".
  */
@@ -3256,15 +3378,47 @@ static char_u *reg_getline(linenr_T lnum)
     // Must have matched the "\n" in the last line.
     return (char_u *)"";
   }
-  return ml_get_buf(rex.reg_buf, rex.reg_firstlnum + lnum, false);
+  if (!rex.reg_use_blocks) {
+    return ml_get_buf(rex.reg_buf, rex.reg_firstlnum + lnum, false);
+  }
+  char_u *line = reg_getline_cached(lnum);
+  if (line == NULL) {
+    mllines_T *block = &reg_blocks[reg_block_next];
+    reg_block_next = (reg_block_next + 1) % REG_BLOCKS;
+    line = ml_get_block(rex.reg_buf, rex.reg_firstlnum + lnum, block);
+  }
+  return line;
 }
 
-static regsave_T behind_pos;
+/// Get line "lnum" like reg_getline(), but only when it's in one of
+/// "reg_blocks", getting it doesn't invalidate other lines then.
+///
+/// @return  NULL when the line isn't available.
+static char_u *reg_getline_cached(linenr_T lnum)
+{
+  if (!rex.reg_use_blocks || rex.reg_firstlnum + lnum < 1
+      || lnum > rex.reg_maxline) {
+    return NULL;
+  }
+  lnum += rex.reg_firstlnum;
+  for (int i = 0; i < REG_BLOCKS; i++) {
+    mllines_T *block = &reg_blocks[i];
+    if (lnum >= block->low && lnum <= block->high
+        && block->buf == rex.reg_buf && ml_block_valid(block)) {
+      return block->lines[lnum - block->low];
+    }
+  }
+  return NULL;
+}
 
-static char_u   *reg_startzp[NSUBEXP];  /* Workspace to mark beginning */
-static char_u   *reg_endzp[NSUBEXP];    /*   and end of \z(...\) matches */
-static lpos_T reg_startzpos[NSUBEXP];   /* idem, beginning pos */
-static lpos_T reg_endzpos[NSUBEXP];     /* idem, end pos */
+/// Forget the lines in "reg_blocks", the buffer may have changed.
+static void reg_blocks_clear(void)
+{
+  for (int i = 0; i < REG_BLOCKS; i++) {
+    reg_blocks[i].low = 1;
+    reg_blocks[i].high = 0;
+  }
+}
 
 // TRUE if using multi-line regexp.
 #define REG_MULTI       (rex.reg_match == NULL)
@@ -3289,7 +3443,9 @@ bt_regexec_nl (
   rex.reg_mmatch = NULL;
   rex.reg_maxline = 0;
   rex.reg_line_lbr = line_lbr;
-  rex.reg_buf = curbuf;
+  if (!rex.reg_shared) {
+    rex.reg_buf = curbuf;
+  }
   rex.reg_win = NULL;
   rex.reg_ic = rmp->rm_ic;
   rex.reg_icombine = false;
@@ -3468,13 +3624,13 @@ static long bt_regexec_both(char_u *line,
     }
   }
 
-  regline = line;
-  reglnum = 0;
+  rex.line = line;
+  rex.lnum = 0;
   reg_toolong = FALSE;
 
   /* Simplest case: Anchored match need be tried only once. */
   if (prog->reganch) {
-    int c = utf_ptr2char(regline + col);
+    int c = utf_ptr2char(rex.line + col);
     if (prog->regstart == NUL
         || prog->regstart == c
         || (rex.reg_ic
@@ -3491,12 +3647,12 @@ static long bt_regexec_both(char_u *line,
     while (!got_int) {
       if (prog->regstart != NUL) {
         // Skip until the char we know it must start with.
-        s = cstrchr(regline + col, prog->regstart);
+        s = cstrchr(rex.line + col, prog->regstart);
         if (s == NULL) {
           retval = 0;
           break;
         }
-        col = (int)(s - regline);
+        col = (int)(s - rex.line);
       }
 
       // Check for maximum column to try.
@@ -3510,14 +3666,14 @@ static long bt_regexec_both(char_u *line,
         break;
 
       /* if not currently on the first line, get it again */
-      if (reglnum != 0) {
-        reglnum = 0;
-        regline = reg_getline((linenr_T)0);
+      if (rex.lnum != 0) {
+        rex.lnum = 0;
+        rex.line = reg_getline((linenr_T)0);
       }
-      if (regline[col] == NUL)
+      if (rex.line[col] == NUL)
         break;
       if (has_mbyte)
-        col += (*mb_ptr2len)(regline + col);
+        col += (*mb_ptr2len)(rex.line + col);
       else
         ++col;
       /* Check for timeout once in a twenty times to avoid overhead. */
@@ -3581,16 +3737,16 @@ void unref_extmatch(reg_extmatch_T *em)
 }
 
 /*
- * regtry - try match of "prog" with at regline["col"].
+ * regtry - try match of "prog" with at rex.line["col"].
  * Returns 0 for failure, number of lines contained in the match otherwise.
  */
 static long regtry(bt_regprog_T *prog, colnr_T col)
 {
-  reginput = regline + col;
-  need_clear_subexpr = TRUE;
+  rex.input = rex.line + col;
+  rex.need_clear_subexpr = TRUE;
   /* Clear the external match subpointers if necessary. */
   if (prog->reghasz == REX_SET)
-    need_clear_zsubexpr = TRUE;
+    rex.need_clear_zsubexpr = TRUE;
 
   if (regmatch(prog->program + 1) == 0)
     return 0;
@@ -3602,18 +3758,18 @@ static long regtry(bt_regprog_T *prog, colnr_T col)
       rex.reg_startpos[0].col = col;
     }
     if (rex.reg_endpos[0].lnum < 0) {
-      rex.reg_endpos[0].lnum = reglnum;
-      rex.reg_endpos[0].col = (int)(reginput - regline);
+      rex.reg_endpos[0].lnum = rex.lnum;
+      rex.reg_endpos[0].col = (int)(rex.input - rex.line);
     } else {
       // Use line number of "\ze".
-      reglnum = rex.reg_endpos[0].lnum;
+      rex.lnum = rex.reg_endpos[0].lnum;
     }
   } else {
     if (rex.reg_startp[0] == NULL) {
-      rex.reg_startp[0] = regline + col;
+      rex.reg_startp[0] = rex.line + col;
     }
     if (rex.reg_endp[0] == NULL) {
-      rex.reg_endp[0] = reginput;
+      rex.reg_endp[0] = rex.input;
     }
   }
   /* Package any found \z(...\) matches for export. Default is none. */
@@ -3628,39 +3784,39 @@ static long regtry(bt_regprog_T *prog, colnr_T col)
     for (i = 0; i < NSUBEXP; i++) {
       if (REG_MULTI) {
         /* Only accept single line matches. */
-        if (reg_startzpos[i].lnum >= 0
-            && reg_endzpos[i].lnum == reg_startzpos[i].lnum
-            && reg_endzpos[i].col >= reg_startzpos[i].col) {
+        if (rex.reg_startzpos[i].lnum >= 0
+            && rex.reg_endzpos[i].lnum == rex.reg_startzpos[i].lnum
+            && rex.reg_endzpos[i].col >= rex.reg_startzpos[i].col) {
           re_extmatch_out->matches[i] =
-            vim_strnsave(reg_getline(reg_startzpos[i].lnum)
-                         + reg_startzpos[i].col,
-                         reg_endzpos[i].col
-                         - reg_startzpos[i].col);
+            vim_strnsave(reg_getline(rex.reg_startzpos[i].lnum)
+                         + rex.reg_startzpos[i].col,
+                         rex.reg_endzpos[i].col
+                         - rex.reg_startzpos[i].col);
         }
       } else {
-        if (reg_startzp[i] != NULL && reg_endzp[i] != NULL)
+        if (rex.reg_startzp[i] != NULL && rex.reg_endzp[i] != NULL)
           re_extmatch_out->matches[i] =
-            vim_strnsave(reg_startzp[i],
-                (int)(reg_endzp[i] - reg_startzp[i]));
+            vim_strnsave(rex.reg_startzp[i],
+                (int)(rex.reg_endzp[i] - rex.reg_startzp[i]));
       }
     }
   }
-  return 1 + reglnum;
+  return 1 + rex.lnum;
 }
 
 
 // Get class of previous character.
 static int reg_prev_class(void)
 {
-  if (reginput > regline) {
-    return mb_get_class_tab(reginput - 1 - utf_head_off(regline, reginput - 1),
+  if (rex.input > rex.line) {
+    return mb_get_class_tab(rex.input - 1 - utf_head_off(rex.line, rex.input - 1),
                             rex.reg_buf->b_chartab);
   }
   return -1;
 }
 
 
-// Return TRUE if the current reginput position matches the Visual area.
+// Return TRUE if the current rex.input position matches the Visual area.
 static int reg_match_visual(void)
 {
   pos_T top, bot;
@@ -3695,13 +3851,13 @@ static int reg_match_visual(void)
     }
     mode = curbuf->b_visual.vi_mode;
   }
-  lnum = reglnum + rex.reg_firstlnum;
+  lnum = rex.lnum + rex.reg_firstlnum;
   if (lnum < top.lnum || lnum > bot.lnum) {
     return false;
   }
 
   if (mode == 'v') {
-    col = (colnr_T)(reginput - regline);
+    col = (colnr_T)(rex.input - rex.line);
     if ((lnum == top.lnum && col < top.col)
         || (lnum == bot.lnum && col >= bot.col + (*p_sel != 'e')))
       return FALSE;
@@ -3714,8 +3870,8 @@ static int reg_match_visual(void)
       end = end2;
     if (top.col == MAXCOL || bot.col == MAXCOL)
       end = MAXCOL;
-    unsigned int cols_u = win_linetabsize(wp, regline,
-                                          (colnr_T)(reginput - regline));
+    unsigned int cols_u = win_linetabsize(wp, rex.line,
+                                          (colnr_T)(rex.input - rex.line));
     assert(cols_u <= MAXCOL);
     colnr_T cols = (colnr_T)cols_u;
     if (cols < start || cols > end - (*p_sel == 'e'))
@@ -3724,15 +3880,7 @@ static int reg_match_visual(void)
   return TRUE;
 }
 
-#define ADVANCE_REGINPUT() MB_PTR_ADV(reginput)
-
-/*
- * The arguments from BRACE_LIMITS are stored here.  They are actually local
- * to regmatch(), but they are here to reduce the amount of stack space used
- * (it can be called recursively many times).
- */
-static long bl_minval;
-static long bl_maxval;
+#define ADVANCE_REGINPUT() MB_PTR_ADV(rex.input)
 
 /*
  * regmatch - main matching routine
@@ -3744,9 +3892,9 @@ static long bl_maxval;
  * (that don't need to know whether the rest of the match failed) by a nested
  * loop.
  *
- * Returns TRUE when there is a match.  Leaves reginput and reglnum just after
+ * Returns TRUE when there is a match.  Leaves rex.input and rex.lnum just after
  * the last matched character.
- * Returns FALSE when there is no match.  Leaves reginput and reglnum in an
+ * Returns FALSE when there is no match.  Leaves rex.input and rex.lnum in an
  * undefined state!
  */
 static int 
@@ -3777,7 +3925,7 @@ regmatch (
   for (;; ) {
     /* Some patterns may take a long time to match, e.g., "\([a-z]\+\)\+Q".
      * Allow interrupting them with CTRL-C. */
-    fast_breakcheck();
+    reg_fast_breakcheck();
 
 #ifdef REGEXP_DEBUG
     if (scan != NULL && regnarrate) {
@@ -3819,18 +3967,18 @@ regmatch (
       op = OP(scan);
       // Check for character class with NL added.
       if (!rex.reg_line_lbr && WITH_NL(op) && REG_MULTI
-          && *reginput == NUL && reglnum <= rex.reg_maxline) {
+          && *rex.input == NUL && rex.lnum <= rex.reg_maxline) {
         reg_nextline();
-      } else if (rex.reg_line_lbr && WITH_NL(op) && *reginput == '\n') {
+      } else if (rex.reg_line_lbr && WITH_NL(op) && *rex.input == '\n') {
         ADVANCE_REGINPUT();
       } else {
         if (WITH_NL(op)) {
           op -= ADD_NL;
         }
-        c = utf_ptr2char(reginput);
+        c = utf_ptr2char(rex.input);
         switch (op) {
         case BOL:
-          if (reginput != regline)
+          if (rex.input != rex.line)
             status = RA_NOMATCH;
           break;
 
@@ -3843,14 +3991,14 @@ regmatch (
           // We're not at the beginning of the file when below the first
           // line where we started, not at the start of the line or we
           // didn't start at the first line of the buffer.
-          if (reglnum != 0 || reginput != regline
+          if (rex.lnum != 0 || rex.input != rex.line
               || (REG_MULTI && rex.reg_firstlnum > 1)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_EOF:
-          if (reglnum != rex.reg_maxline || c != NUL) {
+          if (rex.lnum != rex.reg_maxline || c != NUL) {
             status = RA_NOMATCH;
           }
           break;
@@ -3859,8 +4007,8 @@ regmatch (
           // Check if the buffer is in a window and compare the
           // rex.reg_win->w_cursor position to the match position.
           if (rex.reg_win == NULL
-              || (reglnum + rex.reg_firstlnum != rex.reg_win->w_cursor.lnum)
-              || ((colnr_T)(reginput - regline) != rex.reg_win->w_cursor.col)) {
+              || (rex.lnum + rex.reg_firstlnum != rex.reg_win->w_cursor.lnum)
+              || ((colnr_T)(rex.input - rex.line) != rex.reg_win->w_cursor.col)) {
             status = RA_NOMATCH;
           }
           break;
@@ -3875,13 +4023,13 @@ regmatch (
           pos = getmark_buf(rex.reg_buf, mark, false);
           if (pos == NULL                    // mark doesn't exist
               || pos->lnum <= 0              // mark isn't set in reg_buf
-              || (pos->lnum == reglnum + rex.reg_firstlnum
-                  ? (pos->col == (colnr_T)(reginput - regline)
+              || (pos->lnum == rex.lnum + rex.reg_firstlnum
+                  ? (pos->col == (colnr_T)(rex.input - rex.line)
                      ? (cmp == '<' || cmp == '>')
-                     : (pos->col < (colnr_T)(reginput - regline)
+                     : (pos->col < (colnr_T)(rex.input - rex.line)
                         ? cmp != '>'
                         : cmp != '<'))
-                  : (pos->lnum < reglnum + rex.reg_firstlnum
+                  : (pos->lnum < rex.lnum + rex.reg_firstlnum
                      ? cmp != '>'
                      : cmp != '<'))) {
             status = RA_NOMATCH;
@@ -3895,39 +4043,39 @@ regmatch (
           break;
 
         case RE_LNUM:
-          assert(reglnum + rex.reg_firstlnum >= 0
-                 && (uintmax_t)(reglnum + rex.reg_firstlnum) <= UINT32_MAX);
+          assert(rex.lnum + rex.reg_firstlnum >= 0
+                 && (uintmax_t)(rex.lnum + rex.reg_firstlnum) <= UINT32_MAX);
           if (!REG_MULTI
-              || !re_num_cmp((uint32_t)(reglnum + rex.reg_firstlnum), scan)) {
+              || !re_num_cmp((uint32_t)(rex.lnum + rex.reg_firstlnum), scan)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_COL:
-          assert(reginput - regline + 1 >= 0
-                 && (uintmax_t)(reginput - regline + 1) <= UINT32_MAX);
-          if (!re_num_cmp((uint32_t)(reginput - regline + 1), scan))
+          assert(rex.input - rex.line + 1 >= 0
+                 && (uintmax_t)(rex.input - rex.line + 1) <= UINT32_MAX);
+          if (!re_num_cmp((uint32_t)(rex.input - rex.line + 1), scan))
             status = RA_NOMATCH;
           break;
 
         case RE_VCOL:
           if (!re_num_cmp(win_linetabsize(rex.reg_win == NULL
                                           ? curwin : rex.reg_win,
-                                          regline,
-                                          (colnr_T)(reginput - regline)) + 1,
+                                          rex.line,
+                                          (colnr_T)(rex.input - rex.line)) + 1,
                           scan)) {
             status = RA_NOMATCH;
           }
           break;
 
-        case BOW:       /* \<word; reginput points to w */
+        case BOW:       /* \<word; rex.input points to w */
           if (c == NUL)         /* Can't match at end of line */
             status = RA_NOMATCH;
           else if (has_mbyte) {
             int this_class;
 
             // Get class of current and previous char (if it exists).
-            this_class = mb_get_class_tab(reginput, rex.reg_buf->b_chartab);
+            this_class = mb_get_class_tab(rex.input, rex.reg_buf->b_chartab);
             if (this_class <= 1) {
               status = RA_NOMATCH;  // Not on a word at all.
             } else if (reg_prev_class() == this_class) {
@@ -3935,28 +4083,28 @@ regmatch (
             }
           } else {
             if (!vim_iswordc_buf(c, rex.reg_buf)
-                || (reginput > regline
-                    && vim_iswordc_buf(reginput[-1], rex.reg_buf))) {
+                || (rex.input > rex.line
+                    && vim_iswordc_buf(rex.input[-1], rex.reg_buf))) {
               status = RA_NOMATCH;
             }
           }
           break;
 
-        case EOW:       /* word\>; reginput points after d */
-          if (reginput == regline)      /* Can't match at start of line */
+        case EOW:       /* word\>; rex.input points after d */
+          if (rex.input == rex.line)      /* Can't match at start of line */
             status = RA_NOMATCH;
           else if (has_mbyte) {
             int this_class, prev_class;
 
             // Get class of current and previous char (if it exists).
-            this_class = mb_get_class_tab(reginput, rex.reg_buf->b_chartab);
+            this_class = mb_get_class_tab(rex.input, rex.reg_buf->b_chartab);
             prev_class = reg_prev_class();
             if (this_class == prev_class
                 || prev_class == 0 || prev_class == 1)
               status = RA_NOMATCH;
           } else {
-            if (!vim_iswordc_buf(reginput[-1], rex.reg_buf)
-                || (reginput[0] != NUL && vim_iswordc_buf(c, rex.reg_buf))) {
+            if (!vim_iswordc_buf(rex.input[-1], rex.reg_buf)
+                || (rex.input[0] != NUL && vim_iswordc_buf(c, rex.reg_buf))) {
               status = RA_NOMATCH;
             }
           }
@@ -3978,14 +4126,14 @@ regmatch (
           break;
 
         case SIDENT:
-          if (ascii_isdigit(*reginput) || !vim_isIDc(c))
+          if (ascii_isdigit(*rex.input) || !vim_isIDc(c))
             status = RA_NOMATCH;
           else
             ADVANCE_REGINPUT();
           break;
 
         case KWORD:
-          if (!vim_iswordp_buf(reginput, rex.reg_buf)) {
+          if (!vim_iswordp_buf(rex.input, rex.reg_buf)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3993,8 +4141,8 @@ regmatch (
           break;
 
         case SKWORD:
-          if (ascii_isdigit(*reginput)
-              || !vim_iswordp_buf(reginput, rex.reg_buf)) {
+          if (ascii_isdigit(*rex.input)
+              || !vim_iswordp_buf(rex.input, rex.reg_buf)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -4009,21 +4157,21 @@ regmatch (
           break;
 
         case SFNAME:
-          if (ascii_isdigit(*reginput) || !vim_isfilec(c))
+          if (ascii_isdigit(*rex.input) || !vim_isfilec(c))
             status = RA_NOMATCH;
           else
             ADVANCE_REGINPUT();
           break;
 
         case PRINT:
-          if (!vim_isprintc(PTR2CHAR(reginput)))
+          if (!vim_isprintc(PTR2CHAR(rex.input)))
             status = RA_NOMATCH;
           else
             ADVANCE_REGINPUT();
           break;
 
         case SPRINT:
-          if (ascii_isdigit(*reginput) || !vim_isprintc(PTR2CHAR(reginput)))
+          if (ascii_isdigit(*rex.input) || !vim_isprintc(PTR2CHAR(rex.input)))
             status = RA_NOMATCH;
           else
             ADVANCE_REGINPUT();
@@ -4162,10 +4310,10 @@ regmatch (
 
           opnd = OPERAND(scan);
           // Inline the first byte, for speed.
-          if (*opnd != *reginput
+          if (*opnd != *rex.input
               && (!rex.reg_ic
                   || (!enc_utf8
-                      && mb_tolower(*opnd) != mb_tolower(*reginput)))) {
+                      && mb_tolower(*opnd) != mb_tolower(*rex.input)))) {
             status = RA_NOMATCH;
           } else if (*opnd == NUL) {
             // match empty string always works; happens when "~" is
@@ -4176,14 +4324,14 @@ regmatch (
             } else {
               // Need to match first byte again for multi-byte.
               len = (int)STRLEN(opnd);
-              if (cstrncmp(opnd, reginput, &len) != 0) {
+              if (cstrncmp(opnd, rex.input, &len) != 0) {
                 status = RA_NOMATCH;
               }
             }
             // Check for following composing character, unless %C
             // follows (skips over all composing chars).
             if (status != RA_NOMATCH && enc_utf8
-                && UTF_COMPOSINGLIKE(reginput, reginput + len)
+                && UTF_COMPOSINGLIKE(rex.input, rex.input + len)
                 && !rex.reg_icombine
                 && OP(next) != RE_COMPOSING) {
               // raaron: This code makes a composing character get
@@ -4192,7 +4340,7 @@ regmatch (
               status = RA_NOMATCH;
             }
             if (status != RA_NOMATCH) {
-              reginput += len;
+              rex.input += len;
             }
           }
         }
@@ -4228,26 +4376,26 @@ regmatch (
               /* When only a composing char is given match at any
                * position where that composing char appears. */
               status = RA_NOMATCH;
-              for (i = 0; reginput[i] != NUL; i += utf_ptr2len(reginput + i)) {
-                inpc = utf_ptr2char(reginput + i);
+              for (i = 0; rex.input[i] != NUL; i += utf_ptr2len(rex.input + i)) {
+                inpc = utf_ptr2char(rex.input + i);
                 if (!utf_iscomposing(inpc)) {
                   if (i > 0) {
                     break;
                   }
                 } else if (opndc == inpc) {
                   // Include all following composing chars.
-                  len = i + utfc_ptr2len(reginput + i);
+                  len = i + utfc_ptr2len(rex.input + i);
                   status = RA_MATCH;
                   break;
                 }
               }
             } else
               for (i = 0; i < len; ++i)
-                if (opnd[i] != reginput[i]) {
+                if (opnd[i] != rex.input[i]) {
                   status = RA_NOMATCH;
                   break;
                 }
-            reginput += len;
+            rex.input += len;
           } else
             status = RA_NOMATCH;
           break;
@@ -4255,8 +4403,8 @@ regmatch (
         case RE_COMPOSING:
           if (enc_utf8) {
             // Skip composing characters.
-            while (utf_iscomposing(utf_ptr2char(reginput))) {
-              MB_CPTR_ADV(reginput);
+            while (utf_iscomposing(utf_ptr2char(rex.input))) {
+              MB_CPTR_ADV(rex.input);
             }
           }
           break;
@@ -4341,8 +4489,8 @@ regmatch (
             status = RA_FAIL;
           else {
             rp->rs_no = no;
-            save_se(&rp->rs_un.sesave, &reg_startzpos[no],
-                &reg_startzp[no]);
+            save_se(&rp->rs_un.sesave, &rex.reg_startzpos[no],
+                &rex.reg_startzp[no]);
             /* We simply continue and handle the result when done. */
           }
         }
@@ -4389,8 +4537,8 @@ regmatch (
             status = RA_FAIL;
           else {
             rp->rs_no = no;
-            save_se(&rp->rs_un.sesave, &reg_endzpos[no],
-                &reg_endzp[no]);
+            save_se(&rp->rs_un.sesave, &rex.reg_endzpos[no],
+                &rex.reg_endzp[no]);
             /* We simply continue and handle the result when done. */
           }
         }
@@ -4417,7 +4565,7 @@ regmatch (
             } else {
               // Compare current input with back-ref in the same line.
               len = (int)(rex.reg_endp[no] - rex.reg_startp[no]);
-              if (cstrncmp(rex.reg_startp[no], reginput, &len) != 0) {
+              if (cstrncmp(rex.reg_startp[no], rex.input, &len) != 0) {
                 status = RA_NOMATCH;
               }
             }
@@ -4426,12 +4574,12 @@ regmatch (
               // Backref was not set: Match an empty string.
               len = 0;
             } else {
-              if (rex.reg_startpos[no].lnum == reglnum
-                  && rex.reg_endpos[no].lnum == reglnum) {
+              if (rex.reg_startpos[no].lnum == rex.lnum
+                  && rex.reg_endpos[no].lnum == rex.lnum) {
                 // Compare back-ref within the current line.
                 len = rex.reg_endpos[no].col - rex.reg_startpos[no].col;
-                if (cstrncmp(regline + rex.reg_startpos[no].col,
-                             reginput, &len) != 0) {
+                if (cstrncmp(rex.line + rex.reg_startpos[no].col,
+                             rex.input, &len) != 0) {
                   status = RA_NOMATCH;
                 }
               } else {
@@ -4449,7 +4597,7 @@ regmatch (
           }
 
           /* Matched the backref, skip over it. */
-          reginput += len;
+          rex.input += len;
         }
         break;
 
@@ -4471,10 +4619,10 @@ regmatch (
               && re_extmatch_in->matches[no] != NULL) {
             len = (int)STRLEN(re_extmatch_in->matches[no]);
             if (cstrncmp(re_extmatch_in->matches[no],
-                    reginput, &len) != 0)
+                    rex.input, &len) != 0)
               status = RA_NOMATCH;
             else
-              reginput += len;
+              rex.input += len;
           } else {
             /* Backref was not set: Match an empty string. */
           }
@@ -4498,14 +4646,14 @@ regmatch (
         case BRACE_LIMITS:
         {
           if (OP(next) == BRACE_SIMPLE) {
-            bl_minval = OPERAND_MIN(scan);
-            bl_maxval = OPERAND_MAX(scan);
+            rex.bl_minval = OPERAND_MIN(scan);
+            rex.bl_maxval = OPERAND_MAX(scan);
           } else if (OP(next) >= BRACE_COMPLEX
                      && OP(next) < BRACE_COMPLEX + 10) {
             no = OP(next) - BRACE_COMPLEX;
-            brace_min[no] = OPERAND_MIN(scan);
-            brace_max[no] = OPERAND_MAX(scan);
-            brace_count[no] = 0;
+            rex.brace_min[no] = OPERAND_MIN(scan);
+            rex.brace_max[no] = OPERAND_MAX(scan);
+            rex.brace_count[no] = 0;
           } else {
             internal_error("BRACE_LIMITS");
             status = RA_FAIL;
@@ -4525,11 +4673,12 @@ regmatch (
         case BRACE_COMPLEX + 9:
         {
           no = op - BRACE_COMPLEX;
-          ++brace_count[no];
+          ++rex.brace_count[no];
 
           /* If not matched enough times yet, try one more */
-          if (brace_count[no] <= (brace_min[no] <= brace_max[no]
-                                  ? brace_min[no] : brace_max[no])) {
+          if (rex.brace_count[no] <= (rex.brace_min[no] <= rex.brace_max[no]
+                                      ? rex.brace_min[no]
+                                      : rex.brace_max[no])) {
             rp = regstack_push(RS_BRCPLX_MORE, scan);
             if (rp == NULL)
               status = RA_FAIL;
@@ -4543,9 +4692,9 @@ regmatch (
           }
 
           /* If matched enough times, may try matching some more */
-          if (brace_min[no] <= brace_max[no]) {
+          if (rex.brace_min[no] <= rex.brace_max[no]) {
             /* Range is the normal way around, use longest match */
-            if (brace_count[no] <= brace_max[no]) {
+            if (rex.brace_count[no] <= rex.brace_max[no]) {
               rp = regstack_push(RS_BRCPLX_LONG, scan);
               if (rp == NULL)
                 status = RA_FAIL;
@@ -4558,7 +4707,7 @@ regmatch (
             }
           } else {
             /* Range is backwards, use shortest match first */
-            if (brace_count[no] <= brace_min[no]) {
+            if (rex.brace_count[no] <= rex.brace_min[no]) {
               rp = regstack_push(RS_BRCPLX_SHORT, scan);
               if (rp == NULL)
                 status = RA_FAIL;
@@ -4600,8 +4749,8 @@ regmatch (
             rst.minval = (op == STAR) ? 0 : 1;
             rst.maxval = MAX_LIMIT;
           } else {
-            rst.minval = bl_minval;
-            rst.maxval = bl_maxval;
+            rst.minval = rex.bl_minval;
+            rst.maxval = rex.bl_maxval;
           }
 
           /*
@@ -4621,7 +4770,7 @@ regmatch (
              * follows.  The code is below.  Parameters are stored in
              * a regstar_T on the regstack. */
             if ((long)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-              EMSG(_(e_maxmempat));
+              reg_exec_emsg(_(e_maxmempat));
               status = RA_FAIL;
             } else {
               ga_grow(&regstack, sizeof(regstar_T));
@@ -4659,7 +4808,7 @@ regmatch (
         case NOBEHIND:
           /* Need a bit of room to store extra positions. */
           if ((long)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-            EMSG(_(e_maxmempat));
+            reg_exec_emsg(_(e_maxmempat));
             status = RA_FAIL;
           } else {
             ga_grow(&regstack, sizeof(regbehind_T));
@@ -4682,15 +4831,15 @@ regmatch (
 
         case BHPOS:
           if (REG_MULTI) {
-            if (behind_pos.rs_u.pos.col != (colnr_T)(reginput - regline)
-                || behind_pos.rs_u.pos.lnum != reglnum)
+            if (rex.behind_pos.rs_u.pos.col != (colnr_T)(rex.input - rex.line)
+                || rex.behind_pos.rs_u.pos.lnum != rex.lnum)
               status = RA_NOMATCH;
-          } else if (behind_pos.rs_u.ptr != reginput)
+          } else if (rex.behind_pos.rs_u.ptr != rex.input)
             status = RA_NOMATCH;
           break;
 
         case NEWL:
-          if ((c != NUL || !REG_MULTI || reglnum > rex.reg_maxline
+          if ((c != NUL || !REG_MULTI || rex.lnum > rex.reg_maxline
                || rex.reg_line_lbr) && (c != '\n' || !rex.reg_line_lbr)) {
             status = RA_NOMATCH;
           } else if (rex.reg_line_lbr) {
@@ -4705,7 +4854,7 @@ regmatch (
           break;
 
         default:
-          EMSG(_(e_re_corr));
+          reg_exec_emsg(_(e_re_corr));
 #ifdef REGEXP_DEBUG
           printf("Illegal op code %d\n", op);
 #endif
@@ -4747,8 +4896,8 @@ regmatch (
       case RS_ZOPEN:
         /* Pop the state.  Restore pointers when there is no match. */
         if (status == RA_NOMATCH)
-          restore_se(&rp->rs_un.sesave, &reg_startzpos[rp->rs_no],
-              &reg_startzp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex.reg_startzpos[rp->rs_no],
+              &rex.reg_startzp[rp->rs_no]);
         regstack_pop(&scan);
         break;
 
@@ -4764,8 +4913,8 @@ regmatch (
       case RS_ZCLOSE:
         /* Pop the state.  Restore pointers when there is no match. */
         if (status == RA_NOMATCH)
-          restore_se(&rp->rs_un.sesave, &reg_endzpos[rp->rs_no],
-              &reg_endzp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex.reg_endzpos[rp->rs_no],
+              &rex.reg_endzp[rp->rs_no]);
         regstack_pop(&scan);
         break;
 
@@ -4796,7 +4945,7 @@ regmatch (
         /* Pop the state.  Restore pointers when there is no match. */
         if (status == RA_NOMATCH) {
           reg_restore(&rp->rs_un.regsave, &backpos);
-          --brace_count[rp->rs_no];             /* decrement match count */
+          --rex.brace_count[rp->rs_no];  // decrement match count
         }
         regstack_pop(&scan);
         break;
@@ -4806,7 +4955,7 @@ regmatch (
         if (status == RA_NOMATCH) {
           /* There was no match, but we did find enough matches. */
           reg_restore(&rp->rs_un.regsave, &backpos);
-          --brace_count[rp->rs_no];
+          --rex.brace_count[rp->rs_no];
           /* continue with the items after "\{}" */
           status = RA_CONT;
         }
@@ -4861,10 +5010,10 @@ regmatch (
            * position.  Go back one character until we find the
            * result, hitting the start of the line or the previous
            * line (for multi-line matching).
-           * Set behind_pos to where the match should end, BHPOS
+           * Set rex.behind_pos to where the match should end, BHPOS
            * will match it.  Save the current value. */
-          (((regbehind_T *)rp) - 1)->save_behind = behind_pos;
-          behind_pos = rp->rs_un.regsave;
+          (((regbehind_T *)rp) - 1)->save_behind = rex.behind_pos;
+          rex.behind_pos = rp->rs_un.regsave;
 
           rp->rs_state = RS_BEHIND2;
 
@@ -4877,9 +5026,9 @@ regmatch (
         /*
          * Looping for BEHIND / NOBEHIND match.
          */
-        if (status == RA_MATCH && reg_save_equal(&behind_pos)) {
+        if (status == RA_MATCH && reg_save_equal(&rex.behind_pos)) {
           /* found a match that ends where "next" started */
-          behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
+          rex.behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
           if (rp->rs_no == BEHIND)
             reg_restore(&(((regbehind_T *)rp) - 1)->save_after,
                 &backpos);
@@ -4902,14 +5051,14 @@ regmatch (
           if (REG_MULTI) {
             if (limit > 0
                 && ((rp->rs_un.regsave.rs_u.pos.lnum
-                     < behind_pos.rs_u.pos.lnum
-                     ? (colnr_T)STRLEN(regline)
-                     : behind_pos.rs_u.pos.col)
+                     < rex.behind_pos.rs_u.pos.lnum
+                     ? (colnr_T)STRLEN(rex.line)
+                     : rex.behind_pos.rs_u.pos.col)
                     - rp->rs_un.regsave.rs_u.pos.col >= limit))
               no = FAIL;
             else if (rp->rs_un.regsave.rs_u.pos.col == 0) {
               if (rp->rs_un.regsave.rs_u.pos.lnum
-                  < behind_pos.rs_u.pos.lnum
+                  < rex.behind_pos.rs_u.pos.lnum
                   || reg_getline(
                       --rp->rs_un.regsave.rs_u.pos.lnum)
                   == NULL)
@@ -4917,11 +5066,11 @@ regmatch (
               else {
                 reg_restore(&rp->rs_un.regsave, &backpos);
                 rp->rs_un.regsave.rs_u.pos.col =
-                  (colnr_T)STRLEN(regline);
+                  (colnr_T)STRLEN(rex.line);
               }
             } else {
               const char_u *const line =
-                  reg_getline(behind_pos.rs_u.pos.lnum);
+                  reg_getline(rex.behind_pos.rs_u.pos.lnum);
 
               rp->rs_un.regsave.rs_u.pos.col -=
                   utf_head_off(line,
@@ -4929,12 +5078,12 @@ regmatch (
                   + 1;
             }
           } else {
-            if (rp->rs_un.regsave.rs_u.ptr == regline) {
+            if (rp->rs_un.regsave.rs_u.ptr == rex.line) {
               no = FAIL;
             } else {
-              MB_PTR_BACK(regline, rp->rs_un.regsave.rs_u.ptr);
+              MB_PTR_BACK(rex.line, rp->rs_un.regsave.rs_u.ptr);
               if (limit > 0
-                  && (long)(behind_pos.rs_u.ptr
+                  && (long)(rex.behind_pos.rs_u.ptr
                             - rp->rs_un.regsave.rs_u.ptr) > limit) {
                 no = FAIL;
               }
@@ -4952,7 +5101,7 @@ regmatch (
             }
           } else {
             /* Can't advance.  For NOBEHIND that's a match. */
-            behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
+            rex.behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
             if (rp->rs_no == NOBEHIND) {
               reg_restore(&(((regbehind_T *)rp) - 1)->save_after,
                   &backpos);
@@ -4996,18 +5145,18 @@ regmatch (
                * didn't match -- back up one char. */
               if (--rst->count < rst->minval)
                 break;
-              if (reginput == regline) {
+              if (rex.input == rex.line) {
                 // backup to last char of previous line
-                reglnum--;
-                regline = reg_getline(reglnum);
+                rex.lnum--;
+                rex.line = reg_getline(rex.lnum);
                 // Just in case regrepeat() didn't count right.
-                if (regline == NULL) {
+                if (rex.line == NULL) {
                   break;
                 }
-                reginput = regline + STRLEN(regline);
-                fast_breakcheck();
+                rex.input = rex.line + STRLEN(rex.line);
+                reg_fast_breakcheck();
               } else {
-                MB_PTR_BACK(regline, reginput);
+                MB_PTR_BACK(rex.line, rex.input);
               }
             } else {
               /* Range is backwards, use shortest match first.
@@ -5025,8 +5174,8 @@ regmatch (
             status = RA_NOMATCH;
 
           /* If it could match, try it. */
-          if (rst->nextb == NUL || *reginput == rst->nextb
-              || *reginput == rst->nextb_ic) {
+          if (rst->nextb == NUL || *rex.input == rst->nextb
+              || *rex.input == rst->nextb_ic) {
             reg_save(&rp->rs_un.regsave, &backpos);
             scan = regnext(rp->rs_scan);
             status = RA_CONT;
@@ -5063,7 +5212,7 @@ regmatch (
          * We get here only if there's trouble -- normally "case END" is
          * the terminating point.
          */
-        EMSG(_(e_re_corr));
+        reg_exec_emsg(_(e_re_corr));
 #ifdef REGEXP_DEBUG
         printf("Premature EOL\n");
 #endif
@@ -5087,7 +5236,7 @@ static regitem_T *regstack_push(regstate_T state, char_u *scan)
   regitem_T   *rp;
 
   if ((long)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-    EMSG(_(e_maxmempat));
+    reg_exec_emsg(_(e_maxmempat));
     return NULL;
   }
   ga_grow(&regstack, sizeof(regitem_T));
@@ -5115,7 +5264,7 @@ static void regstack_pop(char_u **scan)
 
 /*
  * regrepeat - repeatedly match something simple, return how many.
- * Advances reginput (and reglnum) to just after the matched chars.
+ * Advances rex.input (and rex.lnum) to just after the matched chars.
  */
 static int 
 regrepeat (
@@ -5129,7 +5278,7 @@ regrepeat (
   int mask;
   int testval = 0;
 
-  scan = reginput;          /* Make local copy of reginput for speed. */
+  scan = rex.input;          /* Make local copy of rex.input for speed. */
   opnd = OPERAND(p);
   switch (OP(p)) {
   case ANY:
@@ -5141,13 +5290,13 @@ regrepeat (
         count++;
         MB_PTR_ADV(scan);
       }
-      if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+      if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
           || rex.reg_line_lbr || count == maxcount) {
         break;
       }
       count++;  // count the line-break
       reg_nextline();
-      scan = reginput;
+      scan = rex.input;
       if (got_int)
         break;
     }
@@ -5163,12 +5312,12 @@ regrepeat (
       if (vim_isIDc(PTR2CHAR(scan)) && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
             || rex.reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = reginput;
+        scan = rex.input;
         if (got_int)
           break;
       } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
@@ -5191,12 +5340,12 @@ regrepeat (
           && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
             || rex.reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = reginput;
+        scan = rex.input;
         if (got_int) {
           break;
         }
@@ -5219,12 +5368,12 @@ regrepeat (
       if (vim_isfilec(PTR2CHAR(scan)) && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
             || rex.reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = reginput;
+        scan = rex.input;
         if (got_int) {
           break;
         }
@@ -5245,12 +5394,12 @@ regrepeat (
   case SPRINT + ADD_NL:
     while (count < maxcount) {
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
             || rex.reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = reginput;
+        scan = rex.input;
         if (got_int) {
           break;
         }
@@ -5273,12 +5422,12 @@ do_class:
     while (count < maxcount) {
       int l;
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
             || rex.reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = reginput;
+        scan = rex.input;
         if (got_int)
           break;
       } else if (has_mbyte && (l = (*mb_ptr2len)(scan)) > 1) {
@@ -5426,12 +5575,12 @@ do_class:
     while (count < maxcount) {
       int len;
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || reglnum > rex.reg_maxline
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
             || rex.reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = reginput;
+        scan = rex.input;
         if (got_int) {
           break;
         }
@@ -5453,7 +5602,7 @@ do_class:
 
   case NEWL:
     while (count < maxcount
-           && ((*scan == NUL && reglnum <= rex.reg_maxline && !rex.reg_line_lbr
+           && ((*scan == NUL && rex.lnum <= rex.reg_maxline && !rex.reg_line_lbr
                 && REG_MULTI) || (*scan == '\n' && rex.reg_line_lbr))) {
       count++;
       if (rex.reg_line_lbr) {
@@ -5461,21 +5610,21 @@ do_class:
       } else {
         reg_nextline();
       }
-      scan = reginput;
+      scan = rex.input;
       if (got_int)
         break;
     }
     break;
 
   default:                      /* Oh dear.  Called inappropriately. */
-    EMSG(_(e_re_corr));
+    reg_exec_emsg(_(e_re_corr));
 #ifdef REGEXP_DEBUG
     printf("Called regrepeat with op code %d\n", OP(p));
 #endif
     break;
   }
 
-  reginput = scan;
+  rex.input = scan;
 
   return (int)count;
 }
@@ -5511,13 +5660,13 @@ static int prog_magic_wrong(void)
   regprog_T   *prog;
 
   prog = REG_MULTI ? rex.reg_mmatch->regprog : rex.reg_match->regprog;
-  if (prog->engine == &nfa_regengine) {
-    // For NFA matcher we don't check the magic
+  if (prog->engine == &nfa_regengine || prog->engine == &dfa_regengine) {
+    // For NFA and DFA matcher we don't check the magic
     return false;
   }
 
   if (UCHARAT(((bt_regprog_T *)prog)->program) != REGMAGIC) {
-    EMSG(_(e_re_corr));
+    reg_exec_emsg(_(e_re_corr));
     return TRUE;
   }
   return FALSE;
@@ -5530,7 +5679,7 @@ static int prog_magic_wrong(void)
  */
 static void cleanup_subexpr(void)
 {
-  if (need_clear_subexpr) {
+  if (rex.need_clear_subexpr) {
     if (REG_MULTI) {
       // Use 0xff to set lnum to -1
       memset(rex.reg_startpos, 0xff, sizeof(lpos_T) * NSUBEXP);
@@ -5539,22 +5688,22 @@ static void cleanup_subexpr(void)
       memset(rex.reg_startp, 0, sizeof(char_u *) * NSUBEXP);
       memset(rex.reg_endp, 0, sizeof(char_u *) * NSUBEXP);
     }
-    need_clear_subexpr = FALSE;
+    rex.need_clear_subexpr = FALSE;
   }
 }
 
 static void cleanup_zsubexpr(void)
 {
-  if (need_clear_zsubexpr) {
+  if (rex.need_clear_zsubexpr) {
     if (REG_MULTI) {
       /* Use 0xff to set lnum to -1 */
-      memset(reg_startzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
-      memset(reg_endzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+      memset(rex.reg_startzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+      memset(rex.reg_endzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
     } else {
-      memset(reg_startzp, 0, sizeof(char_u *) * NSUBEXP);
-      memset(reg_endzp, 0, sizeof(char_u *) * NSUBEXP);
+      memset(rex.reg_startzp, 0, sizeof(char_u *) * NSUBEXP);
+      memset(rex.reg_endzp, 0, sizeof(char_u *) * NSUBEXP);
     }
-    need_clear_zsubexpr = FALSE;
+    rex.need_clear_zsubexpr = FALSE;
   }
 }
 
@@ -5566,10 +5715,10 @@ static void save_subexpr(regbehind_T *bp)
 {
   int i;
 
-  // When "need_clear_subexpr" is set we don't need to save the values, only
+  // When "rex.need_clear_subexpr" is set we don't need to save the values, only
   // remember that this flag needs to be set again when restoring.
-  bp->save_need_clear_subexpr = need_clear_subexpr;
-  if (!need_clear_subexpr) {
+  bp->save_need_clear_subexpr = rex.need_clear_subexpr;
+  if (!rex.need_clear_subexpr) {
     for (i = 0; i < NSUBEXP; ++i) {
       if (REG_MULTI) {
         bp->save_start[i].se_u.pos = rex.reg_startpos[i];
@@ -5590,8 +5739,8 @@ static void restore_subexpr(regbehind_T *bp)
   int i;
 
   /* Only need to restore saved values when they are not to be cleared. */
-  need_clear_subexpr = bp->save_need_clear_subexpr;
-  if (!need_clear_subexpr) {
+  rex.need_clear_subexpr = bp->save_need_clear_subexpr;
+  if (!rex.need_clear_subexpr) {
     for (i = 0; i < NSUBEXP; ++i) {
       if (REG_MULTI) {
         rex.reg_startpos[i] = bp->save_start[i].se_u.pos;
@@ -5605,13 +5754,13 @@ static void restore_subexpr(regbehind_T *bp)
 }
 
 /*
- * Advance reglnum, regline and reginput to the next line.
+ * Advance rex.lnum, rex.line and rex.input to the next line.
  */
 static void reg_nextline(void)
 {
-  regline = reg_getline(++reglnum);
-  reginput = regline;
-  fast_breakcheck();
+  rex.line = reg_getline(++rex.lnum);
+  rex.input = rex.line;
+  reg_fast_breakcheck();
 }
 
 /*
@@ -5620,10 +5769,10 @@ static void reg_nextline(void)
 static void reg_save(regsave_T *save, garray_T *gap)
 {
   if (REG_MULTI) {
-    save->rs_u.pos.col = (colnr_T)(reginput - regline);
-    save->rs_u.pos.lnum = reglnum;
+    save->rs_u.pos.col = (colnr_T)(rex.input - rex.line);
+    save->rs_u.pos.lnum = rex.lnum;
   } else
-    save->rs_u.ptr = reginput;
+    save->rs_u.ptr = rex.input;
   save->rs_len = gap->ga_len;
 }
 
@@ -5633,15 +5782,15 @@ static void reg_save(regsave_T *save, garray_T *gap)
 static void reg_restore(regsave_T *save, garray_T *gap)
 {
   if (REG_MULTI) {
-    if (reglnum != save->rs_u.pos.lnum) {
+    if (rex.lnum != save->rs_u.pos.lnum) {
       /* only call reg_getline() when the line number changed to save
        * a bit of time */
-      reglnum = save->rs_u.pos.lnum;
-      regline = reg_getline(reglnum);
+      rex.lnum = save->rs_u.pos.lnum;
+      rex.line = reg_getline(rex.lnum);
     }
-    reginput = regline + save->rs_u.pos.col;
+    rex.input = rex.line + save->rs_u.pos.col;
   } else
-    reginput = save->rs_u.ptr;
+    rex.input = save->rs_u.ptr;
   gap->ga_len = save->rs_len;
 }
 
@@ -5651,9 +5800,9 @@ static void reg_restore(regsave_T *save, garray_T *gap)
 static int reg_save_equal(regsave_T *save)
 {
   if (REG_MULTI)
-    return reglnum == save->rs_u.pos.lnum
-           && reginput == regline + save->rs_u.pos.col;
-  return reginput == save->rs_u.ptr;
+    return rex.lnum == save->rs_u.pos.lnum
+           && rex.input == rex.line + save->rs_u.pos.col;
+  return rex.input == save->rs_u.ptr;
 }
 
 /*
@@ -5666,14 +5815,14 @@ static int reg_save_equal(regsave_T *save)
 static void save_se_multi(save_se_T *savep, lpos_T *posp)
 {
   savep->se_u.pos = *posp;
-  posp->lnum = reglnum;
-  posp->col = (colnr_T)(reginput - regline);
+  posp->lnum = rex.lnum;
+  posp->col = (colnr_T)(rex.input - rex.line);
 }
 
 static void save_se_one(save_se_T *savep, char_u **pp)
 {
   savep->se_u.ptr = *pp;
-  *pp = reginput;
+  *pp = rex.input;
 }
 
 /*
@@ -5706,23 +5855,26 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
   if (bytelen != NULL)
     *bytelen = 0;
   for (;; ) {
-    /* Since getting one line may invalidate the other, need to make copy.
-     * Slow! */
-    if (regline != reg_tofree) {
-      len = (int)STRLEN(regline);
+    // Since getting one line may invalidate the other, need to make copy.
+    // Slow!  Not needed when the other line is available already.
+    p = reg_getline_cached(clnum);
+    if (p == NULL && rex.line != reg_tofree) {
+      len = (int)STRLEN(rex.line);
       if (reg_tofree == NULL || len >= (int)reg_tofreelen) {
         len += 50;              /* get some extra */
         xfree(reg_tofree);
         reg_tofree = xmalloc(len);
         reg_tofreelen = len;
       }
-      STRCPY(reg_tofree, regline);
-      reginput = reg_tofree + (reginput - regline);
-      regline = reg_tofree;
+      STRCPY(reg_tofree, rex.line);
+      rex.input = reg_tofree + (rex.input - rex.line);
+      rex.line = reg_tofree;
     }
 
-    /* Get the line to compare with. */
-    p = reg_getline(clnum);
+    // Get the line to compare with.
+    if (p == NULL) {
+      p = reg_getline(clnum);
+    }
     assert(p);
 
     if (clnum == end_lnum)
@@ -5730,14 +5882,14 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
     else
       len = (int)STRLEN(p + ccol);
 
-    if (cstrncmp(p + ccol, reginput, &len) != 0)
+    if (cstrncmp(p + ccol, rex.input, &len) != 0)
       return RA_NOMATCH;        /* doesn't match */
     if (bytelen != NULL)
       *bytelen += len;
     if (clnum == end_lnum) {
       break;  // match and at end!
     }
-    if (reglnum >= rex.reg_maxline) {
+    if (rex.lnum >= rex.reg_maxline) {
       return RA_NOMATCH;  // text too short
     }
 
@@ -5751,7 +5903,7 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
       return RA_FAIL;
   }
 
-  /* found a match!  Note that regline may now point to a copy of the line,
+  /* found a match!  Note that rex.line may now point to a copy of the line,
    * that should not matter. */
   return RA_MATCH;
 }
@@ -6512,6 +6664,8 @@ int vim_regsub(regmatch_T *rmp, char_u *source, typval_T *expr, char_u *dest,
     rex_save = rex;
   }
   rex_in_use = true;
+  rex.reg_shared = false;
+  rex.reg_use_blocks = false;
 
   rex.reg_match = rmp;
   rex.reg_mmatch = NULL;
@@ -6538,6 +6692,8 @@ int vim_regsub_multi(regmmatch_T *rmp, linenr_T lnum, char_u *source, char_u *de
     rex_save = rex;
   }
   rex_in_use = true;
+  rex.reg_shared = false;
+  rex.reg_use_blocks = false;
 
   rex.reg_match = NULL;
   rex.reg_mmatch = rmp;
@@ -7071,15 +7227,51 @@ static regengine_T nfa_regengine =
   (char_u *)""
 };
 
+// XXX Do not allow headers generator to catch definitions from regexp_dfa.c
+#ifndef DO_NOT_DEFINE_EMPTY_ATTRIBUTES
+# include "nvim/regexp_dfa.c"
+#endif
+
+static regengine_T dfa_regengine =
+{
+  dfa_regcomp,
+  dfa_regfree,
+  dfa_regexec_nl,
+  dfa_regexec_multi,
+  (char_u *)""
+};
+
 /* Which regexp engine to use? Needed for vim_regcomp().
  * Must match with 'regexpengine'. */
 static int regexp_engine = 0;
 
+// Compiled programs are kept, so that compiling the same pattern again is
+// fast.  Used by vim_regcomp().
+#define REGPROG_CACHE_SIZE 64
+
+/// Entry in the cache of compiled programs.  Everything that changes what
+/// vim_regcomp() produces for a pattern is part of the key.
+typedef struct {
+  char_u *pat;         ///< pattern, NULL for an unused entry
+  hash_T hash;         ///< hash of "pat"
+  int re_flags;        ///< second argument of vim_regcomp()
+  long engine;         ///< 'regexpengine'
+  bool cpo_lit;        ///< 'cpoptions' contains 'l'
+  int do_extmatch;     ///< "reg_do_extmatch"
+  int had_eol;         ///< value for vim_regcomp_had_eol()
+  uint64_t used;       ///< "regprog_cache_tick" when last used
+  regprog_T *prog;     ///< the program, one reference is for the cache
+} regprog_cache_T;
+
+static regprog_cache_T regprog_cache[REGPROG_CACHE_SIZE];
+static uint64_t regprog_cache_tick = 0;
+
 #ifdef REGEXP_DEBUG
 static char_u regname[][30] = {
   "AUTOMATIC Regexp Engine",
   "BACKTRACKING Regexp Engine",
-  "NFA Regexp Engine"
+  "NFA Regexp Engine",
+  "DFA Regexp Engine"
 };
 #endif
 
@@ -7102,7 +7294,8 @@ regprog_T *vim_regcomp(char_u *expr_arg, int re_flags)
 
     if (newengine == AUTOMATIC_ENGINE
         || newengine == BACKTRACKING_ENGINE
-        || newengine == NFA_ENGINE) {
+        || newengine == NFA_ENGINE
+        || newengine == DFA_ENGINE) {
       regexp_engine = expr[4] - '0';
       expr += 5;
 #ifdef REGEXP_DEBUG
@@ -7112,18 +7305,38 @@ regprog_T *vim_regcomp(char_u *expr_arg, int re_flags)
 #endif
     } else {
       EMSG(_(
-              "E864: \\%#= can only be followed by 0, 1, or 2. The automatic engine will be used "));
+              "E864: \\%#= can only be followed by 0, 1, 2, or 3. The automatic engine will be used "));
       regexp_engine = AUTOMATIC_ENGINE;
     }
   }
+
+  // Patterns with "~" depend on the last substitute string, don't cache them.
+  bool cacheable = vim_strchr(expr_arg, '~') == NULL;
+  hash_T hash = 0;
+  if (cacheable) {
+    hash = hash_hash(expr_arg);
+    regprog_cache_T *entry = regprog_cache_find(expr_arg, hash, re_flags);
+    if (entry != NULL) {
+      g_stats.regprog_hits++;
+      had_eol = entry->had_eol;
+      entry->prog->re_refcount++;
+      return entry->prog;
+    }
+  }
+  g_stats.regprog_misses++;
+
   bt_regengine.expr = expr;
   nfa_regengine.expr = expr;
+  dfa_regengine.expr = expr;
 
   /*
-   * First try the NFA engine, unless backtracking was requested.
+   * First try the DFA engine, which uses the NFA engine for patterns it can't
+   * handle, unless backtracking or NFA was requested.
    */
-  if (regexp_engine != BACKTRACKING_ENGINE) {
-    prog = nfa_regengine.regcomp(expr,
+  if (regexp_engine == NFA_ENGINE) {
+    prog = nfa_regengine.regcomp(expr, re_flags);
+  } else if (regexp_engine != BACKTRACKING_ENGINE) {
+    prog = dfa_regengine.regcomp(expr,
         re_flags + (regexp_engine == AUTOMATIC_ENGINE ? RE_AUTO : 0));
   } else {
     prog = bt_regengine.regcomp(expr, re_flags);
@@ -7157,18 +7370,99 @@ regprog_T *vim_regcomp(char_u *expr_arg, int re_flags)
     // to be very slow when executing it.
     prog->re_engine = regexp_engine;
     prog->re_flags = re_flags;
+    prog->re_refcount = 1;
+    if (cacheable) {
+      regprog_cache_add(expr_arg, hash, re_flags, prog);
+    }
   }
 
   return prog;
 }
 
-/*
- * Free a compiled regexp program, returned by vim_regcomp().
- */
+/// Find the entry for pattern "pat" with hash "hash" compiled with "re_flags"
+/// and the current option values.
+static regprog_cache_T *regprog_cache_find(const char_u *pat, hash_T hash,
+                                           int re_flags)
+{
+  bool cpo_lit = vim_strchr(p_cpo, CPO_LITERAL) != NULL;
+
+  for (int i = 0; i < REGPROG_CACHE_SIZE; i++) {
+    regprog_cache_T *entry = &regprog_cache[i];
+
+    if (entry->pat != NULL
+        && entry->hash == hash
+        && entry->re_flags == re_flags
+        && entry->engine == p_re
+        && entry->cpo_lit == cpo_lit
+        && entry->do_extmatch == reg_do_extmatch
+        && STRCMP(entry->pat, pat) == 0) {
+      entry->used = ++regprog_cache_tick;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/// Add "prog", just compiled from "pat", to the cache.  Replaces the least
+/// recently used entry when the cache is full.
+static void regprog_cache_add(const char_u *pat, hash_T hash, int re_flags,
+                              regprog_T *prog)
+{
+  regprog_cache_T *entry = &regprog_cache[0];
+
+  for (int i = 0; i < REGPROG_CACHE_SIZE; i++) {
+    if (regprog_cache[i].pat == NULL) {
+      entry = &regprog_cache[i];
+      break;
+    }
+    if (regprog_cache[i].used < entry->used) {
+      entry = &regprog_cache[i];
+    }
+  }
+  if (entry->pat != NULL) {
+    g_stats.regprog_evictions++;
+    regprog_cache_free_entry(entry);
+  }
+
+  entry->pat = vim_strsave(pat);
+  entry->hash = hash;
+  entry->re_flags = re_flags;
+  entry->engine = p_re;
+  entry->cpo_lit = vim_strchr(p_cpo, CPO_LITERAL) != NULL;
+  entry->do_extmatch = reg_do_extmatch;
+  entry->had_eol = had_eol;
+  entry->used = ++regprog_cache_tick;
+  entry->prog = prog;
+  prog->re_refcount++;
+}
+
+static void regprog_cache_free_entry(regprog_cache_T *entry)
+{
+  xfree(entry->pat);
+  entry->pat = NULL;
+  vim_regfree(entry->prog);
+  entry->prog = NULL;
+}
+
+/// Free all compiled programs kept by vim_regcomp() that are not used
+/// elsewhere.
+void regprog_cache_clear(void)
+{
+  for (int i = 0; i < REGPROG_CACHE_SIZE; i++) {
+    if (regprog_cache[i].pat != NULL) {
+      regprog_cache_free_entry(&regprog_cache[i]);
+    }
+  }
+}
+
+/// Free a compiled regexp program, returned by vim_regcomp().
+/// The program may also be used elsewhere, it is only freed when the last
+/// user is done with it.
 void vim_regfree(regprog_T *prog)
 {
-  if (prog != NULL)
+  if (prog != NULL && --prog->re_refcount == 0) {
     prog->engine->regfree(prog);
+  }
 }
 
 static void report_re_switch(char_u *pat)
@@ -7203,6 +7497,8 @@ static int vim_regexec_both(regmatch_T *rmp, char_u *line, colnr_T col, bool nl)
     rex_save = rex;
   }
   rex_in_use = true;
+  rex.reg_shared = false;
+  rex.reg_use_blocks = false;
   rex.reg_startp = NULL;
   rex.reg_endp = NULL;
   rex.reg_startpos = NULL;
@@ -7263,6 +7559,49 @@ int vim_regexec_nl(regmatch_T *rmp, char_u *line, colnr_T col)
   return vim_regexec_both(rmp, line, col, true);
 }
 
+/// Like vim_regexec(), but can be used on a worker thread while the main
+/// thread is matching too.  "rmp->regprog" is not changed, no messages are
+/// given and typed keys are not checked ("got_int" is still obeyed).
+/// Only for programs for which re_shareable() returns true.
+/// Uses 'iskeyword' of "buf", which must not change meanwhile.
+/// A worker thread must call regexp_free_thread_state() before exiting.
+///
+/// @return 1 if there is a match, 0 if not, NFA_TOO_EXPENSIVE when the match
+///         must be done again on the main thread with vim_regexec().
+int vim_regexec_shared(regmatch_T *rmp, buf_T *buf, char_u *line,
+                       colnr_T col)
+{
+  regexec_T rex_save;
+  bool rex_in_use_save = rex_in_use;
+
+  if (rex_in_use) {
+    rex_save = rex;
+  }
+  rex_in_use = true;
+  rex.reg_use_blocks = false;
+  rex.reg_shared = true;
+  rex.reg_exec_error = false;
+  rex.reg_buf = buf;
+  rex.reg_startp = NULL;
+  rex.reg_endp = NULL;
+  rex.reg_startpos = NULL;
+  rex.reg_endpos = NULL;
+
+  int result = rmp->regprog->engine->regexec_nl(rmp, line, col, false);
+  if (rex.reg_exec_error || result < 0) {
+    result = NFA_TOO_EXPENSIVE;
+  } else {
+    result = result > 0;
+  }
+
+  rex_in_use = rex_in_use_save;
+  if (rex_in_use) {
+    rex = rex_save;
+  }
+
+  return result;
+}
+
 /*
  * Match a regexp against multiple lines.
  * "rmp->regprog" is a compiled regexp as returned by vim_regcomp().
@@ -7289,6 +7628,9 @@ long vim_regexec_multi(
     rex_save = rex;
   }
   rex_in_use = true;
+  rex.reg_shared = false;
+  rex.reg_use_blocks = true;
+  reg_blocks_clear();
 
   int result = rmp->regprog->engine->regexec_multi(rmp, win, buf, lnum, col,
                                                    tm);
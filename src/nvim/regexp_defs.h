@@ -41,6 +41,7 @@
 #define AUTOMATIC_ENGINE    0
 #define BACKTRACKING_ENGINE 1
 #define NFA_ENGINE          2
+#define DFA_ENGINE          3
 
 typedef struct regengine regengine_T;
 typedef struct regprog regprog_T;
@@ -70,8 +71,9 @@ typedef struct {
 struct regprog {
   regengine_T *engine;
   unsigned regflags;
-  unsigned re_engine;  ///< Automatic, backtracking or NFA engine.
+  unsigned re_engine;  ///< Automatic, backtracking, NFA or DFA engine.
   unsigned re_flags;   ///< Second argument for vim_regcomp().
+  int re_refcount;     ///< Number of users, see vim_regfree().
 };
 
 /*
@@ -80,11 +82,12 @@ struct regprog {
  * See regexp.c for an explanation.
  */
 typedef struct {
-  // These four members implement regprog_T.
+  // These five members implement regprog_T.
   regengine_T *engine;
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;  ///< Second argument for vim_regcomp().
+  int re_refcount;
 
   int regstart;
   char_u reganch;
@@ -103,26 +106,30 @@ struct nfa_state {
   int c;
   nfa_state_T         *out;
   nfa_state_T         *out1;
-  int id;
-  int lastlist[2];                   /* 0: normal, 1: recursive */
+  int id;                            // index in the program's states
   int val;
 };
 
+typedef struct dfa_cache dfa_cache_T;
+typedef struct nfa_literals nfa_literals_T;
+
 /*
  * Structure used by the NFA matcher.
  */
 typedef struct {
-  // These four members implement regprog_T.
+  // These five members implement regprog_T.
   regengine_T *engine;
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;  ///< Second argument for vim_regcomp().
+  int re_refcount;
 
   nfa_state_T         *start;           /* points into state[] */
 
   int reganch;                          /* pattern starts with ^ */
   int regstart;                         /* char at start of pattern */
   char_u              *match_text;      /* plain text to match with */
+  nfa_literals_T      *literals;        ///< texts a match starts with
 
   int has_zend;                         /* pattern contains \ze */
   int has_backref;                      /* pattern contains \1 .. \9 */
@@ -130,6 +137,7 @@ typedef struct {
   char_u              *pattern;
   int nsubexp;                          /* number of () */
   int nstate;
+  dfa_cache_T *dfa;                     ///< states built by the DFA matcher
   nfa_state_T state[1];                 /* actually longer.. */
 } nfa_regprog_T;
 
@@ -0,0 +1,638 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/*
+ * Lazy DFA regular expression implementation.
+ *
+ * This file is included in "regexp.c", after "regexp_nfa.c".
+ *
+ * The pattern is compiled by the NFA compiler.  While matching, each set of
+ * NFA states that can be active at the same position becomes a DFA state and
+ * the transitions between them are remembered, thus a line is checked in
+ * time linear to its length and mostly without recomputing anything.
+ * The DFA only tells whether a match is possible; when it is, the NFA
+ * matcher finds the match position and the submatches.  Atoms that depend on
+ * the position in the buffer, such as "\%23l", are assumed to match, thus
+ * the DFA may say a match is possible when there is none, but never the
+ * other way around.
+ * Patterns with atoms the DFA can't handle, such as back references and
+ * look-around, use the NFA engine.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvim/lib/kvec.h"
+
+#define DFA_MAX_STATES  1000  // clear the cache when there are more states
+#define DFA_MAX_FLUSHES 8     // stop using the DFA after clearing this often
+#define DFA_HASH_SIZE   256   // number of hash buckets, a power of two
+#define DFA_NCACHED     128   // transitions are only cached for ASCII
+
+typedef struct dfa_state dfa_state_T;
+struct dfa_state {
+  dfa_state_T *hash_next;      ///< next state in the same hash bucket
+  uint16_t next[DFA_NCACHED];  ///< index + 1 in "states" of the state after
+                               ///< a character, zero when not computed yet
+  int idx;                     ///< index in "states", -1 for the start state
+  bool match;                  ///< a match ends at this position
+  bool eol_match;              ///< a match ends here at the end of the line
+  int nids;                    ///< number of items in "ids"
+  int ids[1];                  ///< sorted ids of the NFA states that wait
+                               ///< for a character or the end of the line,
+                               ///< actually longer
+};
+
+/// Lazily built DFA for an NFA program.
+struct dfa_cache {
+  kvec_t(dfa_state_T *) states;         ///< states other than "start_bol"
+  dfa_state_T *buckets[DFA_HASH_SIZE];  ///< hash table on "ids" and "match"
+  dfa_state_T *start_bol;  ///< state at the start of the line
+  dfa_state_T *start;      ///< state at a column after the start of the line
+  bool ic;                 ///< value of "rex.reg_ic" the states are for
+  int flushes;             ///< number of times the cache was cleared
+  bool disabled;           ///< too many states, only use the NFA
+
+  // Used while computing a state.
+  int nstate;                       ///< number of NFA states
+  int *mark;                        ///< per NFA state: "gen" when visited
+  int gen;
+  kvec_t(int) ids;                  ///< ids of the state being computed
+  kvec_t(nfa_state_T *) stack;      ///< NFA states to be visited
+};
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "regexp_dfa.c.generated.h"
+#endif
+
+/*
+ * Compile a regular expression for the DFA matcher.  Uses the NFA compiler,
+ * when the DFA can't handle the pattern the program is for the NFA engine.
+ * Returns the program in allocated space.  Returns NULL for an error.
+ */
+static regprog_T *dfa_regcomp(char_u *expr, int re_flags)
+{
+  regprog_T *prog = nfa_regcomp(expr, re_flags);
+
+  // A pattern that is only literal text is found faster by the NFA engine.
+  if (prog != NULL
+      && !(prog->regflags & RF_HASNL)
+      && ((nfa_regprog_T *)prog)->match_text == NULL
+      && dfa_can_handle((nfa_regprog_T *)prog)) {
+    prog->engine = &dfa_regengine;
+  }
+  return prog;
+}
+
+/// Check whether all states of NFA program "prog" can be handled by the DFA.
+static bool dfa_can_handle(nfa_regprog_T *prog)
+{
+  kvec_t(nfa_state_T *) stack = KV_INITIAL_VALUE;
+  bool *seen = xcalloc((size_t)prog->nstate, sizeof(*seen));
+  bool ok = true;
+
+  kv_push(stack, prog->start);
+  while (ok && kv_size(stack) > 0) {
+    nfa_state_T *state = kv_pop(stack);
+
+    if (state == NULL || seen[state->id]) {
+      continue;
+    }
+    seen[state->id] = true;
+
+    switch (state->c) {
+    case NFA_BACKREF1:
+    case NFA_BACKREF2:
+    case NFA_BACKREF3:
+    case NFA_BACKREF4:
+    case NFA_BACKREF5:
+    case NFA_BACKREF6:
+    case NFA_BACKREF7:
+    case NFA_BACKREF8:
+    case NFA_BACKREF9:
+    case NFA_ZREF1:
+    case NFA_ZREF2:
+    case NFA_ZREF3:
+    case NFA_ZREF4:
+    case NFA_ZREF5:
+    case NFA_ZREF6:
+    case NFA_ZREF7:
+    case NFA_ZREF8:
+    case NFA_ZREF9:
+    case NFA_SKIP:
+    case NFA_START_INVISIBLE:
+    case NFA_START_INVISIBLE_FIRST:
+    case NFA_START_INVISIBLE_NEG:
+    case NFA_START_INVISIBLE_NEG_FIRST:
+    case NFA_START_INVISIBLE_BEFORE:
+    case NFA_START_INVISIBLE_BEFORE_FIRST:
+    case NFA_START_INVISIBLE_BEFORE_NEG:
+    case NFA_START_INVISIBLE_BEFORE_NEG_FIRST:
+    case NFA_START_PATTERN:
+    case NFA_COMPOSING:
+    case NFA_NEWL:
+    // Depends on 'isprint' and can be negated.
+    case NFA_CLASS_PRINT:
+      ok = false;
+      break;
+
+    default:
+      kv_push(stack, state->out);
+      kv_push(stack, state->out1);
+      break;
+    }
+  }
+
+  xfree(seen);
+  kv_destroy(stack);
+  return ok;
+}
+
+/*
+ * Free a compiled regexp program, returned by dfa_regcomp().
+ */
+static void dfa_regfree(regprog_T *prog)
+{
+  if (prog != NULL) {
+    dfa_cache_T *cache = ((nfa_regprog_T *)prog)->dfa;
+
+    if (cache != NULL) {
+      dfa_clear(cache);
+      kv_destroy(cache->states);
+      kv_destroy(cache->ids);
+      kv_destroy(cache->stack);
+      xfree(cache->mark);
+      xfree(cache);
+    }
+    nfa_regfree(prog);
+  }
+}
+
+/// Free all states in "cache".
+static void dfa_clear(dfa_cache_T *cache)
+{
+  for (size_t i = 0; i < kv_size(cache->states); i++) {
+    xfree(kv_A(cache->states, i));
+  }
+  kv_size(cache->states) = 0;
+  xfree(cache->start_bol);
+  cache->start_bol = NULL;
+  cache->start = NULL;
+  memset(cache->buckets, 0, sizeof(cache->buckets));
+}
+
+/*
+ * Match a regexp against a string, see nfa_regexec_nl().
+ * When the DFA finds that there can't be a match the NFA isn't used.
+ */
+static int dfa_regexec_nl(regmatch_T *rmp, char_u *line, colnr_T col,
+                          bool line_lbr)
+{
+  // The cache is changed while matching, thus it can't be used when another
+  // thread may be matching with the same program.
+  if (!rex.reg_shared
+      && !dfa_may_match((nfa_regprog_T *)rmp->regprog, line, col,
+                        rmp->rm_ic)) {
+    return 0;
+  }
+  return nfa_regexec_nl(rmp, line, col, line_lbr);
+}
+
+/// Match a regexp against multiple lines, see nfa_regexec_multi().
+/// The pattern can't match a line break, thus when the DFA finds that there
+/// can't be a match in line "lnum" the NFA isn't used.
+static long dfa_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf,
+                              linenr_T lnum, colnr_T col, proftime_T *tm)
+{
+  if (!rex.reg_shared
+      && lnum <= buf->b_ml.ml_line_count
+      && !dfa_may_match((nfa_regprog_T *)rmp->regprog,
+                        ml_get_buf(buf, lnum, false), col, rmp->rmm_ic)) {
+    return 0;
+  }
+  return nfa_regexec_multi(rmp, win, buf, lnum, col, tm);
+}
+
+/// Run the DFA of "prog" over "line", starting at column "col".
+///
+/// @param ic  ignore case, unless the pattern contains "\c" or "\C"
+///
+/// @return false when there can't be a match, true when there may be one.
+static bool dfa_may_match(nfa_regprog_T *prog, char_u *line, colnr_T col,
+                          bool ic)
+{
+  dfa_cache_T *cache = prog->dfa;
+
+  if (cache == NULL) {
+    cache = xcalloc(1, sizeof(*cache));
+    cache->nstate = prog->nstate;
+    cache->mark = xcalloc((size_t)prog->nstate, sizeof(*cache->mark));
+    cache->ic = ic;
+    prog->dfa = cache;
+  }
+  if (cache->disabled) {
+    return true;
+  }
+
+  if (prog->regflags & RF_ICASE) {
+    ic = true;
+  } else if (prog->regflags & RF_NOICASE) {
+    ic = false;
+  }
+  if (cache->ic != ic) {
+    // Cached transitions are for the other value.
+    dfa_clear(cache);
+    cache->ic = ic;
+  }
+
+  // Get "start" first, creating it may clear the cache.
+  if (cache->start == NULL) {
+    cache->start = dfa_start_state(cache, prog, false);
+    if (cache->start == NULL) {
+      return true;
+    }
+  }
+  dfa_state_T *state = cache->start;
+  if (col == 0) {
+    if (cache->start_bol == NULL) {
+      cache->start_bol = dfa_start_state(cache, prog, true);
+    }
+    state = cache->start_bol;
+  }
+
+  char_u *p = line + col;
+  for (;;) {
+    if (state == NULL || state->match) {
+      // Gave up on the DFA or found a match.
+      return true;
+    }
+    if (state == cache->start && prog->literals != NULL) {
+      // No match in progress, skip ahead to where one can start.
+      colnr_T skipcol = (colnr_T)(p - line);
+      if (skip_to_literals(prog->literals, line, &skipcol, ic) == FAIL) {
+        return false;
+      }
+      p = line + skipcol;
+    }
+    if (*p == NUL) {
+      return state->eol_match;
+    }
+    if (state->nids == 0) {
+      // Nothing is waiting and there is no match at a later position, the
+      // pattern must be anchored at the start of the line.
+      return false;
+    }
+
+    int c = utf_ptr2char(p);
+    int len = utfc_ptr2len(p);
+    if (len != utf_ptr2len(p) || utf_iscomposing(c)) {
+      // Composing characters are left to the NFA.
+      return true;
+    }
+
+    if (c < DFA_NCACHED && state->next[c] != 0) {
+      state = kv_A(cache->states, state->next[c] - 1);
+    } else {
+      int flushes = cache->flushes;
+      dfa_state_T *next = dfa_next_state(cache, prog, state, c);
+
+      // When the cache was cleared "state" was freed.
+      if (next != NULL && c < DFA_NCACHED && cache->flushes == flushes) {
+        state->next[c] = (uint16_t)(next->idx + 1);
+      }
+      state = next;
+    }
+    p += len;
+  }
+}
+
+/// Get the state at the start of the match.
+///
+/// @param bol  at the start of the line
+static dfa_state_T *dfa_start_state(dfa_cache_T *cache, nfa_regprog_T *prog,
+                                    bool bol)
+{
+  kv_push(cache->stack, prog->start);
+  bool match = dfa_closure(cache, bol, false);
+  return dfa_add_state(cache, prog, match, bol);
+}
+
+/// Get the state that follows "state" after character "c".
+/// Returns NULL when the DFA has been disabled.
+static dfa_state_T *dfa_next_state(dfa_cache_T *cache, nfa_regprog_T *prog,
+                                   dfa_state_T *state, int c)
+{
+  for (int i = 0; i < state->nids; i++) {
+    nfa_state_T *next = dfa_step(&prog->state[state->ids[i]], c, cache->ic);
+    if (next != NULL) {
+      kv_push(cache->stack, next);
+    }
+  }
+  // A match may also start at the next position.
+  kv_push(cache->stack, prog->start);
+
+  bool match = dfa_closure(cache, false, false);
+  return dfa_add_state(cache, prog, match, false);
+}
+
+/// Add the NFA states on the stack of "cache" and the states reached from
+/// them without consuming a character to "cache->ids".
+///
+/// @param bol  at the start of the line
+/// @param eol  at the end of the line
+///
+/// @return true when the end of the pattern was reached.
+static bool dfa_closure(dfa_cache_T *cache, bool bol, bool eol)
+{
+  bool match = false;
+
+  if (cache->gen == INT_MAX) {
+    // Avoid overflow, start again with all marks cleared.
+    memset(cache->mark, 0, (size_t)cache->nstate * sizeof(*cache->mark));
+    cache->gen = 0;
+  }
+  cache->gen++;
+  kv_size(cache->ids) = 0;
+
+  while (kv_size(cache->stack) > 0) {
+    nfa_state_T *state = kv_pop(cache->stack);
+
+    if (cache->mark[state->id] == cache->gen) {
+      continue;
+    }
+    cache->mark[state->id] = cache->gen;
+
+    switch (state->c) {
+    case NFA_MATCH:
+      match = true;
+      break;
+
+    case NFA_SPLIT:
+      kv_push(cache->stack, state->out1);
+      kv_push(cache->stack, state->out);
+      break;
+
+    case NFA_BOL:
+    case NFA_BOF:
+      if (bol) {
+        kv_push(cache->stack, state->out);
+      }
+      break;
+
+    case NFA_EOL:
+    case NFA_EOF:
+      if (eol) {
+        kv_push(cache->stack, state->out);
+      } else {
+        // Continued when the end of the line is reached.
+        kv_push(cache->ids, state->id);
+      }
+      break;
+
+    // Zero-width atoms that depend on something the DFA doesn't know about
+    // are assumed to match.
+    case NFA_EMPTY:
+    case NFA_MOPEN:
+    case NFA_MOPEN1:
+    case NFA_MOPEN2:
+    case NFA_MOPEN3:
+    case NFA_MOPEN4:
+    case NFA_MOPEN5:
+    case NFA_MOPEN6:
+    case NFA_MOPEN7:
+    case NFA_MOPEN8:
+    case NFA_MOPEN9:
+    case NFA_MCLOSE:
+    case NFA_MCLOSE1:
+    case NFA_MCLOSE2:
+    case NFA_MCLOSE3:
+    case NFA_MCLOSE4:
+    case NFA_MCLOSE5:
+    case NFA_MCLOSE6:
+    case NFA_MCLOSE7:
+    case NFA_MCLOSE8:
+    case NFA_MCLOSE9:
+    case NFA_ZOPEN:
+    case NFA_ZOPEN1:
+    case NFA_ZOPEN2:
+    case NFA_ZOPEN3:
+    case NFA_ZOPEN4:
+    case NFA_ZOPEN5:
+    case NFA_ZOPEN6:
+    case NFA_ZOPEN7:
+    case NFA_ZOPEN8:
+    case NFA_ZOPEN9:
+    case NFA_ZCLOSE:
+    case NFA_ZCLOSE1:
+    case NFA_ZCLOSE2:
+    case NFA_ZCLOSE3:
+    case NFA_ZCLOSE4:
+    case NFA_ZCLOSE5:
+    case NFA_ZCLOSE6:
+    case NFA_ZCLOSE7:
+    case NFA_ZCLOSE8:
+    case NFA_ZCLOSE9:
+    case NFA_NOPEN:
+    case NFA_NCLOSE:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_ANY_COMPOSING:
+    case NFA_LNUM:
+    case NFA_LNUM_GT:
+    case NFA_LNUM_LT:
+    case NFA_COL:
+    case NFA_COL_GT:
+    case NFA_COL_LT:
+    case NFA_VCOL:
+    case NFA_VCOL_GT:
+    case NFA_VCOL_LT:
+    case NFA_MARK:
+    case NFA_MARK_GT:
+    case NFA_MARK_LT:
+    case NFA_CURSOR:
+    case NFA_VISUAL:
+      kv_push(cache->stack, state->out);
+      break;
+
+    default:
+      // Waits for a character.
+      kv_push(cache->ids, state->id);
+      break;
+    }
+  }
+
+  return match;
+}
+
+static int dfa_id_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/// Find or add the state for the NFA states in "cache->ids".
+/// When there are too many states the cache is cleared first.
+///
+/// @param match  a match ends at this position
+/// @param bol    at the start of the line, the state is not shared
+///
+/// @return the state or NULL when the DFA has been disabled.
+static dfa_state_T *dfa_add_state(dfa_cache_T *cache, nfa_regprog_T *prog,
+                                  bool match, bool bol)
+{
+  int nids = (int)kv_size(cache->ids);
+  int *ids = cache->ids.items;
+  unsigned hash = match;
+
+  if (nids > 1) {
+    qsort(ids, (size_t)nids, sizeof(*ids), dfa_id_cmp);
+  }
+  for (int i = 0; i < nids; i++) {
+    hash = hash * 31 + (unsigned)ids[i];
+  }
+
+  dfa_state_T **bucket = &cache->buckets[hash & (DFA_HASH_SIZE - 1)];
+  if (!bol) {
+    for (dfa_state_T *s = *bucket; s != NULL; s = s->hash_next) {
+      if (s->match == match && s->nids == nids
+          && memcmp(s->ids, ids, (size_t)nids * sizeof(*ids)) == 0) {
+        return s;
+      }
+    }
+    if (kv_size(cache->states) >= DFA_MAX_STATES) {
+      dfa_clear(cache);
+      if (++cache->flushes > DFA_MAX_FLUSHES) {
+        cache->disabled = true;
+        return NULL;
+      }
+    }
+  }
+
+  dfa_state_T *state = xcalloc(1, sizeof(dfa_state_T)
+                               + (size_t)nids * sizeof(*ids));
+  memcpy(state->ids, ids, (size_t)nids * sizeof(*ids));
+  state->nids = nids;
+  state->match = match;
+  if (bol) {
+    state->idx = -1;
+  } else {
+    state->idx = (int)kv_size(cache->states);
+    kv_push(cache->states, state);
+    state->hash_next = *bucket;
+    *bucket = state;
+  }
+
+  // Find out whether a match ends here when at the end of the line.  This
+  // overwrites "cache->ids".
+  for (int i = 0; i < nids; i++) {
+    nfa_state_T *s = &prog->state[state->ids[i]];
+    if (s->c == NFA_EOL || s->c == NFA_EOF) {
+      kv_push(cache->stack, s->out);
+    }
+  }
+  if (kv_size(cache->stack) > 0) {
+    state->eol_match = dfa_closure(cache, bol, true);
+  }
+
+  return state;
+}
+
+/// Check whether NFA state "state" matches character "c", which is not NUL.
+///
+/// @return the NFA state that follows or NULL when there is no match.
+static nfa_state_T *dfa_step(nfa_state_T *state, int c, bool ic)
+{
+  bool result;
+
+  switch (state->c) {
+  case NFA_EOL:
+  case NFA_EOF:
+    return NULL;
+
+  case NFA_START_COLL:
+  case NFA_START_NEG_COLL:
+    // next state is in out of the NFA_END_COLL, out1 of START points to the
+    // END state
+    return dfa_coll_match(state, c, ic) ? state->out1->out : NULL;
+
+  // These depend on options of the buffer, the DFA can't know about them.
+  case NFA_ANY:
+  case NFA_IDENT:
+  case NFA_SIDENT:
+  case NFA_KWORD:
+  case NFA_SKWORD:
+  case NFA_FNAME:
+  case NFA_SFNAME:
+  case NFA_PRINT:
+  case NFA_SPRINT:
+    result = true;
+    break;
+
+  case NFA_WHITE:     result = ascii_iswhite(c); break;
+  case NFA_NWHITE:    result = !ascii_iswhite(c); break;
+  case NFA_DIGIT:     result = ri_digit(c); break;
+  case NFA_NDIGIT:    result = !ri_digit(c); break;
+  case NFA_HEX:       result = ri_hex(c); break;
+  case NFA_NHEX:      result = !ri_hex(c); break;
+  case NFA_OCTAL:     result = ri_octal(c); break;
+  case NFA_NOCTAL:    result = !ri_octal(c); break;
+  case NFA_WORD:      result = ri_word(c); break;
+  case NFA_NWORD:     result = !ri_word(c); break;
+  case NFA_HEAD:      result = ri_head(c); break;
+  case NFA_NHEAD:     result = !ri_head(c); break;
+  case NFA_ALPHA:     result = ri_alpha(c); break;
+  case NFA_NALPHA:    result = !ri_alpha(c); break;
+  case NFA_LOWER:     result = ri_lower(c); break;
+  case NFA_NLOWER:    result = !ri_lower(c); break;
+  case NFA_UPPER:     result = ri_upper(c); break;
+  case NFA_NUPPER:    result = !ri_upper(c); break;
+  case NFA_LOWER_IC:  result = ri_lower(c) || (ic && ri_upper(c)); break;
+  case NFA_NLOWER_IC: result = !(ri_lower(c) || (ic && ri_upper(c))); break;
+  case NFA_UPPER_IC:  result = ri_upper(c) || (ic && ri_lower(c)); break;
+  case NFA_NUPPER_IC: result = !(ri_upper(c) || (ic && ri_lower(c))); break;
+
+  default:  // regular character
+    result = state->c == c
+             || (ic && mb_tolower(state->c) == mb_tolower(c));
+    break;
+  }
+  return result ? state->out : NULL;
+}
+
+/// Check whether collection "coll", a NFA_START_COLL or NFA_START_NEG_COLL
+/// state, matches character "c".  Like the check in nfa_regmatch().
+static bool dfa_coll_match(nfa_state_T *coll, int c, bool ic)
+{
+  bool result_if_matched = coll->c == NFA_START_COLL;
+
+  for (nfa_state_T *state = coll->out; state->c != NFA_END_COLL;
+       state = state->out) {
+    if (state->c == NFA_RANGE_MIN) {
+      int c1 = state->val;
+      state = state->out;  // advance to NFA_RANGE_MAX
+      int c2 = state->val;
+
+      if (c >= c1 && c <= c2) {
+        return result_if_matched;
+      }
+      if (ic) {
+        int c_low = mb_tolower(c);
+
+        for (; c1 <= c2; c1++) {
+          if (mb_tolower(c1) == c_low) {
+            return result_if_matched;
+          }
+        }
+      }
+    } else if (state->c < 0 ? check_char_class(state->c, c)
+               : (c == state->c
+                  || (ic && mb_tolower(c) == mb_tolower(state->c)))) {
+      return result_if_matched;
+    }
+  }
+  return !result_if_matched;
+}
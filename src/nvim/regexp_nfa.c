@@ -42,6 +42,14 @@
 /* Added to NFA_ANY - NFA_NUPPER_IC to include a NL. */
 #define NFA_ADD_NL              31
 
+// List ID that state "s" was last added with, "i" is 0 for the normal and 1
+// for the recursive list.  nfa_print_state() negates the ids.
+#ifdef REGEXP_DEBUG
+# define LASTLIST(s, i) rex.nfa_lastlist[abs((s)->id) * 2 + (i)]
+#else
+# define LASTLIST(s, i) rex.nfa_lastlist[(s)->id * 2 + (i)]
+#endif
+
 enum {
   NFA_SPLIT = -1024,
   NFA_MATCH,
@@ -319,6 +327,23 @@ typedef struct {
   int has_pim;                  /* TRUE when any state has a PIM */
 } nfa_list_T;
 
+// Limits for the texts a match must start with, see nfa_get_literals().
+#define NFA_MAX_LITERALS 16   // number of texts
+#define NFA_MAX_LITLEN   8    // number of characters in a text
+#define NFA_MAX_ACCEPT   16   // number of bytes for strcspn()
+
+/// Texts one of which a match must start with.  Used to skip ahead to where
+/// a match can start.
+struct nfa_literals {
+  int count;                                 ///< number of items in "lits"
+  int lits[NFA_MAX_LITERALS][NFA_MAX_LITLEN + 1];  ///< characters of each
+                                                   ///< text, zero terminated
+  // Index 0 is for matching case, index 1 for ignoring case.
+  bool first[2][256];                        ///< bytes a text can start with
+  char accept[2][NFA_MAX_ACCEPT + 1];        ///< same as a string, when short
+  int naccept[2];                            ///< length of "accept"
+};
+
 /// re_flags passed to nfa_regcomp().
 static int nfa_re_flags;
 
@@ -328,33 +353,13 @@ static int nfa_has_zend;
 /* NFA regexp \1 .. \9 encountered. */
 static int nfa_has_backref;
 
-/* NFA regexp has \z( ), set zsubexpr. */
-static int nfa_has_zsubexpr;
-
-/* Number of sub expressions actually being used during execution. 1 if only
- * the whole match (subexpr 0) is used. */
-static int nfa_nsubexpr;
-
 static int *post_start;  /* holds the postfix form of r.e. */
 static int *post_end;
 static int *post_ptr;
 
-static int nstate;      /* Number of states in the NFA. Also used when
-                         * executing. */
+static int nstate;      /* Number of states in the NFA. */
 static int istate;      /* Index in the state vector, used in alloc_state() */
 
-/* If not NULL match must end at this position */
-static save_se_T *nfa_endp = NULL;
-
-/* listid is global, so that it increases on recursive calls to
- * nfa_regmatch(), which means we don't have to clear the lastlist field of
- * all the states. */
-static int nfa_listid;
-static int nfa_alt_listid;
-
-/* 0 for first call to nfa_regmatch(), 1 for recursive call. */
-static int nfa_ll_index = 0;
-
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "regexp_nfa.c.generated.h"
 #endif
@@ -574,6 +579,246 @@ static char_u *nfa_get_match_text(nfa_state_T *start)
   return ret;
 }
 
+/// Figure out the texts one of which a match must start with.  Alternatives
+/// and short collections, such as "\(foo\|ba[rz]\)", give several texts.
+///
+/// @return the texts in allocated memory or NULL when a match may start with
+///         something else or there are too many.
+static nfa_literals_T *nfa_get_literals(nfa_regprog_T *prog)
+{
+  // "\Z" skips composing characters in the text, comparing texts can't do
+  // that.
+  if (prog->regflags & RF_ICOMBINE) {
+    return NULL;
+  }
+
+  nfa_literals_T *lits = xcalloc(1, sizeof(nfa_literals_T));
+  int buf[NFA_MAX_LITLEN];
+
+  if (nfa_collect_literals(lits, prog->start, buf, 0, 0) == FAIL) {
+    xfree(lits);
+    return NULL;
+  }
+
+  // A text that starts with another text is not needed.
+  for (int i = 0; i < lits->count; i++) {
+    for (int j = 0; j < lits->count; j++) {
+      int k = 0;
+      if (i == j) {
+        continue;
+      }
+      while (lits->lits[j][k] != 0 && lits->lits[j][k] == lits->lits[i][k]) {
+        k++;
+      }
+      if (lits->lits[j][k] == 0) {
+        // "j" is a prefix of "i", remove "i".
+        memmove(lits->lits[i], lits->lits[lits->count - 1],
+                sizeof(lits->lits[i]));
+        lits->count--;
+        i--;
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < lits->count; i++) {
+    int c = lits->lits[i][0];
+
+    // The NFA does not start a match at a composing character.
+    if (utf_iscomposing(c)) {
+      xfree(lits);
+      return NULL;
+    }
+    nfa_add_first_byte(lits->first[0], c);
+    // When ignoring case a character matches when its lower case character
+    // is the same, e.g. "K" and the Kelvin sign both match "k".
+    int lc = mb_tolower(c);
+    nfa_add_first_byte(lits->first[1], c);
+    nfa_add_first_byte(lits->first[1], lc);
+    nfa_add_first_byte(lits->first[1], mb_toupper(lc));
+    nfa_add_first_byte(lits->first[1], mb_toupper(c));
+    if (c >= 0x80 || ASCII_ISALPHA(c)) {
+      // Another multi-byte character may have the same lower case
+      // character.
+      for (int b = 0xc0; b <= 0xff; b++) {
+        lits->first[1][b] = true;
+      }
+    }
+  }
+
+  for (int ic = 0; ic < 2; ic++) {
+    for (int b = 1; b < 256; b++) {
+      if (lits->first[ic][b] && lits->naccept[ic]++ < NFA_MAX_ACCEPT) {
+        lits->accept[ic][lits->naccept[ic] - 1] = (char)b;
+      }
+    }
+  }
+
+  return lits;
+}
+
+/// Add the first byte of character "c" to "first".
+static void nfa_add_first_byte(bool *first, int c)
+{
+  char_u buf[MB_MAXBYTES + 1];
+
+  utf_char2bytes(c, buf);
+  first[buf[0]] = true;
+  if (c >= 0x80 && c <= 0xff) {
+    // An illegal byte in the text is used as a character.
+    first[c] = true;
+  }
+}
+
+/// Add the texts a match must start with, from NFA state "start" on, to
+/// "lits".  "buf" contains the "len" characters collected so far.
+///
+/// @return FAIL when a match may start with something else or there are too
+///         many texts.
+static int nfa_collect_literals(nfa_literals_T *lits, nfa_state_T *start,
+                                int *buf, int len, int depth)
+{
+  nfa_state_T *p = start;
+
+  if (depth > 10) {
+    return FAIL;
+  }
+
+  while (p != NULL && len < NFA_MAX_LITLEN) {
+    switch (p->c) {
+    // zero-width matches, what follows must match at the same position
+    case NFA_BOL:
+    case NFA_BOF:
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_CURSOR:
+    case NFA_VISUAL:
+    case NFA_LNUM:
+    case NFA_LNUM_GT:
+    case NFA_LNUM_LT:
+    case NFA_COL:
+    case NFA_COL_GT:
+    case NFA_COL_LT:
+    case NFA_VCOL:
+    case NFA_VCOL_GT:
+    case NFA_VCOL_LT:
+    case NFA_MARK:
+    case NFA_MARK_GT:
+    case NFA_MARK_LT:
+    case NFA_EMPTY:
+    case NFA_MOPEN:
+    case NFA_MOPEN1:
+    case NFA_MOPEN2:
+    case NFA_MOPEN3:
+    case NFA_MOPEN4:
+    case NFA_MOPEN5:
+    case NFA_MOPEN6:
+    case NFA_MOPEN7:
+    case NFA_MOPEN8:
+    case NFA_MOPEN9:
+    case NFA_MCLOSE:
+    case NFA_MCLOSE1:
+    case NFA_MCLOSE2:
+    case NFA_MCLOSE3:
+    case NFA_MCLOSE4:
+    case NFA_MCLOSE5:
+    case NFA_MCLOSE6:
+    case NFA_MCLOSE7:
+    case NFA_MCLOSE8:
+    case NFA_MCLOSE9:
+    case NFA_NOPEN:
+    case NFA_NCLOSE:
+    case NFA_ZOPEN:
+    case NFA_ZOPEN1:
+    case NFA_ZOPEN2:
+    case NFA_ZOPEN3:
+    case NFA_ZOPEN4:
+    case NFA_ZOPEN5:
+    case NFA_ZOPEN6:
+    case NFA_ZOPEN7:
+    case NFA_ZOPEN8:
+    case NFA_ZOPEN9:
+    case NFA_ZCLOSE:
+    case NFA_ZCLOSE1:
+    case NFA_ZCLOSE2:
+    case NFA_ZCLOSE3:
+    case NFA_ZCLOSE4:
+    case NFA_ZCLOSE5:
+    case NFA_ZCLOSE6:
+    case NFA_ZCLOSE7:
+    case NFA_ZCLOSE8:
+    case NFA_ZCLOSE9:
+      p = p->out;
+      break;
+
+    case NFA_SPLIT:
+      if (nfa_collect_literals(lits, p->out, buf, len, depth + 1) == FAIL) {
+        return FAIL;
+      }
+      return nfa_collect_literals(lits, p->out1, buf, len, depth + 1);
+
+    case NFA_START_COLL:
+    {
+      // A few plain characters: one text for each of them.  The texts end
+      // here, the collection also matches composing characters after the
+      // character and comparing texts can't skip them.
+      nfa_state_T *item;
+      int n = 0;
+
+      for (item = p->out; item->c > 0 && n <= 4; item = item->out) {
+        n++;
+      }
+      if (item->c != NFA_END_COLL || n > 4) {
+        goto done;
+      }
+      for (item = p->out; item->c > 0; item = item->out) {
+        buf[len] = item->c;
+        if (nfa_add_literal(lits, buf, len + 1) == FAIL) {
+          return FAIL;
+        }
+      }
+      return OK;
+    }
+
+    default:
+      if (p->c <= 0) {
+        goto done;
+      }
+      buf[len++] = p->c;
+      p = p->out;
+      break;
+    }
+  }
+
+done:
+  return nfa_add_literal(lits, buf, len);
+}
+
+/// Add text "buf" of "len" characters to "lits".
+///
+/// @return FAIL when the text is empty or there are too many texts.
+static int nfa_add_literal(nfa_literals_T *lits, const int *buf, int len)
+{
+  if (len == 0) {
+    return FAIL;
+  }
+  for (int i = 0; i < lits->count; i++) {
+    if (memcmp(lits->lits[i], buf, (size_t)len * sizeof(int)) == 0
+        && lits->lits[i][len] == 0) {
+      return OK;  // already present
+    }
+  }
+  if (lits->count == NFA_MAX_LITERALS) {
+    return FAIL;
+  }
+  memcpy(lits->lits[lits->count], buf, (size_t)len * sizeof(int));
+  lits->lits[lits->count][len] = 0;
+  lits->count++;
+  return OK;
+}
+
 /*
  * Allocate more space for post_start.  Called when
  * running above the estimated number of states.
@@ -1442,10 +1687,12 @@ static int nfa_regatom(void)
 
     case '#':
       EMIT(NFA_CURSOR);
+      regflags |= RF_POSITION;
       break;
 
     case 'V':
       EMIT(NFA_VISUAL);
+      regflags |= RF_POSITION;
       break;
 
     case 'C':
@@ -1499,6 +1746,7 @@ static int nfa_regatom(void)
           // \%{n}l  \%{n}<l  \%{n}>l
           EMIT(cmp == '<' ? NFA_LNUM_LT :
                cmp == '>' ? NFA_LNUM_GT : NFA_LNUM);
+          regflags |= RF_POSITION;
           if (save_prev_at_start) {
             at_start = true;
           }
@@ -1510,6 +1758,7 @@ static int nfa_regatom(void)
           // \%{n}v  \%{n}<v  \%{n}>v
           EMIT(cmp == '<' ? NFA_VCOL_LT :
                cmp == '>' ? NFA_VCOL_GT : NFA_VCOL);
+          regflags |= RF_POSITION;
         }
 #if SIZEOF_INT < SIZEOF_LONG
         if (n > INT_MAX) {
@@ -1523,6 +1772,7 @@ static int nfa_regatom(void)
         /* \%'m  \%<'m  \%>'m  */
         EMIT(cmp == '<' ? NFA_MARK_LT :
             cmp == '>' ? NFA_MARK_GT : NFA_MARK);
+        regflags |= RF_POSITION;
         EMIT(getchr());
         break;
       }
@@ -2619,8 +2869,6 @@ static nfa_state_T *alloc_state(int c, nfa_state_T *out, nfa_state_T *out1)
   s->val  = 0;
 
   s->id   = istate;
-  s->lastlist[0] = 0;
-  s->lastlist[1] = 0;
 
   return s;
 }
@@ -3522,7 +3770,7 @@ static void nfa_postprocess(nfa_regprog_T *prog)
 static void log_subsexpr(regsubs_T *subs)
 {
   log_subexpr(&subs->norm);
-  if (nfa_has_zsubexpr)
+  if (rex.nfa_has_zsubexpr)
     log_subexpr(&subs->synt);
 }
 
@@ -3557,25 +3805,20 @@ static char *pim_info(nfa_pim_T *pim)
     buf[0] = NUL;
   else {
     sprintf(buf, " PIM col %d", REG_MULTI ? (int)pim->end.pos.col
-        : (int)(pim->end.ptr - reginput));
+        : (int)(pim->end.ptr - rex.input));
   }
   return buf;
 }
 
 #endif
 
-// Used during execution: whether a match has been found.
-static int nfa_match;
-static proftime_T *nfa_time_limit;
-static int nfa_time_count;
-
 // Copy postponed invisible match info from "from" to "to".
 static void copy_pim(nfa_pim_T *to, nfa_pim_T *from)
 {
   to->result = from->result;
   to->state = from->state;
   copy_sub(&to->subs.norm, &from->subs.norm);
-  if (nfa_has_zsubexpr)
+  if (rex.nfa_has_zsubexpr)
     copy_sub(&to->subs.synt, &from->subs.synt);
   to->end = from->end;
 }
@@ -3585,9 +3828,9 @@ static void clear_sub(regsub_T *sub)
   if (REG_MULTI)
     /* Use 0xff to set lnum to -1 */
     memset(sub->list.multi, 0xff,
-        sizeof(struct multipos) * nfa_nsubexpr);
+        sizeof(struct multipos) * rex.nfa_nsubexpr);
   else
-    memset(sub->list.line, 0, sizeof(struct linepos) * nfa_nsubexpr);
+    memset(sub->list.line, 0, sizeof(struct linepos) * rex.nfa_nsubexpr);
   sub->in_use = 0;
 }
 
@@ -3635,7 +3878,7 @@ static void copy_sub_off(regsub_T *to, regsub_T *from)
  */
 static void copy_ze_off(regsub_T *to, regsub_T *from)
 {
-  if (nfa_has_zend) {
+  if (rex.nfa_has_zend) {
     if (REG_MULTI) {
       if (from->list.multi[0].end_lnum >= 0){
         to->list.multi[0].end_lnum = from->list.multi[0].end_lnum;
@@ -3676,7 +3919,7 @@ static int sub_equal(regsub_T *sub1, regsub_T *sub2)
           != sub2->list.multi[i].start_col)
         return FALSE;
 
-      if (nfa_has_backref) {
+      if (rex.nfa_has_backref) {
         if (i < sub1->in_use) {
           s1 = sub1->list.multi[i].end_lnum;
         } else {
@@ -3709,7 +3952,7 @@ static int sub_equal(regsub_T *sub1, regsub_T *sub2)
       if (sp1 != sp2)
         return FALSE;
 
-      if (nfa_has_backref) {
+      if (rex.nfa_has_backref) {
         if (i < sub1->in_use) {
           sp1 = sub1->list.line[i].end;
         } else {
@@ -3743,7 +3986,7 @@ static void report_state(char *action,
   else if (REG_MULTI)
     col = sub->list.multi[0].start_col;
   else
-    col = (int)(sub->list.line[0].start - regline);
+    col = (int)(sub->list.line[0].start - rex.line);
   nfa_set_code(state->c);
   fprintf(log_fd, "> %s state %d to list %d. char %d: %s (start col %d)%s\n",
       action, abs(state->id), lid, state->c, code, col,
@@ -3771,7 +4014,7 @@ has_state_with_pos (
     thread = &l->t[i];
     if (thread->state->id == state->id
         && sub_equal(&thread->subs.norm, &subs->norm)
-        && (!nfa_has_zsubexpr
+        && (!rex.nfa_has_zsubexpr
             || sub_equal(&thread->subs.synt, &subs->synt))
         && pim_equal(&thread->pim, pim))
       return TRUE;
@@ -3904,8 +4147,8 @@ state_in_list (
     regsubs_T *subs      /* pointers to subexpressions */
 )
 {
-  if (state->lastlist[nfa_ll_index] == l->id) {
-    if (!nfa_has_backref || has_state_with_pos(l, state, subs, NULL))
+  if (LASTLIST(state, rex.nfa_ll_index) == l->id) {
+    if (!rex.nfa_has_backref || has_state_with_pos(l, state, subs, NULL))
       return TRUE;
   }
   return FALSE;
@@ -3937,7 +4180,7 @@ addstate (
   int i;
   regsub_T            *sub;
   regsubs_T           *subs = subs_arg;
-  static regsubs_T temp_subs;
+  static NVIM_THREAD_LOCAL regsubs_T temp_subs;
 #ifdef REGEXP_DEBUG
   int did_print = FALSE;
 #endif
@@ -3983,11 +4226,11 @@ addstate (
     /* "^" won't match past end-of-line, don't bother trying.
      * Except when at the end of the line, or when we are going to the
      * next line for a look-behind match. */
-    if (reginput > regline
-        && *reginput != NUL
-        && (nfa_endp == NULL
+    if (rex.input > rex.line
+        && *rex.input != NUL
+        && (rex.nfa_endp == NULL
             || !REG_MULTI
-            || reglnum == nfa_endp->se_u.pos.lnum))
+            || rex.lnum == rex.nfa_endp->se_u.pos.lnum))
       goto skip_add;
   /* FALLTHROUGH */
 
@@ -4017,12 +4260,12 @@ addstate (
    * endless loop for "\(\)*" */
 
   default:
-    if (state->lastlist[nfa_ll_index] == l->id && state->c != NFA_SKIP) {
+    if (LASTLIST(state, rex.nfa_ll_index) == l->id && state->c != NFA_SKIP) {
       /* This state is already in the list, don't add it again,
        * unless it is an MOPEN that is used for a backreference or
        * when there is a PIM. For NFA_MATCH check the position,
        * lower position is preferred. */
-      if (!nfa_has_backref && pim == NULL && !l->has_pim
+      if (!rex.nfa_has_backref && pim == NULL && !l->has_pim
           && state->c != NFA_MATCH) {
 
         /* When called from addstate_here() do insert before
@@ -4063,7 +4306,7 @@ skip_add:
         /* "subs" may point into the current array, need to make a
          * copy before it becomes invalid. */
         copy_sub(&temp_subs.norm, &subs->norm);
-        if (nfa_has_zsubexpr)
+        if (rex.nfa_has_zsubexpr)
           copy_sub(&temp_subs.synt, &subs->synt);
         subs = &temp_subs;
       }
@@ -4073,7 +4316,7 @@ skip_add:
     }
 
     /* add the state to the list */
-    state->lastlist[nfa_ll_index] = l->id;
+    LASTLIST(state, rex.nfa_ll_index) = l->id;
     thread = &l->t[l->n++];
     thread->state = state;
     if (pim == NULL)
@@ -4083,7 +4326,7 @@ skip_add:
       l->has_pim = TRUE;
     }
     copy_sub(&thread->subs.norm, &subs->norm);
-    if (nfa_has_zsubexpr)
+    if (rex.nfa_has_zsubexpr)
       copy_sub(&thread->subs.synt, &subs->synt);
 #ifdef REGEXP_DEBUG
     report_state("Adding", &thread->subs.norm, state, l->id, pim);
@@ -4162,13 +4405,13 @@ skip_add:
         sub->in_use = subidx + 1;
       }
       if (off == -1) {
-        sub->list.multi[subidx].start_lnum = reglnum + 1;
+        sub->list.multi[subidx].start_lnum = rex.lnum + 1;
         sub->list.multi[subidx].start_col = 0;
       } else {
 
-        sub->list.multi[subidx].start_lnum = reglnum;
+        sub->list.multi[subidx].start_lnum = rex.lnum;
         sub->list.multi[subidx].start_col =
-          (colnr_T)(reginput - regline + off);
+          (colnr_T)(rex.input - rex.line + off);
       }
       sub->list.multi[subidx].end_lnum = -1;
     } else {
@@ -4183,7 +4426,7 @@ skip_add:
         }
         sub->in_use = subidx + 1;
       }
-      sub->list.line[subidx].start = reginput + off;
+      sub->list.line[subidx].start = rex.input + off;
     }
 
     subs = addstate(l, state->out, subs, pim, off_arg);
@@ -4205,7 +4448,7 @@ skip_add:
     break;
 
   case NFA_MCLOSE:
-    if (nfa_has_zend && (REG_MULTI
+    if (rex.nfa_has_zend && (REG_MULTI
                          ? subs->norm.list.multi[0].end_lnum >= 0
                          : subs->norm.list.line[0].end != NULL)) {
       /* Do not overwrite the position set by \ze. */
@@ -4252,18 +4495,18 @@ skip_add:
     if (REG_MULTI) {
       save_multipos = sub->list.multi[subidx];
       if (off == -1) {
-        sub->list.multi[subidx].end_lnum = reglnum + 1;
+        sub->list.multi[subidx].end_lnum = rex.lnum + 1;
         sub->list.multi[subidx].end_col = 0;
       } else {
-        sub->list.multi[subidx].end_lnum = reglnum;
+        sub->list.multi[subidx].end_lnum = rex.lnum;
         sub->list.multi[subidx].end_col =
-          (colnr_T)(reginput - regline + off);
+          (colnr_T)(rex.input - rex.line + off);
       }
       /* avoid compiler warnings */
       save_ptr = NULL;
     } else {
       save_ptr = sub->list.line[subidx].end;
-      sub->list.line[subidx].end = reginput + off;
+      sub->list.line[subidx].end = rex.input + off;
       // avoid compiler warnings
       memset(&save_multipos, 0, sizeof(save_multipos));
     }
@@ -4466,12 +4709,12 @@ retempty:
     if (sub->list.multi[subidx].start_lnum < 0
         || sub->list.multi[subidx].end_lnum < 0)
       goto retempty;
-    if (sub->list.multi[subidx].start_lnum == reglnum
-        && sub->list.multi[subidx].end_lnum == reglnum) {
+    if (sub->list.multi[subidx].start_lnum == rex.lnum
+        && sub->list.multi[subidx].end_lnum == rex.lnum) {
       len = sub->list.multi[subidx].end_col
             - sub->list.multi[subidx].start_col;
-      if (cstrncmp(regline + sub->list.multi[subidx].start_col,
-              reginput, &len) == 0) {
+      if (cstrncmp(rex.line + sub->list.multi[subidx].start_col,
+              rex.input, &len) == 0) {
         *bytelen = len;
         return TRUE;
       }
@@ -4489,7 +4732,7 @@ retempty:
         || sub->list.line[subidx].end == NULL)
       goto retempty;
     len = (int)(sub->list.line[subidx].end - sub->list.line[subidx].start);
-    if (cstrncmp(sub->list.line[subidx].start, reginput, &len) == 0) {
+    if (cstrncmp(sub->list.line[subidx].start, rex.input, &len) == 0) {
       *bytelen = len;
       return TRUE;
     }
@@ -4519,7 +4762,7 @@ match_zref (
   }
 
   len = (int)STRLEN(re_extmatch_in->matches[subidx]);
-  if (cstrncmp(re_extmatch_in->matches[subidx], reginput, &len) == 0) {
+  if (cstrncmp(re_extmatch_in->matches[subidx], rex.input, &len) == 0) {
     *bytelen = len;
     return TRUE;
   }
@@ -4529,19 +4772,13 @@ match_zref (
 /*
  * Save list IDs for all NFA states of "prog" into "list".
  * Also reset the IDs to zero.
- * Only used for the recursive value lastlist[1].
+ * Only used for the recursive value LASTLIST(s, 1).
  */
 static void nfa_save_listids(nfa_regprog_T *prog, int *list)
 {
-  int i;
-  nfa_state_T     *p;
-
-  /* Order in the list is reverse, it's a bit faster that way. */
-  p = &prog->state[0];
-  for (i = prog->nstate; --i >= 0; ) {
-    list[i] = p->lastlist[1];
-    p->lastlist[1] = 0;
-    ++p;
+  for (int i = 0; i < prog->nstate; i++) {
+    list[i] = rex.nfa_lastlist[i * 2 + 1];
+    rex.nfa_lastlist[i * 2 + 1] = 0;
   }
 }
 
@@ -4550,13 +4787,8 @@ static void nfa_save_listids(nfa_regprog_T *prog, int *list)
  */
 static void nfa_restore_listids(nfa_regprog_T *prog, int *list)
 {
-  int i;
-  nfa_state_T     *p;
-
-  p = &prog->state[0];
-  for (i = prog->nstate; --i >= 0; ) {
-    p->lastlist[1] = list[i];
-    ++p;
+  for (int i = 0; i < prog->nstate; i++) {
+    rex.nfa_lastlist[i * 2 + 1] = list[i];
   }
 }
 
@@ -4575,11 +4807,11 @@ static bool nfa_re_num_cmp(uintmax_t val, int op, uintmax_t pos)
  */
 static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T *prog, regsubs_T *submatch, regsubs_T *m, int **listids)
 {
-  int save_reginput_col = (int)(reginput - regline);
-  int save_reglnum = reglnum;
-  int save_nfa_match = nfa_match;
-  int save_nfa_listid = nfa_listid;
-  save_se_T   *save_nfa_endp = nfa_endp;
+  int save_reginput_col = (int)(rex.input - rex.line);
+  int save_reglnum = rex.lnum;
+  int save_nfa_match = rex.nfa_match;
+  int save_nfa_listid = rex.nfa_listid;
+  save_se_T   *save_nfa_endp = rex.nfa_endp;
   save_se_T endpos;
   save_se_T   *endposp = NULL;
   int result;
@@ -4588,9 +4820,9 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
   if (pim != NULL) {
     /* start at the position where the postponed match was */
     if (REG_MULTI)
-      reginput = regline + pim->end.pos.col;
+      rex.input = rex.line + pim->end.pos.col;
     else
-      reginput = pim->end.ptr;
+      rex.input = pim->end.ptr;
   }
 
   if (state->c == NFA_START_INVISIBLE_BEFORE
@@ -4602,13 +4834,13 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     endposp = &endpos;
     if (REG_MULTI) {
       if (pim == NULL) {
-        endpos.se_u.pos.col = (int)(reginput - regline);
-        endpos.se_u.pos.lnum = reglnum;
+        endpos.se_u.pos.col = (int)(rex.input - rex.line);
+        endpos.se_u.pos.lnum = rex.lnum;
       } else
         endpos.se_u.pos = pim->end.pos;
     } else {
       if (pim == NULL)
-        endpos.se_u.ptr = reginput;
+        endpos.se_u.ptr = rex.input;
       else
         endpos.se_u.ptr = pim->end.ptr;
     }
@@ -4619,29 +4851,29 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
      * bytes if possible. */
     if (state->val <= 0) {
       if (REG_MULTI) {
-        regline = reg_getline(--reglnum);
-        if (regline == NULL)
+        rex.line = reg_getline(--rex.lnum);
+        if (rex.line == NULL)
           /* can't go before the first line */
-          regline = reg_getline(++reglnum);
+          rex.line = reg_getline(++rex.lnum);
       }
-      reginput = regline;
+      rex.input = rex.line;
     } else {
-      if (REG_MULTI && (int)(reginput - regline) < state->val) {
+      if (REG_MULTI && (int)(rex.input - rex.line) < state->val) {
         /* Not enough bytes in this line, go to end of
          * previous line. */
-        regline = reg_getline(--reglnum);
-        if (regline == NULL) {
+        rex.line = reg_getline(--rex.lnum);
+        if (rex.line == NULL) {
           /* can't go before the first line */
-          regline = reg_getline(++reglnum);
-          reginput = regline;
+          rex.line = reg_getline(++rex.lnum);
+          rex.input = rex.line;
         } else
-          reginput = regline + STRLEN(regline);
+          rex.input = rex.line + STRLEN(rex.line);
       }
-      if ((int)(reginput - regline) >= state->val) {
-        reginput -= state->val;
-        reginput -= utf_head_off(regline, reginput);
+      if ((int)(rex.input - rex.line) >= state->val) {
+        rex.input -= state->val;
+        rex.input -= utf_head_off(rex.line, rex.input);
       } else {
-        reginput = regline;
+        rex.input = rex.line;
       }
     }
   }
@@ -4651,48 +4883,48 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     fclose(log_fd);
   log_fd = NULL;
 #endif
-  /* Have to clear the lastlist field of the NFA nodes, so that
+  /* Have to clear the last list IDs of the NFA nodes, so that
    * nfa_regmatch() and addstate() can run properly after recursion. */
-  if (nfa_ll_index == 1) {
-    /* Already calling nfa_regmatch() recursively.  Save the lastlist[1]
+  if (rex.nfa_ll_index == 1) {
+    /* Already calling nfa_regmatch() recursively.  Save the LASTLIST(s, 1)
      * values and clear them. */
     if (*listids == NULL) {
-      *listids = xmalloc(sizeof(**listids) * nstate);
+      *listids = xmalloc(sizeof(**listids) * (size_t)prog->nstate);
     }
     nfa_save_listids(prog, *listids);
     need_restore = TRUE;
-    /* any value of nfa_listid will do */
+    /* any value of rex.nfa_listid will do */
   } else {
     /* First recursive nfa_regmatch() call, switch to the second lastlist
-     * entry.  Make sure nfa_listid is different from a previous recursive
+     * entry.  Make sure rex.nfa_listid is different from a previous recursive
      * call, because some states may still have this ID. */
-    ++nfa_ll_index;
-    if (nfa_listid <= nfa_alt_listid)
-      nfa_listid = nfa_alt_listid;
+    ++rex.nfa_ll_index;
+    if (rex.nfa_listid <= rex.nfa_alt_listid)
+      rex.nfa_listid = rex.nfa_alt_listid;
   }
 
   /* Call nfa_regmatch() to check if the current concat matches at this
    * position. The concat ends with the node NFA_END_INVISIBLE */
-  nfa_endp = endposp;
+  rex.nfa_endp = endposp;
   result = nfa_regmatch(prog, state->out, submatch, m);
 
   if (need_restore)
     nfa_restore_listids(prog, *listids);
   else {
-    --nfa_ll_index;
-    nfa_alt_listid = nfa_listid;
+    --rex.nfa_ll_index;
+    rex.nfa_alt_listid = rex.nfa_listid;
   }
 
   /* restore position in input text */
-  reglnum = save_reglnum;
+  rex.lnum = save_reglnum;
   if (REG_MULTI)
-    regline = reg_getline(reglnum);
-  reginput = regline + save_reginput_col;
+    rex.line = reg_getline(rex.lnum);
+  rex.input = rex.line + save_reginput_col;
   if (result != NFA_TOO_EXPENSIVE) {
-    nfa_match = save_nfa_match;
-    nfa_listid = save_nfa_listid;
+    rex.nfa_match = save_nfa_match;
+    rex.nfa_listid = save_nfa_listid;
   }
-  nfa_endp = save_nfa_endp;
+  rex.nfa_endp = save_nfa_endp;
 
 #ifdef REGEXP_DEBUG
   log_fd = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -4873,14 +5105,92 @@ static int failure_chance(nfa_state_T *state, int depth)
  */
 static int skip_to_start(int c, colnr_T *colp)
 {
-  const char_u *const s = cstrchr(regline + *colp, c);
+  const char_u *const s = cstrchr(rex.line + *colp, c);
   if (s == NULL) {
     return FAIL;
   }
-  *colp = (int)(s - regline);
+  *colp = (int)(s - rex.line);
   return OK;
 }
 
+/// Skip until a position in "line" where one of the texts in "lits" starts,
+/// from "*colp" on.
+///
+/// @param ic  ignore case
+///
+/// @return OK and "*colp" set to the position or FAIL when there is none.
+static int skip_to_literals(const nfa_literals_T *lits, const char_u *line,
+                            colnr_T *colp, bool ic)
+{
+  const char_u *p = line + *colp;
+
+  for (;;) {
+    // Find a byte a text can start with.  Let the C library do this for a
+    // few bytes, it is usually vectorized.
+    if (lits->naccept[ic] == 1) {
+      p = (const char_u *)strchr((const char *)p, lits->accept[ic][0]);
+      if (p == NULL) {
+        return FAIL;
+      }
+    } else if (lits->naccept[ic] <= NFA_MAX_ACCEPT) {
+      p += strcspn((const char *)p, lits->accept[ic]);
+    } else {
+      while (*p != NUL && !lits->first[ic][*p]) {
+        p++;
+      }
+    }
+    if (*p == NUL) {
+      return FAIL;
+    }
+    if (nfa_literal_at(lits, line, p, ic)) {
+      *colp = (colnr_T)(p - line);
+      return OK;
+    }
+    p++;
+  }
+}
+
+/// Check whether one of the texts in "lits" starts at "p" in "line".
+///
+/// @param ic  ignore case
+static bool nfa_literal_at(const nfa_literals_T *lits, const char_u *line,
+                           const char_u *p, bool ic)
+{
+  if (*p >= 0x80 && *p < 0xc0) {
+    // Only an illegal byte can be used as a character here, not a byte
+    // halfway a multi-byte character.
+    for (const char_u *s = p - 1; s >= line && p - s < MB_MAXCHAR; s--) {
+      if (*s < 0x80) {
+        break;
+      }
+      if (*s >= 0xc0) {
+        if (utf_ptr2len(s) > p - s) {
+          return false;
+        }
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < lits->count; i++) {
+    const int *lit = lits->lits[i];
+    const char_u *s = p;
+
+    while (*lit != 0 && *s != NUL) {
+      int c = utf_ptr2char(s);
+      if (c != *lit && (!ic || mb_tolower(c) != mb_tolower(*lit))) {
+        break;
+      }
+      s += utf_ptr2len(s);
+      lit++;
+    }
+    if (*lit == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /*
  * Check for a match with match_text.
  * Called after skip_to_start() has found regstart.
@@ -4891,12 +5201,12 @@ static long find_match_text(colnr_T startcol, int regstart, char_u *match_text)
 #define PTR2LEN(x) enc_utf8 ? utf_ptr2len(x) : MB_PTR2LEN(x)
 
   colnr_T col = startcol;
-  int regstart_len = PTR2LEN(regline + startcol);
+  int regstart_len = PTR2LEN(rex.line + startcol);
 
   for (;;) {
     bool match = true;
     char_u *s1 = match_text;
-    char_u *s2 = regline + col + regstart_len;  // skip regstart
+    char_u *s2 = rex.line + col + regstart_len;  // skip regstart
     while (*s1) {
       int c1_len = PTR2LEN(s1);
       int c1 = PTR2CHAR(s1);
@@ -4916,12 +5226,12 @@ static long find_match_text(colnr_T startcol, int regstart, char_u *match_text)
         && !(enc_utf8 && utf_iscomposing(PTR2CHAR(s2)))) {
       cleanup_subexpr();
       if (REG_MULTI) {
-        rex.reg_startpos[0].lnum = reglnum;
+        rex.reg_startpos[0].lnum = rex.lnum;
         rex.reg_startpos[0].col = col;
-        rex.reg_endpos[0].lnum = reglnum;
-        rex.reg_endpos[0].col = s2 - regline;
+        rex.reg_endpos[0].lnum = rex.lnum;
+        rex.reg_endpos[0].col = s2 - rex.line;
       } else {
-        rex.reg_startp[0] = regline + col;
+        rex.reg_startp[0] = rex.line + col;
         rex.reg_endp[0] = s2;
       }
       return 1L;
@@ -4940,9 +5250,9 @@ static long find_match_text(colnr_T startcol, int regstart, char_u *match_text)
 
 /// Main matching routine.
 ///
-/// Run NFA to determine whether it matches reginput.
+/// Run NFA to determine whether it matches rex.input.
 ///
-/// When "nfa_endp" is not NULL it is a required end-of-match position.
+/// When "rex.nfa_endp" is not NULL it is a required end-of-match position.
 ///
 /// Return TRUE if there is a match, FALSE otherwise.
 /// When there is a match "submatch" contains the positions.
@@ -4974,28 +5284,28 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
 #endif
   // Some patterns may take a long time to match, especially when using
   // recursive_regmatch(). Allow interrupting them with CTRL-C.
-  fast_breakcheck();
+  reg_fast_breakcheck();
   if (got_int) {
 #ifdef NFA_REGEXP_DEBUG_LOG
     fclose(debug);
 #endif
     return false;
   }
-  if (nfa_time_limit != NULL && profile_passed_limit(*nfa_time_limit)) {
+  if (rex.nfa_time_limit != NULL && profile_passed_limit(*rex.nfa_time_limit)) {
 #ifdef NFA_REGEXP_DEBUG_LOG
     fclose(debug);
 #endif
     return false;
   }
 
-  nfa_match = false;
+  rex.nfa_match = false;
 
   // Allocate memory for the lists of nodes.
-  size_t size = (nstate + 1) * sizeof(nfa_thread_T);
+  size_t size = (size_t)(prog->nstate + 1) * sizeof(nfa_thread_T);
   list[0].t = xmalloc(size);
-  list[0].len = nstate + 1;
+  list[0].len = prog->nstate + 1;
   list[1].t = xmalloc(size);
-  list[1].len = nstate + 1;
+  list[1].len = prog->nstate + 1;
 
 #ifdef REGEXP_DEBUG
   log_fd = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -5020,16 +5330,16 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
 #ifdef REGEXP_DEBUG
   fprintf(log_fd, "(---) STARTSTATE first\n");
 #endif
-  thislist->id = nfa_listid + 1;
+  thislist->id = rex.nfa_listid + 1;
 
   /* Inline optimized code for addstate(thislist, start, m, 0) if we know
    * it's the first MOPEN. */
   if (toplevel) {
     if (REG_MULTI) {
-      m->norm.list.multi[0].start_lnum = reglnum;
-      m->norm.list.multi[0].start_col = (colnr_T)(reginput - regline);
+      m->norm.list.multi[0].start_lnum = rex.lnum;
+      m->norm.list.multi[0].start_col = (colnr_T)(rex.input - rex.line);
     } else
-      m->norm.list.line[0].start = reginput;
+      m->norm.list.line[0].start = rex.input;
     m->norm.in_use = 1;
     addstate(thislist, start->out, m, NULL, 0);
   } else
@@ -5045,8 +5355,8 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
    * Run for each character.
    */
   for (;; ) {
-    int curc = utf_ptr2char(reginput);
-    int clen = utfc_ptr2len(reginput);
+    int curc = utf_ptr2char(rex.input);
+    int clen = utfc_ptr2len(rex.input);
     if (curc == NUL) {
       clen = 0;
       go_to_nextline = false;
@@ -5057,19 +5367,19 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
     nextlist = &list[flag ^= 1];
     nextlist->n = 0;                /* clear nextlist */
     nextlist->has_pim = FALSE;
-    ++nfa_listid;
-    if (prog->re_engine == AUTOMATIC_ENGINE && nfa_listid >= NFA_MAX_STATES) {
+    ++rex.nfa_listid;
+    if (prog->re_engine == AUTOMATIC_ENGINE && rex.nfa_listid >= NFA_MAX_STATES) {
       // Too many states, retry with old engine.
-      nfa_match = NFA_TOO_EXPENSIVE;
+      rex.nfa_match = NFA_TOO_EXPENSIVE;
       goto theend;
     }
 
-    thislist->id = nfa_listid;
-    nextlist->id = nfa_listid + 1;
+    thislist->id = rex.nfa_listid;
+    nextlist->id = rex.nfa_listid + 1;
 
 #ifdef REGEXP_DEBUG
     fprintf(log_fd, "------------------------------------------\n");
-    fprintf(log_fd, ">>> Reginput is \"%s\"\n", reginput);
+    fprintf(log_fd, ">>> Reginput is \"%s\"\n", rex.input);
     fprintf(log_fd,
             ">>> Advanced one character... Current char is %c (code %d) \n",
             curc,
@@ -5110,7 +5420,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         } else if (REG_MULTI) {
           col = t->subs.norm.list.multi[0].start_col;
         } else {
-          col = (int)(t->subs.norm.list.line[0].start - regline);
+          col = (int)(t->subs.norm.list.line[0].start - rex.line);
         }
         nfa_set_code(t->state->c);
         fprintf(log_fd, "(%d) char %d %s (start col %d)%s... \n",
@@ -5134,16 +5444,16 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         if (enc_utf8 && !rex.reg_icombine && utf_iscomposing(curc)) {
           break;
         }
-        nfa_match = true;
+        rex.nfa_match = true;
         copy_sub(&submatch->norm, &t->subs.norm);
-        if (nfa_has_zsubexpr)
+        if (rex.nfa_has_zsubexpr)
           copy_sub(&submatch->synt, &t->subs.synt);
 #ifdef REGEXP_DEBUG
         log_subsexpr(&t->subs);
 #endif
         /* Found the left-most longest match, do not look at any other
          * states at this position.  When the list of states is going
-         * to be empty quit without advancing, so that "reginput" is
+         * to be empty quit without advancing, so that "rex.input" is
          * correct. */
         if (nextlist->n == 0)
           clen = 0;
@@ -5161,45 +5471,45 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
          * If we got here, it means that the current "invisible" group
          * finished successfully, so return control to the parent
          * nfa_regmatch().  For a look-behind match only when it ends
-         * in the position in "nfa_endp".
+         * in the position in "rex.nfa_endp".
          * Submatches are stored in *m, and used in the parent call.
          */
 #ifdef REGEXP_DEBUG
-        if (nfa_endp != NULL) {
+        if (rex.nfa_endp != NULL) {
           if (REG_MULTI)
             fprintf(
                 log_fd,
                 "Current lnum: %d, endp lnum: %d; current col: %d, endp col: %d\n",
-                (int)reglnum,
-                (int)nfa_endp->se_u.pos.lnum,
-                (int)(reginput - regline),
-                nfa_endp->se_u.pos.col);
+                (int)rex.lnum,
+                (int)rex.nfa_endp->se_u.pos.lnum,
+                (int)(rex.input - rex.line),
+                rex.nfa_endp->se_u.pos.col);
           else
             fprintf(log_fd, "Current col: %d, endp col: %d\n",
-                (int)(reginput - regline),
-                (int)(nfa_endp->se_u.ptr - reginput));
+                (int)(rex.input - rex.line),
+                (int)(rex.nfa_endp->se_u.ptr - rex.input));
         }
 #endif
-        /* If "nfa_endp" is set it's only a match if it ends at
-         * "nfa_endp" */
-        if (nfa_endp != NULL && (REG_MULTI
-                                 ? (reglnum != nfa_endp->se_u.pos.lnum
-                                    || (int)(reginput - regline)
-                                    != nfa_endp->se_u.pos.col)
-                                 : reginput != nfa_endp->se_u.ptr))
+        /* If "rex.nfa_endp" is set it's only a match if it ends at
+         * "rex.nfa_endp" */
+        if (rex.nfa_endp != NULL && (REG_MULTI
+                                 ? (rex.lnum != rex.nfa_endp->se_u.pos.lnum
+                                    || (int)(rex.input - rex.line)
+                                    != rex.nfa_endp->se_u.pos.col)
+                                 : rex.input != rex.nfa_endp->se_u.ptr))
           break;
 
         /* do not set submatches for \@! */
         if (t->state->c != NFA_END_INVISIBLE_NEG) {
           copy_sub(&m->norm, &t->subs.norm);
-          if (nfa_has_zsubexpr)
+          if (rex.nfa_has_zsubexpr)
             copy_sub(&m->synt, &t->subs.synt);
         }
 #ifdef REGEXP_DEBUG
         fprintf(log_fd, "Match found:\n");
         log_subsexpr(m);
 #endif
-        nfa_match = true;
+        rex.nfa_match = true;
         // See comment above at "goto nextchar".
         if (nextlist->n == 0) {
           clen = 0;
@@ -5232,7 +5542,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
           // Copy submatch info for the recursive call, opposite
           // of what happens on success below.
           copy_sub_off(&m->norm, &t->subs.norm);
-          if (nfa_has_zsubexpr)
+          if (rex.nfa_has_zsubexpr)
             copy_sub_off(&m->synt, &t->subs.synt);
 
           // First try matching the invisible match, then what
@@ -5240,7 +5550,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
           result = recursive_regmatch(t->state, NULL, prog, submatch, m,
                                       &listids);
           if (result == NFA_TOO_EXPENSIVE) {
-            nfa_match = result;
+            rex.nfa_match = result;
             goto theend;
           }
 
@@ -5254,7 +5564,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
                          == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
             // Copy submatch info from the recursive call
             copy_sub_off(&t->subs.norm, &m->norm);
-            if (nfa_has_zsubexpr)
+            if (rex.nfa_has_zsubexpr)
               copy_sub_off(&t->subs.synt, &m->synt);
             // If the pattern has \ze and it matched in the
             // sub pattern, use it.
@@ -5279,10 +5589,10 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
           pim.subs.norm.in_use = 0;
           pim.subs.synt.in_use = 0;
           if (REG_MULTI) {
-            pim.end.pos.col = (int)(reginput - regline);
-            pim.end.pos.lnum = reglnum;
+            pim.end.pos.col = (int)(rex.input - rex.line);
+            pim.end.pos.lnum = rex.lnum;
           } else
-            pim.end.ptr = reginput;
+            pim.end.ptr = rex.input;
 
           // t->state->out1 is the corresponding END_INVISIBLE
           // node; Add its out to the current list (zero-width
@@ -5333,7 +5643,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         // Copy submatch info to the recursive call, opposite of what
         // happens afterwards.
         copy_sub_off(&m->norm, &t->subs.norm);
-        if (nfa_has_zsubexpr) {
+        if (rex.nfa_has_zsubexpr) {
           copy_sub_off(&m->synt, &t->subs.synt);
         }
 
@@ -5341,7 +5651,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         result = recursive_regmatch(t->state, NULL, prog, submatch, m,
                                     &listids);
         if (result == NFA_TOO_EXPENSIVE) {
-          nfa_match = result;
+          rex.nfa_match = result;
           goto theend;
         }
         if (result) {
@@ -5353,7 +5663,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
 #endif
           // Copy submatch info from the recursive call
           copy_sub_off(&t->subs.norm, &m->norm);
-          if (nfa_has_zsubexpr) {
+          if (rex.nfa_has_zsubexpr) {
             copy_sub_off(&t->subs.synt, &m->synt);
           }
           // Now we need to skip over the matched text and then
@@ -5361,9 +5671,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
           if (REG_MULTI) {
             // TODO(RE): multi-line match
             bytelen = m->norm.list.multi[0].end_col
-                      - (int)(reginput - regline);
+                      - (int)(rex.input - rex.line);
           } else {
-            bytelen = (int)(m->norm.list.line[0].end - reginput);
+            bytelen = (int)(m->norm.list.line[0].end - rex.input);
           }
 
 #ifdef REGEXP_DEBUG
@@ -5392,7 +5702,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
       }
 
       case NFA_BOL:
-        if (reginput == regline) {
+        if (rex.input == rex.line) {
           add_here = true;
           add_state = t->state->out;
         }
@@ -5414,15 +5724,15 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
           int this_class;
 
           // Get class of current and previous char (if it exists).
-          this_class = mb_get_class_tab(reginput, rex.reg_buf->b_chartab);
+          this_class = mb_get_class_tab(rex.input, rex.reg_buf->b_chartab);
           if (this_class <= 1) {
             result = false;
           } else if (reg_prev_class() == this_class) {
             result = false;
           }
         } else if (!vim_iswordc_buf(curc, rex.reg_buf)
-                   || (reginput > regline
-                       && vim_iswordc_buf(reginput[-1], rex.reg_buf))) {
+                   || (rex.input > rex.line
+                       && vim_iswordc_buf(rex.input[-1], rex.reg_buf))) {
           result = false;
         }
         if (result) {
@@ -5433,20 +5743,20 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
 
       case NFA_EOW:
         result = true;
-        if (reginput == regline) {
+        if (rex.input == rex.line) {
           result = false;
         } else if (has_mbyte) {
           int this_class, prev_class;
 
           // Get class of current and previous char (if it exists).
-          this_class = mb_get_class_tab(reginput, rex.reg_buf->b_chartab);
+          this_class = mb_get_class_tab(rex.input, rex.reg_buf->b_chartab);
           prev_class = reg_prev_class();
           if (this_class == prev_class
               || prev_class == 0 || prev_class == 1) {
             result = false;
           }
-        } else if (!vim_iswordc_buf(reginput[-1], rex.reg_buf)
-                   || (reginput[0] != NUL
+        } else if (!vim_iswordc_buf(rex.input[-1], rex.reg_buf)
+                   || (rex.input[0] != NUL
                        && vim_iswordc_buf(curc, rex.reg_buf))) {
           result = false;
         }
@@ -5457,7 +5767,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         break;
 
       case NFA_BOF:
-        if (reglnum == 0 && reginput == regline
+        if (rex.lnum == 0 && rex.input == rex.line
             && (!REG_MULTI || rex.reg_firstlnum == 1)) {
           add_here = true;
           add_state = t->state->out;
@@ -5465,7 +5775,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         break;
 
       case NFA_EOF:
-        if (reglnum == rex.reg_maxline && curc == NUL) {
+        if (rex.lnum == rex.reg_maxline && curc == NUL) {
           add_here = true;
           add_state = t->state->out;
         }
@@ -5510,7 +5820,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
           // We don't care about the order of composing characters.
           // Get them into cchars[] first.
           while (len < clen) {
-            mc = utf_ptr2char(reginput + len);
+            mc = utf_ptr2char(rex.input + len);
             cchars[ccount++] = mc;
             len += mb_char2len(mc);
             if (ccount == MAX_MCO)
@@ -5541,7 +5851,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
 
       case NFA_NEWL:
         if (curc == NUL && !rex.reg_line_lbr && REG_MULTI
-            && reglnum <= rex.reg_maxline) {
+            && rex.lnum <= rex.reg_maxline) {
           go_to_nextline = true;
           // Pass -1 for the offset, which means taking the position
           // at the start of the next line.
@@ -5653,13 +5963,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         break;
 
       case NFA_KWORD:           //  \k
-        result = vim_iswordp_buf(reginput, rex.reg_buf);
+        result = vim_iswordp_buf(rex.input, rex.reg_buf);
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_SKWORD:          //  \K
         result = !ascii_isdigit(curc)
-                 && vim_iswordp_buf(reginput, rex.reg_buf);
+                 && vim_iswordp_buf(rex.input, rex.reg_buf);
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -5674,12 +5984,12 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         break;
 
       case NFA_PRINT:           //  \p
-        result = vim_isprintc(PTR2CHAR(reginput));
+        result = vim_isprintc(PTR2CHAR(rex.input));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_SPRINT:          //  \P
-        result = !ascii_isdigit(curc) && vim_isprintc(PTR2CHAR(reginput));
+        result = !ascii_isdigit(curc) && vim_isprintc(PTR2CHAR(rex.input));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -5866,14 +6176,14 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
       case NFA_LNUM_LT:
         assert(t->state->val >= 0
                && !((rex.reg_firstlnum > 0
-                     && reglnum > LONG_MAX - rex.reg_firstlnum)
+                     && rex.lnum > LONG_MAX - rex.reg_firstlnum)
                     || (rex.reg_firstlnum < 0
-                        && reglnum < LONG_MIN + rex.reg_firstlnum))
-               && reglnum + rex.reg_firstlnum >= 0);
+                        && rex.lnum < LONG_MIN + rex.reg_firstlnum))
+               && rex.lnum + rex.reg_firstlnum >= 0);
         result = (REG_MULTI
                   && nfa_re_num_cmp((uintmax_t)t->state->val,
                                     t->state->c - NFA_LNUM,
-                                    (uintmax_t)(reglnum + rex.reg_firstlnum)));
+                                    (uintmax_t)(rex.lnum + rex.reg_firstlnum)));
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -5884,11 +6194,11 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
       case NFA_COL_GT:
       case NFA_COL_LT:
         assert(t->state->val >= 0
-               && reginput >= regline
-               && (uintmax_t)(reginput - regline) <= UINTMAX_MAX - 1);
+               && rex.input >= rex.line
+               && (uintmax_t)(rex.input - rex.line) <= UINTMAX_MAX - 1);
         result = nfa_re_num_cmp((uintmax_t)t->state->val,
                                 t->state->c - NFA_COL,
-                                (uintmax_t)(reginput - regline + 1));
+                                (uintmax_t)(rex.input - rex.line + 1));
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -5900,7 +6210,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
       case NFA_VCOL_LT:
         {
           int op = t->state->c - NFA_VCOL;
-          colnr_T col = (colnr_T)(reginput - regline);
+          colnr_T col = (colnr_T)(rex.input - rex.line);
 
           // Bail out quickly when there can't be a match, avoid the overhead of
           // win_linetabsize() on long lines.
@@ -5921,7 +6231,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
             result = col > t->state->val * ts;
           }
           if (!result) {
-            uintmax_t lts = win_linetabsize(wp, regline, col);
+            uintmax_t lts = win_linetabsize(wp, rex.line, col);
             assert(t->state->val >= 0);
             result = nfa_re_num_cmp((uintmax_t)t->state->val, op, lts + 1);
           }
@@ -5941,13 +6251,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         // Compare the mark position to the match position.
         result = (pos != NULL                        // mark doesn't exist
                   && pos->lnum > 0          // mark isn't set in reg_buf
-                  && (pos->lnum == reglnum + rex.reg_firstlnum
-                      ? (pos->col == (colnr_T)(reginput - regline)
+                  && (pos->lnum == rex.lnum + rex.reg_firstlnum
+                      ? (pos->col == (colnr_T)(rex.input - rex.line)
                          ? t->state->c == NFA_MARK
-                         : (pos->col < (colnr_T)(reginput - regline)
+                         : (pos->col < (colnr_T)(rex.input - rex.line)
                             ? t->state->c == NFA_MARK_GT
                             : t->state->c == NFA_MARK_LT))
-                      : (pos->lnum < reglnum + rex.reg_firstlnum
+                      : (pos->lnum < rex.lnum + rex.reg_firstlnum
                          ? t->state->c == NFA_MARK_GT
                          : t->state->c == NFA_MARK_LT)));
         if (result) {
@@ -5959,8 +6269,8 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
 
       case NFA_CURSOR:
         result = (rex.reg_win != NULL
-                  && (reglnum + rex.reg_firstlnum == rex.reg_win->w_cursor.lnum)
-                  && ((colnr_T)(reginput - regline)
+                  && (rex.lnum + rex.reg_firstlnum == rex.reg_win->w_cursor.lnum)
+                  && ((colnr_T)(rex.input - rex.line)
                       == rex.reg_win->w_cursor.col));
         if (result) {
           add_here = true;
@@ -6019,7 +6329,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         // If rex.reg_icombine is not set only skip over the character
         // itself.  When it is set skip over composing characters.
         if (result && enc_utf8 && !rex.reg_icombine) {
-          clen = utf_ptr2len(reginput);
+          clen = utf_ptr2len(rex.input);
         }
 
         ADD_STATE_IF_MATCH(t->state);
@@ -6059,7 +6369,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
                            == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
               // Copy submatch info from the recursive call
               copy_sub_off(&pim->subs.norm, &m->norm);
-              if (nfa_has_zsubexpr)
+              if (rex.nfa_has_zsubexpr)
                 copy_sub_off(&pim->subs.synt, &m->synt);
             }
           } else {
@@ -6084,7 +6394,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
                          == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
             // Copy submatch info from the recursive call
             copy_sub_off(&t->subs.norm, &pim->subs.norm);
-            if (nfa_has_zsubexpr)
+            if (rex.nfa_has_zsubexpr)
               copy_sub_off(&t->subs.synt, &pim->subs.synt);
           } else {
             // look-behind match failed, don't add the state
@@ -6120,21 +6430,21 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
     // matters!
     // Do not add the start state in recursive calls of nfa_regmatch(),
     // because recursive calls should only start in the first position.
-    // Unless "nfa_endp" is not NULL, then we match the end position.
+    // Unless "rex.nfa_endp" is not NULL, then we match the end position.
     // Also don't start a match past the first line.
-    if (!nfa_match
+    if (!rex.nfa_match
         && ((toplevel
-             && reglnum == 0
+             && rex.lnum == 0
              && clen != 0
              && (rex.reg_maxcol == 0
-                 || (colnr_T)(reginput - regline) < rex.reg_maxcol))
-            || (nfa_endp != NULL
+                 || (colnr_T)(rex.input - rex.line) < rex.reg_maxcol))
+            || (rex.nfa_endp != NULL
                 && (REG_MULTI
-                    ? (reglnum < nfa_endp->se_u.pos.lnum
-                       || (reglnum == nfa_endp->se_u.pos.lnum
-                           && (int)(reginput - regline)
-                           < nfa_endp->se_u.pos.col))
-                    : reginput < nfa_endp->se_u.ptr)))) {
+                    ? (rex.lnum < rex.nfa_endp->se_u.pos.lnum
+                       || (rex.lnum == rex.nfa_endp->se_u.pos.lnum
+                           && (int)(rex.input - rex.line)
+                           < rex.nfa_endp->se_u.pos.col))
+                    : rex.input < rex.nfa_endp->se_u.ptr)))) {
 #ifdef REGEXP_DEBUG
       fprintf(log_fd, "(---) STARTSTATE\n");
 #endif
@@ -6144,24 +6454,31 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         int add = TRUE;
         int c;
 
-        if (prog->regstart != NUL && clen != 0) {
+        if ((prog->regstart != NUL || prog->literals != NULL) && clen != 0) {
           if (nextlist->n == 0) {
-            colnr_T col = (colnr_T)(reginput - regline) + clen;
+            colnr_T col = (colnr_T)(rex.input - rex.line) + clen;
 
             // Nextlist is empty, we can skip ahead to the
-            // character that must appear at the start.
-            if (skip_to_start(prog->regstart, &col) == FAIL) {
+            // text or character that must appear at the start.
+            if ((prog->literals != NULL
+                 ? skip_to_literals(prog->literals, rex.line, &col, rex.reg_ic)
+                 : skip_to_start(prog->regstart, &col)) == FAIL) {
               break;
             }
 #ifdef REGEXP_DEBUG
             fprintf(log_fd, "  Skipping ahead %d bytes to regstart\n",
-                col - ((colnr_T)(reginput - regline) + clen));
+                col - ((colnr_T)(rex.input - rex.line) + clen));
 #endif
-            reginput = regline + col - clen;
+            rex.input = rex.line + col - clen;
+          } else if (prog->literals != NULL) {
+            // Checking if one of the texts starts here is cheaper than
+            // adding a state that won't match.
+            add = nfa_literal_at(prog->literals, rex.line, rex.input + clen,
+                                 rex.reg_ic);
           } else {
             // Checking if the required start character matches is
             // cheaper than adding a state that won't match.
-            c = PTR2CHAR(reginput + clen);
+            c = PTR2CHAR(rex.input + clen);
             if (c != prog->regstart && (!rex.reg_ic || mb_tolower(c)
                                         != mb_tolower(prog->regstart))) {
 #ifdef REGEXP_DEBUG
@@ -6176,9 +6493,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start,
         if (add) {
           if (REG_MULTI)
             m->norm.list.multi[0].start_col =
-              (colnr_T)(reginput - regline) + clen;
+              (colnr_T)(rex.input - rex.line) + clen;
           else
-            m->norm.list.line[0].start = reginput + clen;
+            m->norm.list.line[0].start = rex.input + clen;
           addstate(nextlist, start->out, m, NULL, clen);
         }
       } else
@@ -6200,23 +6517,25 @@ nextchar:
     // Advance to the next character, or advance to the next line, or
     // finish.
     if (clen != 0) {
-      reginput += clen;
-    } else if (go_to_nextline || (nfa_endp != NULL && REG_MULTI
-                                  && reglnum < nfa_endp->se_u.pos.lnum)) {
+      rex.input += clen;
+    } else if (go_to_nextline || (rex.nfa_endp != NULL && REG_MULTI
+                                  && rex.lnum < rex.nfa_endp->se_u.pos.lnum)) {
       reg_nextline();
     } else {
       break;
     }
 
     // Allow interrupting with CTRL-C.
-    line_breakcheck();
+    if (!rex.reg_shared) {
+      line_breakcheck();
+    }
     if (got_int) {
       break;
     }
     // Check for timeout once every twenty times to avoid overhead.
-    if (nfa_time_limit != NULL && ++nfa_time_count == 20) {
-      nfa_time_count = 0;
-      if (profile_passed_limit(*nfa_time_limit)) {
+    if (rex.nfa_time_limit != NULL && ++rex.nfa_time_count == 20) {
+      rex.nfa_time_count = 0;
+      if (profile_passed_limit(*rex.nfa_time_limit)) {
         break;
       }
     }
@@ -6238,10 +6557,10 @@ theend:
   fclose(debug);
 #endif
 
-  return nfa_match;
+  return rex.nfa_match;
 }
 
-// Try match of "prog" with at regline["col"].
+// Try match of "prog" with at rex.line["col"].
 // Returns <= 0 for failure, number of lines contained in the match otherwise.
 static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm)
 {
@@ -6252,9 +6571,9 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm)
   FILE        *f;
 #endif
 
-  reginput = regline + col;
-  nfa_time_limit = tm;
-  nfa_time_count = 0;
+  rex.input = rex.line + col;
+  rex.nfa_time_limit = tm;
+  rex.nfa_time_count = 0;
 
 #ifdef REGEXP_DEBUG
   f = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -6264,7 +6583,7 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm)
 #ifdef REGEXP_DEBUG
     fprintf(f, "\tRegexp is \"%s\"\n", nfa_regengine.expr);
 #endif
-    fprintf(f, "\tInput text is \"%s\" \n", reginput);
+    fprintf(f, "\tInput text is \"%s\" \n", rex.input);
     fprintf(f, "\t=======================================================\n\n");
     nfa_print_state(f, start);
     fprintf(f, "\n\n");
@@ -6302,11 +6621,11 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm)
     }
     if (rex.reg_endpos[0].lnum < 0) {
       // pattern has a \ze but it didn't match, use current end
-      rex.reg_endpos[0].lnum = reglnum;
-      rex.reg_endpos[0].col = (int)(reginput - regline);
+      rex.reg_endpos[0].lnum = rex.lnum;
+      rex.reg_endpos[0].col = (int)(rex.input - rex.line);
     } else {
       // Use line number of "\ze".
-      reglnum = rex.reg_endpos[0].lnum;
+      rex.lnum = rex.reg_endpos[0].lnum;
     }
   } else {
     for (i = 0; i < subs.norm.in_use; i++) {
@@ -6315,10 +6634,10 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm)
     }
 
     if (rex.reg_startp[0] == NULL) {
-      rex.reg_startp[0] = regline + col;
+      rex.reg_startp[0] = rex.line + col;
     }
     if (rex.reg_endp[0] == NULL) {
-      rex.reg_endp[0] = reginput;
+      rex.reg_endp[0] = rex.input;
     }
   }
 
@@ -6353,7 +6672,7 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm)
     }
   }
 
-  return 1 + reglnum;
+  return 1 + rex.lnum;
 }
 
 /// Match a regexp against a string ("line" points to the string) or multiple
@@ -6369,7 +6688,6 @@ static long nfa_regexec_both(char_u *line, colnr_T startcol, proftime_T *tm)
 {
   nfa_regprog_T   *prog;
   long retval = 0L;
-  int i;
   colnr_T col = startcol;
 
   if (REG_MULTI) {
@@ -6401,26 +6719,36 @@ static long nfa_regexec_both(char_u *line, colnr_T startcol, proftime_T *tm)
     rex.reg_icombine = true;
   }
 
-  regline = line;
-  reglnum = 0;      /* relative to line */
+  rex.line = line;
+  rex.lnum = 0;      /* relative to line */
 
-  nfa_has_zend = prog->has_zend;
-  nfa_has_backref = prog->has_backref;
-  nfa_nsubexpr = prog->nsubexp;
-  nfa_listid = 1;
-  nfa_alt_listid = 2;
+  rex.nfa_has_zend = prog->has_zend;
+  rex.nfa_has_backref = prog->has_backref;
+  rex.nfa_nsubexpr = prog->nsubexp;
+  rex.nfa_listid = 1;
+  rex.nfa_alt_listid = 2;
+#ifdef REGEXP_DEBUG
   nfa_regengine.expr = prog->pattern;
+#endif
 
   if (prog->reganch && col > 0)
     return 0L;
 
-  need_clear_subexpr = TRUE;
+  rex.need_clear_subexpr = TRUE;
   /* Clear the external match subpointers if necessary. */
   if (prog->reghasz == REX_SET) {
-    nfa_has_zsubexpr = TRUE;
-    need_clear_zsubexpr = TRUE;
+    rex.nfa_has_zsubexpr = TRUE;
+    rex.need_clear_zsubexpr = TRUE;
   } else
-    nfa_has_zsubexpr = FALSE;
+    rex.nfa_has_zsubexpr = FALSE;
+
+  if (prog->literals != NULL) {
+    // Skip ahead until one of the texts we know the match must start with.
+    // When there is none there is no match.
+    if (skip_to_literals(prog->literals, rex.line, &col, rex.reg_ic) == FAIL) {
+      return 0L;
+    }
+  }
 
   if (prog->regstart != NUL) {
     /* Skip ahead until a character we know the match must start with.
@@ -6440,16 +6768,36 @@ static long nfa_regexec_both(char_u *line, colnr_T startcol, proftime_T *tm)
     goto theend;
   }
 
-  nstate = prog->nstate;
-  for (i = 0; i < nstate; ++i) {
-    prog->state[i].id = i;
-    prog->state[i].lastlist[0] = 0;
-    prog->state[i].lastlist[1] = 0;
+  // The last list IDs are kept outside of the program, so that several
+  // threads can match with the same program.
+  int *save_lastlist = rex.nfa_lastlist;
+  size_t lastlist_len = (size_t)prog->nstate * 2;
+  bool own_lastlist = !nfa_lastlist_busy;
+  if (own_lastlist) {
+    if (nfa_lastlist_size < lastlist_len) {
+      xfree(nfa_lastlist_buf);
+      nfa_lastlist_buf = xmalloc(lastlist_len * sizeof(*nfa_lastlist_buf));
+      nfa_lastlist_size = lastlist_len;
+    }
+    memset(nfa_lastlist_buf, 0, lastlist_len * sizeof(*nfa_lastlist_buf));
+    rex.nfa_lastlist = nfa_lastlist_buf;
+    nfa_lastlist_busy = true;
+  } else {
+    rex.nfa_lastlist = xcalloc(lastlist_len, sizeof(*rex.nfa_lastlist));
   }
 
   retval = nfa_regtry(prog, col, tm);
 
+  if (own_lastlist) {
+    nfa_lastlist_busy = false;
+  } else {
+    xfree(rex.nfa_lastlist);
+  }
+  rex.nfa_lastlist = save_lastlist;
+
+#ifdef REGEXP_DEBUG
   nfa_regengine.expr = NULL;
+#endif
 
 theend:
   return retval;
@@ -6528,6 +6876,7 @@ static regprog_T *nfa_regcomp(char_u *expr, int re_flags)
   prog->regflags = regflags;
   prog->engine = &nfa_regengine;
   prog->nstate = nstate;
+  prog->dfa = NULL;
   prog->has_zend = nfa_has_zend;
   prog->has_backref = nfa_has_backref;
   prog->nsubexp = regnpar;
@@ -6537,11 +6886,16 @@ static regprog_T *nfa_regcomp(char_u *expr, int re_flags)
   prog->reganch = nfa_get_reganch(prog->start, 0);
   prog->regstart = nfa_get_regstart(prog->start, 0);
   prog->match_text = nfa_get_match_text(prog->start);
+  prog->literals = nfa_get_literals(prog);
 
 #ifdef REGEXP_DEBUG
   nfa_postfix_dump(expr, OK);
   nfa_dump(prog);
 #endif
+  // The matcher uses the ids to index rex.nfa_lastlist.
+  for (int i = 0; i < prog->nstate; i++) {
+    prog->state[i].id = i;
+  }
   /* Remember whether this pattern has any \z specials in it. */
   prog->reghasz = re_has_z;
   prog->pattern = vim_strsave(expr);
@@ -6570,6 +6924,7 @@ static void nfa_regfree(regprog_T *prog)
 {
   if (prog != NULL) {
     xfree(((nfa_regprog_T *)prog)->match_text);
+    xfree(((nfa_regprog_T *)prog)->literals);
     xfree(((nfa_regprog_T *)prog)->pattern);
     xfree(prog);
   }
@@ -6595,7 +6950,9 @@ nfa_regexec_nl (
   rex.reg_mmatch = NULL;
   rex.reg_maxline = 0;
   rex.reg_line_lbr = line_lbr;
-  rex.reg_buf = curbuf;
+  if (!rex.reg_shared) {
+    rex.reg_buf = curbuf;
+  }
   rex.reg_win = NULL;
   rex.reg_ic = rmp->rm_ic;
   rex.reg_icombine = false;
@@ -120,6 +120,11 @@
                              * doesn't fit. */
 #define W_ENDCOL(wp)   (wp->w_wincol + wp->w_width)
 
+// Number of entries in the match cache of a buffer, a power of two.
+#define HLCACHE_SIZE 512
+// Number of patterns search_hl_cache_id() remembers.
+#define HLCACHE_PATS 32
+
 static match_T search_hl;       /* used for 'hlsearch' highlight matching */
 
 static foldinfo_T win_foldinfo; /* info for 'foldcolumn' */
@@ -129,6 +134,63 @@ static foldinfo_T win_foldinfo; /* info for 'foldcolumn' */
  */
 static schar_T  *current_ScreenLine;
 
+/// Everything besides the line itself that the screen rows drawn by
+/// win_line() for a line depend on. Compared with memcmp().
+typedef struct {
+  winopt_T wo;
+  int hl_attrs[HLF_COUNT];
+  int hl_attr_normal;
+  int hl_tick;
+  int width;
+  colnr_T leftcol;
+  int nrwidth;
+  bool cmdwin;
+  long ts;
+  long tw;
+  long smc;
+  synblock_T *synblock;
+  int syn_error;
+  int lcs[9];
+  unsigned dy;
+  long mco;
+  int emoji;
+  char_u *sbr;
+  char_u *cpo;
+  char_u *breakat;
+  char_u *isp;
+  char_u *ambw;
+  uint64_t opt_tick;  ///< the string option pointers above are still valid
+} LineCacheState;
+
+/// Screen rows of one buffer line, as passed to screen_line().
+typedef struct {
+  linenr_T lnum;        ///< buffer line number, 0 when unused
+  linenr_T reldist;     ///< distance to the cursor line for 'relativenumber'
+  varnumber_T tick;     ///< b:changedtick when syntax highlighting is used
+  char_u *text;         ///< copy of the line
+  int rows;             ///< number of screen rows
+  int cols;             ///< number of cells stored for each row
+  int *endcol;          ///< "endcol" argument of screen_line() for each row
+  int *clear_width;     ///< "clear_width" argument of screen_line()
+  schar_T *cells;       ///< "cols" cells of current_ScreenLine for each row
+  sattr_T *attrs;       ///< attributes of the cells
+} LineCacheEntry;
+
+/// Per-window cache of rendered lines, see win_line_cached(). Direct mapped
+/// on the line number, with twice as many entries as the window has rows.
+struct line_cache {
+  LineCacheState state;
+  bool enabled;             ///< lines of the window can be cached
+  size_t size;
+  LineCacheEntry *entries;
+};
+
+/// Incremented when the highlight attributes or syntax items change.
+static int line_cache_hl_tick = 0;
+
+/// Entry being filled by screen_line() while win_line() draws a line.
+static LineCacheEntry *line_cache_rec = NULL;
+
 StlClickDefinition *tab_page_click_defs = NULL;
 long tab_page_click_defs_size = 0;
 
@@ -274,6 +336,7 @@ void update_screen(int type)
   }
 
   updating_screen = TRUE;
+  const uint64_t start_time = os_hrtime();
   ++display_tick;           /* let syntax code know we're in a next round of
                              * display updating */
 
@@ -450,6 +513,8 @@ void update_screen(int type)
     maybe_intro_message();
   did_intro = TRUE;
 
+  g_stats.redraw++;
+  g_stats.redraw_time += (int64_t)(os_hrtime() - start_time);
 }
 
 /*
@@ -685,6 +750,7 @@ static void win_update(win_T *wp)
   }
 
   init_search_hl(wp);
+  line_cache_begin(wp);
 
   /* Force redraw when width of 'number' or 'relativenumber' column
    * changes. */
@@ -1438,12 +1504,16 @@ static void win_update(win_T *wp)
         /*
          * Display one line.
          */
-        row = win_line(wp, lnum, srow, wp->w_height, mod_top == 0);
+        bool from_cache;
+        row = win_line_cached(wp, lnum, srow, wp->w_height, mod_top == 0,
+                              &from_cache);
 
         wp->w_lines[idx].wl_folded = FALSE;
         wp->w_lines[idx].wl_lastlnum = lnum;
         did_update = DID_LINE;
-        syntax_last_parsed = lnum;
+        if (!from_cache) {
+          syntax_last_parsed = lnum;
+        }
       }
 
       wp->w_lines[idx].wl_lnum = lnum;
@@ -2096,6 +2166,187 @@ fill_foldcolumn (
   }
 }
 
+/// Frees the line cache of window "wp".
+void line_cache_free(win_T *wp)
+{
+  struct line_cache *lc = wp->w_line_cache;
+  if (lc == NULL) {
+    return;
+  }
+  line_cache_clear(lc);
+  xfree(lc->entries);
+  xfree(lc);
+  wp->w_line_cache = NULL;
+}
+
+/// Drops all cached lines, of every window. To be called when highlight
+/// attributes or syntax items change.
+void line_cache_invalidate(void)
+{
+  line_cache_hl_tick++;
+}
+
+static void line_cache_clear(struct line_cache *lc)
+{
+  for (size_t i = 0; i < lc->size; i++) {
+    LineCacheEntry *e = &lc->entries[i];
+    xfree(e->text);
+    xfree(e->endcol);
+    xfree(e->clear_width);
+    xfree(e->cells);
+    xfree(e->attrs);
+    memset(e, 0, sizeof(*e));
+  }
+}
+
+/// Prepares the line cache of "wp" for win_update(): drops the cached lines
+/// when anything they depend on changed, and decides whether lines can be
+/// cached at all.
+static void line_cache_begin(win_T *wp)
+{
+  buf_T *buf = wp->w_buffer;
+  LineCacheState state;
+  memset(&state, 0, sizeof(state));
+  memcpy(&state.wo, &wp->w_onebuf_opt, sizeof(state.wo));
+  memcpy(state.hl_attrs, wp->w_hl_attrs, sizeof(state.hl_attrs));
+  state.hl_attr_normal = wp->w_hl_attr_normal;
+  state.hl_tick = line_cache_hl_tick;
+  state.width = wp->w_width;
+  state.leftcol = wp->w_leftcol;
+  state.nrwidth = (wp->w_p_nu || wp->w_p_rnu) ? number_width(wp) : 0;
+  state.cmdwin = cmdwin_type != 0 && wp == curwin;
+  state.ts = buf->b_p_ts;
+  state.tw = buf->b_p_tw;
+  state.smc = buf->b_p_smc;
+  state.synblock = wp->w_s;
+  state.syn_error = wp->w_s->b_syn_error;
+  const int lcs[ARRAY_SIZE(state.lcs)] = {
+    lcs_eol, lcs_ext, lcs_prec, lcs_nbsp, lcs_space, lcs_tab1, lcs_tab2,
+    lcs_trail, lcs_conceal
+  };
+  memcpy(state.lcs, lcs, sizeof(state.lcs));
+  state.dy = dy_flags;
+  state.mco = p_mco;
+  state.emoji = p_emoji;
+  state.sbr = p_sbr;
+  state.cpo = p_cpo;
+  state.breakat = p_breakat;
+  state.isp = p_isp;
+  state.ambw = p_ambw;
+  state.opt_tick = get_string_option_tick();
+
+  struct line_cache *lc = wp->w_line_cache;
+  if (lc == NULL) {
+    lc = xcalloc(1, sizeof(*lc));
+    wp->w_line_cache = lc;
+  }
+  size_t size = (size_t)wp->w_height * 2;
+  if (lc->size != size) {
+    line_cache_clear(lc);
+    lc->entries = xrealloc(lc->entries, size * sizeof(*lc->entries));
+    memset(lc->entries, 0, size * sizeof(*lc->entries));
+    lc->size = size;
+  } else if (memcmp(&lc->state, &state, sizeof(state)) != 0) {
+    line_cache_clear(lc);
+  }
+  memcpy(&lc->state, &state, sizeof(state));
+
+  // Highlighting that depends on more than the text of the line and the
+  // state above: drawing these is left to win_line().
+  lc->enabled = !buf->terminal
+                && !bt_quickfix(buf)
+                && !wp->w_p_diff
+                && !wp->w_p_spell
+                && !wp->w_p_cuc
+                && compute_foldcolumn(wp, 0) == 0
+                && buf->b_signlist == NULL
+                && kb_size(&buf->b_bufhl_info) == 0
+                && search_hl.rm.regprog == NULL
+                && wp->w_match_head == NULL
+                && !(VIsual_active && buf == curwin->w_buffer)
+                && !(highlight_match && wp == curwin)
+                && dollar_vcol < 0;
+}
+
+/// Like win_line(), but copies the screen rows of line "lnum" from the line
+/// cache of "wp" when the line and everything else that affects how it is
+/// drawn did not change since it was drawn last. Otherwise draws the line
+/// and stores the rows in the cache.
+///
+/// @param[out] from_cache  Set to true when the line was not drawn again.
+///
+/// @return the number of the last row the line occupies.
+static int win_line_cached(win_T *wp, linenr_T lnum, int startrow, int endrow,
+                           bool nochange, bool *from_cache)
+{
+  struct line_cache *lc = wp->w_line_cache;
+  *from_cache = false;
+  if (lc == NULL || !lc->enabled || lc->size == 0
+      || lnum == wp->w_cursor.lnum
+      || (lnum == wp->w_topline && wp->w_skipcol > 0)) {
+    return win_line(wp, lnum, startrow, endrow, nochange);
+  }
+
+  LineCacheEntry *e = &lc->entries[(size_t)lnum % lc->size];
+  linenr_T reldist = wp->w_p_rnu ? get_cursor_rel_lnum(wp, lnum) : 0;
+  varnumber_T tick = syntax_present(wp) ? buf_get_changedtick(wp->w_buffer)
+                                        : 0;
+  if (e->lnum == lnum && e->reldist == reldist && e->tick == tick
+      && startrow + e->rows <= endrow
+      && STRCMP(e->text, ml_get_buf(wp->w_buffer, lnum, false)) == 0) {
+    unsigned off = (unsigned)(current_ScreenLine - ScreenLines);
+    for (int i = 0; i < e->rows; i++) {
+      int screen_row = startrow + i + wp->w_winrow;
+      if (i > 0) {
+        line_wrapped(wp, screen_row);
+      }
+      memcpy(current_ScreenLine, e->cells + i * e->cols,
+             (size_t)e->cols * sizeof(schar_T));
+      memcpy(ScreenAttrs + off, e->attrs + i * e->cols,
+             (size_t)e->cols * sizeof(sattr_T));
+      screen_line(screen_row, wp->w_wincol, e->endcol[i], e->clear_width[i],
+                  wp->w_p_rl, wp, wp->w_hl_attr_normal);
+    }
+    *from_cache = true;
+    return startrow + e->rows;
+  }
+
+  e->lnum = 0;
+  e->rows = 0;
+  e->cols = MIN(wp->w_width + 1, screen_Columns);
+  line_cache_rec = e;
+  int row = win_line(wp, lnum, startrow, endrow, nochange);
+  line_cache_rec = NULL;
+  if (row <= endrow && row - startrow == e->rows) {
+    xfree(e->text);
+    e->text = vim_strsave(ml_get_buf(wp->w_buffer, lnum, false));
+    e->lnum = lnum;
+    e->reldist = reldist;
+    e->tick = tick;
+  }
+  return row;
+}
+
+/// Stores the screen row that screen_line() is about to draw in the line
+/// cache entry being recorded.
+static void line_cache_record(int endcol, int clear_width)
+{
+  LineCacheEntry *e = line_cache_rec;
+  int i = e->rows++;
+  e->endcol = xrealloc(e->endcol, (size_t)e->rows * sizeof(int));
+  e->clear_width = xrealloc(e->clear_width, (size_t)e->rows * sizeof(int));
+  e->cells = xrealloc(e->cells, (size_t)(e->rows * e->cols) * sizeof(schar_T));
+  e->attrs = xrealloc(e->attrs,
+                      (size_t)(e->rows * e->cols) * sizeof(sattr_T));
+  e->endcol[i] = endcol;
+  e->clear_width[i] = clear_width;
+  unsigned off = (unsigned)(current_ScreenLine - ScreenLines);
+  memcpy(e->cells + i * e->cols, current_ScreenLine,
+         (size_t)e->cols * sizeof(schar_T));
+  memcpy(e->attrs + i * e->cols, ScreenAttrs + off,
+         (size_t)e->cols * sizeof(sattr_T));
+}
+
 /*
  * Display line "lnum" of window 'wp' on the screen.
  * Start at row "startrow", stop when "endrow" is reached.
@@ -2517,6 +2768,12 @@ win_line (
   else
     v = wp->w_leftcol;
   if (v > 0) {
+    // In a long line, start at a checkpoint of the virtual column index.
+    if (ptr == line && vcol == 0) {
+      colnr_T start;
+      vcol = vcol_index_seek(wp, lnum, (colnr_T)v, &start);
+      ptr = line + start;
+    }
     char_u  *prev_ptr = ptr;
     while (vcol < v && *ptr != NUL) {
       c = win_lbr_chartabsize(wp, line, ptr, (colnr_T)vcol, NULL);
@@ -4225,26 +4482,8 @@ win_line (
         break;
       }
 
-      if (ui_current_row() == screen_row - 1
-          && filler_todo <= 0
-          && wp->w_width == Columns) {
-        /* Remember that the line wraps, used for modeless copy. */
-        LineWraps[screen_row - 1] = TRUE;
-
-        // Special trick to make copy/paste of wrapped lines work with
-        // xterm/screen: write an extra character beyond the end of
-        // the line. This will work with all terminal types
-        // (regardless of the xn,am settings).
-        // Only do this if the cursor is on the current line
-        // (something has been written in it).
-        // Don't do this for double-width characters.
-        // Don't do this for a window not at the right screen border.
-        if (utf_off2cells(LineOffset[screen_row],
-                          LineOffset[screen_row] + screen_Columns) != 2
-            && utf_off2cells(LineOffset[screen_row - 1] + (int)Columns - 2,
-                             LineOffset[screen_row] + screen_Columns) != 2) {
-          ui_add_linewrap(screen_row - 1);
-        }
+      if (filler_todo <= 0) {
+        line_wrapped(wp, screen_row);
       }
 
       col = 0;
@@ -4284,6 +4523,31 @@ win_line (
 }
 
 
+/// Called when a line of window "wp" continues in screen row "screen_row".
+static void line_wrapped(win_T *wp, int screen_row)
+{
+  if (ui_current_row() == screen_row - 1
+      && wp->w_width == Columns) {
+    /* Remember that the line wraps, used for modeless copy. */
+    LineWraps[screen_row - 1] = TRUE;
+
+    // Special trick to make copy/paste of wrapped lines work with
+    // xterm/screen: write an extra character beyond the end of
+    // the line. This will work with all terminal types
+    // (regardless of the xn,am settings).
+    // Only do this if the cursor is on the current line
+    // (something has been written in it).
+    // Don't do this for double-width characters.
+    // Don't do this for a window not at the right screen border.
+    if (utf_off2cells(LineOffset[screen_row],
+                      LineOffset[screen_row] + screen_Columns) != 2
+        && utf_off2cells(LineOffset[screen_row - 1] + (int)Columns - 2,
+                         LineOffset[screen_row] + screen_Columns) != 2) {
+      ui_add_linewrap(screen_row - 1);
+    }
+  }
+}
+
 /*
  * Check whether the given character needs redrawing:
  * - the (first byte of the) character is different
@@ -4329,6 +4593,10 @@ static void screen_line(int row, int coloff, int endcol,
                                             // 2: occupies two display cells
   int start_dirty = -1, end_dirty = 0;
 
+  if (line_cache_rec != NULL) {
+    line_cache_record(endcol, clear_width);
+  }
+
   /* Check for illegal row and col, just in case. */
   if (row >= Rows)
     row = Rows - 1;
@@ -5449,6 +5717,11 @@ static void start_search_hl(void)
 {
   if (p_hls && !no_hlsearch) {
     last_pat_prog(&search_hl.rm);
+    if (search_hl.rm.regprog != NULL) {
+      search_hl.cache_id = search_hl_cache_id(last_search_pat(),
+                                              last_search_pat_magic(),
+                                              search_hl.rm.rmm_ic);
+    }
     // Set the time limit to 'redrawtime'.
     search_hl.tm = profile_setlimit(p_rdt);
   }
@@ -5463,6 +5736,7 @@ static void end_search_hl(void)
     vim_regfree(search_hl.rm.regprog);
     search_hl.rm.regprog = NULL;
   }
+  search_hl.cache_id = 0;
 }
 
 
@@ -5485,6 +5759,10 @@ static void init_search_hl(win_T *wp)
     cur->hl.buf = wp->w_buffer;
     cur->hl.lnum = 0;
     cur->hl.first_lnum = 0;
+    cur->hl.cache_id = cur->match.regprog == NULL
+                       ? 0
+                       : search_hl_cache_id(cur->pattern, true,
+                                            cur->match.rmm_ic);
     /* Set the time limit to 'redrawtime'. */
     cur->hl.tm = profile_setlimit(p_rdt);
     cur = cur->next;
@@ -5642,22 +5920,26 @@ next_search_hl (
                               && shl == &cur->hl
                               && cur->match.regprog == cur->hl.rm.regprog);
 
-      nmatched = vim_regexec_multi(&shl->rm, win, shl->buf, lnum, matchcol, &(shl->tm));
-      /* Copy the regprog, in case it got freed and recompiled. */
-      if (regprog_is_copy) {
-        cur->match.regprog = cur->hl.rm.regprog;
-      }
-      if (called_emsg || got_int) {
-        // Error while handling regexp: stop using this regexp.
-        if (shl == &search_hl) {
-          // don't free regprog in the match list, it's a copy
-          vim_regfree(shl->rm.regprog);
-          SET_NO_HLSEARCH(TRUE);
+      if (!search_hl_cache_get(shl, lnum, matchcol, &nmatched)) {
+        nmatched = vim_regexec_multi(&shl->rm, win, shl->buf, lnum, matchcol,
+                                     &(shl->tm));
+        // Copy the regprog, in case it got freed and recompiled.
+        if (regprog_is_copy) {
+          cur->match.regprog = cur->hl.rm.regprog;
         }
-        shl->rm.regprog = NULL;
-        shl->lnum = 0;
-        got_int = FALSE; // avoid the "Type :quit to exit Vim" message
-        break;
+        if (called_emsg || got_int) {
+          // Error while handling regexp: stop using this regexp.
+          if (shl == &search_hl) {
+            // don't free regprog in the match list, it's a copy
+            vim_regfree(shl->rm.regprog);
+            SET_NO_HLSEARCH(TRUE);
+          }
+          shl->rm.regprog = NULL;
+          shl->lnum = 0;
+          got_int = FALSE;  // avoid the "Type :quit to exit Vim" message
+          break;
+        }
+        search_hl_cache_put(shl, lnum, matchcol, nmatched);
       }
     } else if (cur != NULL) {
       nmatched = next_search_hl_pos(shl, lnum, &(cur->pos), matchcol);
@@ -5676,6 +5958,130 @@ next_search_hl (
   }
 }
 
+/// Get the id of pattern "pat" in the buffer match caches.
+///
+/// The same pattern compiled with the same flags always gets the same id, as
+/// long as it is one of the last HLCACHE_PATS patterns asked for.  An id is
+/// never reused for another pattern, so that stale ids only cause misses.
+///
+/// @return zero when matches of the pattern depend on more than the buffer
+///         text, e.g. the cursor position or the Visual area.
+static int search_hl_cache_id(const char_u *pat, bool magic, bool ic)
+{
+  static char *pats[HLCACHE_PATS];
+  static int ids[HLCACHE_PATS];
+  static size_t next_slot = 0;
+  static int last_id = 0;
+
+  if (pat == NULL) {
+    return 0;
+  }
+  // Atoms that look at the window: \%#, \%V, \%'m, \%23v and friends.  In
+  // very magic patterns they come without the backslash, so any '%' is
+  // suspect.
+  for (const char_u *p = pat; (p = vim_strchr(p, '%')) != NULL; ) {
+    p++;
+    if (*p == '<' || *p == '>') {
+      p++;
+    }
+    while (ascii_isdigit(*p)) {
+      p++;
+    }
+    if (*p == '#' || *p == 'V' || *p == '\'' || *p == 'v' || *p == '.') {
+      return 0;
+    }
+  }
+
+  size_t len = STRLEN(pat);
+  char *key = xmalloc(len + 3);
+  key[0] = magic ? 'm' : 'M';
+  key[1] = ic ? 'i' : 'I';
+  memcpy(key + 2, pat, len + 1);
+  for (size_t i = 0; i < HLCACHE_PATS; i++) {
+    if (pats[i] != NULL && strcmp(pats[i], key) == 0) {
+      xfree(key);
+      return ids[i];
+    }
+  }
+  xfree(pats[next_slot]);
+  pats[next_slot] = key;
+  ids[next_slot] = ++last_id;
+  next_slot = (next_slot + 1) % HLCACHE_PATS;
+  return last_id;
+}
+
+/// Get the entry of the match cache of "buf" used for a search from "lnum",
+/// "col" with the pattern "pat_id".  Allocates the cache and drops the
+/// entries found before the last change of the buffer.
+static hlcache_entry_T *search_hl_cache_entry(buf_T *buf, int pat_id,
+                                              linenr_T lnum, colnr_T col)
+{
+  hlcache_T *const cache = &buf->b_hlcache;
+  const varnumber_T tick = buf_get_changedtick(buf);
+
+  if (cache->entries == NULL) {
+    cache->entries = xcalloc(HLCACHE_SIZE, sizeof(*cache->entries));
+    cache->tick = tick;
+  } else if (cache->tick != tick) {
+    memset(cache->entries, 0, HLCACHE_SIZE * sizeof(*cache->entries));
+    cache->tick = tick;
+  }
+  uint32_t hash = (uint32_t)lnum * 2654435761u;
+  hash ^= (uint32_t)col * 40503u + (uint32_t)pat_id * 97u;
+  return &cache->entries[(hash ^ (hash >> 16)) & (HLCACHE_SIZE - 1)];
+}
+
+/// Look up the result of searching for "shl" from "lnum", "mincol" in the
+/// match cache.  Sets the match in "shl->rm" when found.
+///
+/// @return true if the result was found, "*nmatched" is set then.
+static bool search_hl_cache_get(match_T *shl, linenr_T lnum, colnr_T col,
+                                long *nmatched)
+{
+  if (shl->cache_id == 0) {
+    return false;
+  }
+  const hlcache_entry_T *const e = search_hl_cache_entry(shl->buf,
+                                                         shl->cache_id,
+                                                         lnum, col);
+  if (e->pat_id != shl->cache_id || e->lnum != lnum || e->col != col) {
+    return false;
+  }
+  *nmatched = e->nmatched;
+  shl->rm.startpos[0] = e->startpos;
+  shl->rm.endpos[0] = e->endpos;
+  return true;
+}
+
+/// Store the result of searching for "shl" from "lnum", "col" in the match
+/// cache.  Nothing is stored when the search may have been cut short by
+/// 'redrawtime'.
+static void search_hl_cache_put(match_T *shl, linenr_T lnum, colnr_T col,
+                                long nmatched)
+{
+  if (shl->cache_id == 0 || profile_passed_limit(shl->tm)) {
+    return;
+  }
+  hlcache_entry_T *const e = search_hl_cache_entry(shl->buf, shl->cache_id,
+                                                   lnum, col);
+  e->pat_id = shl->cache_id;
+  e->lnum = lnum;
+  e->col = col;
+  e->nmatched = nmatched;
+  if (nmatched > 0) {
+    e->startpos = shl->rm.startpos[0];
+    e->endpos = shl->rm.endpos[0];
+  }
+}
+
+/// Free the match cache of buffer "buf".  Used when its text goes away or the
+/// meaning of patterns in it changes, e.g. for 'iskeyword'.
+void search_hl_cache_free(buf_T *buf)
+{
+  xfree(buf->b_hlcache.entries);
+  buf->b_hlcache.entries = NULL;
+}
+
 /// If there is a match fill "shl" and return one.
 /// Return zero otherwise.
 static int
@@ -14,6 +14,7 @@
 #include "nvim/ascii.h"
 #include "nvim/vim.h"
 #include "nvim/search.h"
+#include "nvim/buffer.h"
 #include "nvim/charset.h"
 #include "nvim/cursor.h"
 #include "nvim/edit.h"
@@ -44,6 +45,8 @@
 #include "nvim/strings.h"
 #include "nvim/ui.h"
 #include "nvim/window.h"
+#include "nvim/event/multiqueue.h"
+#include "nvim/lib/kvec.h"
 #include "nvim/os/time.h"
 
 
@@ -105,6 +108,28 @@ static int saved_no_hlsearch = 0;
 static char_u       *mr_pattern = NULL; /* pattern used by search_regcomp() */
 static int mr_pattern_alloced = FALSE;          /* mr_pattern was allocated */
 
+// Matches of a pattern in the current buffer, counted while waiting for
+// input.  See search_count().
+#define SEARCH_COUNT_SLICE 5   // msec spent counting at a time
+#define SEARCH_COUNT_MAX_SLICE 160  // msec for a line that takes long
+
+static struct {
+  char_u *pat;                // pattern, NULL when not counting
+  bool magic;                 // 'magic' for "pat"
+  bool ic;                    // ignore case for "pat"
+  bool cpo_search;            // 'cpoptions' has "c"
+  handle_T buf_handle;        // buffer the matches are in
+  varnumber_T changedtick;    // b:changedtick when counting started
+  linenr_T lnum;              // next line to search, 0 when done
+  colnr_T col;                // column in "lnum" to search from
+  int slice;                  // msec spent counting at a time while
+                              // waiting for input, longer for a line that
+                              // took more than that
+  bool timed_out;             // a line took too long to search
+  kvec_t(lpos_T) matches;     // start of all matches found so far
+} search_count_state = { NULL, false, false, false, 0, 0, 0, 0,
+                         SEARCH_COUNT_SLICE, false, KV_INITIAL_VALUE };
+
 /*
  * Type used by find_pattern_in_path() to remember which included files have
  * been searched already.
@@ -249,6 +274,8 @@ void save_re_pat(int idx, char_u *pat, int magic)
     if (p_hls)
       redraw_all_later(SOME_VALID);
     SET_NO_HLSEARCH(FALSE);
+    // %{} items in 'statusline' may use searchcount().
+    stl_expr_invalidate();
   }
 }
 
@@ -304,6 +331,11 @@ void free_search_patterns(void)
     mr_pattern_alloced = FALSE;
     mr_pattern = NULL;
   }
+
+  xfree(search_count_state.pat);
+  search_count_state.pat = NULL;
+  kv_destroy(search_count_state.matches);
+  kv_init(search_count_state.matches);
 }
 
 #endif
@@ -436,6 +468,12 @@ char_u *last_search_pat(void)
   return spats[last_idx].pat;
 }
 
+/// Return true when the last used search pattern is used with 'magic' set.
+bool last_search_pat_magic(void)
+{
+  return spats[last_idx].magic;
+}
+
 /*
  * Reset search direction to forward.  For "gd" and "gD" commands.
  */
@@ -480,6 +518,8 @@ void set_last_search_pat(const char_u *s, int idx, int magic, int setlast)
   /* If 'hlsearch' set and search pat changed: need redraw. */
   if (p_hls && idx == last_idx && !no_hlsearch)
     redraw_all_later(SOME_VALID);
+  // %{} items in 'statusline' may use searchcount().
+  stl_expr_invalidate();
 }
 
 /*
@@ -4841,3 +4881,234 @@ bool search_was_last_used(void)
 {
   return last_idx == 0;
 }
+
+/// Count the matches of "pat" in the current buffer, or the last search
+/// pattern when "pat" is NULL or empty.  When counting takes more than a few
+/// msec it continues while waiting for input.  The results are kept until the
+/// buffer or pattern changes.
+///
+/// @return  false when there is no pattern.
+bool search_count(const char_u *pat, SearchCount *count)
+{
+  bool magic = p_magic;
+
+  if (pat == NULL || *pat == NUL) {
+    pat = spats[RE_SEARCH].pat;
+    if (pat == NULL || *pat == NUL) {
+      return false;
+    }
+    magic = spats[RE_SEARCH].magic;
+    no_smartcase = spats[RE_SEARCH].no_scs;
+  }
+  bool ic = ignorecase((char_u *)pat);
+  bool cpo_search = vim_strchr(p_cpo, CPO_SEARCH) != NULL;
+  varnumber_T changedtick = buf_get_changedtick(curbuf);
+  // Items like "\%l", "\%#" and "\%V" depend on more than the text, the
+  // matches found before can't be used.
+  bool cacheable = strstr((const char *)pat, "\\%") == NULL
+                   && (strstr((const char *)pat, "\\v") == NULL
+                       || vim_strchr(pat, '%') == NULL);
+
+  if (!cacheable
+      || search_count_state.pat == NULL
+      || STRCMP(search_count_state.pat, pat) != 0
+      || search_count_state.magic != magic
+      || search_count_state.ic != ic
+      || search_count_state.cpo_search != cpo_search
+      || search_count_state.buf_handle != curbuf->handle
+      || search_count_state.changedtick != changedtick) {
+    xfree(search_count_state.pat);
+    search_count_state.pat = vim_strsave(pat);
+    search_count_state.magic = magic;
+    search_count_state.ic = ic;
+    search_count_state.cpo_search = cpo_search;
+    search_count_state.buf_handle = curbuf->handle;
+    search_count_state.changedtick = changedtick;
+    search_count_state.lnum = 1;
+    search_count_state.col = 0;
+    search_count_state.slice = SEARCH_COUNT_SLICE;
+    search_count_state.timed_out = false;
+    kv_size(search_count_state.matches) = 0;
+  }
+  if (search_count_state.lnum != 0) {
+    // Don't use the longer time for a slow line here, this may be called
+    // for every redraw.
+    search_count_step(SEARCH_COUNT_SLICE);
+  }
+
+  // Find the first match after the cursor.
+  size_t lo = 0;
+  size_t hi = kv_size(search_count_state.matches);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    lpos_T pos = kv_A(search_count_state.matches, mid);
+    if (pos.lnum < curwin->w_cursor.lnum
+        || (pos.lnum == curwin->w_cursor.lnum
+            && pos.col <= curwin->w_cursor.col)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  count->current = (int64_t)lo;
+  count->total = (int64_t)kv_size(search_count_state.matches);
+  count->incomplete = search_count_state.lnum != 0
+                      || search_count_state.timed_out;
+  if (!cacheable) {
+    // The next call starts over, don't continue while waiting for input.
+    search_count_state.lnum = 0;
+  }
+  return true;
+}
+
+/// Continue counting matches for search_count() for "slice" msec.
+///
+/// @return  true when done.
+static bool search_count_step(int slice)
+{
+  if (search_count_state.buf_handle != curbuf->handle
+      || search_count_state.changedtick != buf_get_changedtick(curbuf)) {
+    // Buffer changed, search_count() starts over.
+    search_count_state.lnum = 0;
+    return true;
+  }
+
+  regmmatch_T regmatch;
+  regmatch.rmm_ic = search_count_state.ic;
+  regmatch.rmm_maxcol = 0;
+  regmatch.regprog = vim_regcomp(search_count_state.pat,
+                                 search_count_state.magic ? RE_MAGIC : 0);
+  if (regmatch.regprog == NULL) {
+    search_count_state.lnum = 0;
+    return true;
+  }
+
+  proftime_T tm = profile_setlimit(slice);
+  linenr_T lnum = search_count_state.lnum;
+  colnr_T col = search_count_state.col;
+  bool first = true;
+  while (lnum <= curbuf->b_ml.ml_line_count) {
+    long nmatch = vim_regexec_multi(&regmatch, curwin, curbuf, lnum, col, &tm);
+    if (profile_passed_limit(tm)) {
+      if (nmatch == 0 && first) {
+        // Searching in this line alone takes too long.  Try again with
+        // more time while waiting for input, skip it when that doesn't help.
+        // search_count() always uses a short slice.
+        if (slice < search_count_state.slice) {
+          // search_count_idle_work() tries again with the longer time.
+        } else if (search_count_state.slice < SEARCH_COUNT_MAX_SLICE) {
+          search_count_state.slice *= 2;
+        } else {
+          search_count_state.timed_out = true;
+          search_count_state.slice = SEARCH_COUNT_SLICE;
+          lnum++;
+          col = 0;
+        }
+      }
+      break;
+    }
+    if (first) {
+      // Back to short slices after a line that took long.
+      search_count_state.slice = SEARCH_COUNT_SLICE;
+      first = false;
+    }
+    if (nmatch == 0) {
+      lnum++;
+      col = 0;
+      continue;
+    }
+
+    lpos_T start = { lnum + regmatch.startpos[0].lnum,
+                     regmatch.startpos[0].col };
+    kv_push(search_count_state.matches, start);
+
+    // Continue where "n" would find the next match.
+    const char_u *line = ml_get(start.lnum);
+    if (search_count_state.cpo_search
+        && regmatch.endpos[0].lnum > regmatch.startpos[0].lnum) {
+      // Match ends in a later line: no more matches in this line.
+      lnum = start.lnum + 1;
+      col = 0;
+    } else if (search_count_state.cpo_search
+               && regmatch.endpos[0].col > start.col) {
+      lnum = start.lnum;
+      col = regmatch.endpos[0].col;
+    } else if (line[start.col] == NUL) {
+      lnum = start.lnum + 1;
+      col = 0;
+    } else {
+      lnum = start.lnum;
+      col = start.col + utfc_ptr2len(line + start.col);
+    }
+  }
+  vim_regfree(regmatch.regprog);
+
+  if (lnum > curbuf->b_ml.ml_line_count) {
+    search_count_state.lnum = 0;
+    return true;
+  }
+  search_count_state.lnum = lnum;
+  search_count_state.col = col;
+  return false;
+}
+
+/// Count matches for search_count() while waiting for input, for
+/// SEARCH_COUNT_SLICE msec or longer when a line takes more.  When done,
+/// status lines are redrawn to show the final count.
+///
+/// @return  true when there is more to do.
+bool search_count_idle_work(void)
+{
+  if (search_count_state.lnum == 0
+      || (State != NORMAL && !(State & INSERT)) || (State & CMDLINE)
+      || updating_screen || got_int || curbuf->b_ml.ml_mfp == NULL) {
+    return false;
+  }
+  if (search_count_step(search_count_state.slice)) {
+    multiqueue_put(main_loop.events, search_count_done_event, 0);
+    return false;
+  }
+  return true;
+}
+
+static void search_count_done_event(void **argv)
+{
+  // %{} items in 'statusline' may use searchcount().
+  stl_expr_invalidate();
+  status_redraw_all();
+  redraw_tabline = true;
+}
+
+/// Check if "pat" is "prev_pat" with only plain characters appended, while
+/// typing a pattern.  Then every match of "pat" starts where "prev_pat"
+/// matches, and a search for "pat" can skip text without a match for
+/// "prev_pat".
+bool search_pat_narrows(const char_u *prev_pat, const char_u *pat)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  size_t len = STRLEN(prev_pat);
+
+  // A "$" is only end-of-line at the end of the pattern.
+  if (len == 0 || STRNCMP(prev_pat, pat, len) != 0
+      || prev_pat[len - 1] == '$') {
+    return false;
+  }
+  // Items that take a number or change how text after them is matched,
+  // such as "\%d12", "\{1,2}", "\zs" and "\v".
+  for (const char_u *p = prev_pat; *p != NUL; p++) {
+    if (*p == '\\') {
+      p++;
+      if (*p == NUL || vim_strchr((char_u *)"%{z@_vV", *p) != NULL) {
+        return false;
+      }
+    } else if (*p == '{') {
+      return false;
+    }
+  }
+  for (const char_u *p = pat + len; *p != NUL; p++) {
+    if (!ASCII_ISALNUM(*p) && *p != ' ' && *p != '_' && *p < 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -70,6 +70,13 @@ typedef struct spat {
   dict_T *additional_data;  ///< Additional data from ShaDa file.
 } SearchPattern;
 
+/// Number of matches of a search pattern, see search_count().
+typedef struct {
+  int64_t current;  ///< Number of matches starting at or before the cursor.
+  int64_t total;    ///< Number of matches in the buffer.
+  bool incomplete;  ///< Still counting: the numbers may be too small.
+} SearchCount;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "search.h.generated.h"
 #endif
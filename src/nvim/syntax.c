@@ -44,6 +44,7 @@
 #include "nvim/ui.h"
 #include "nvim/os/os.h"
 #include "nvim/os/time.h"
+#include "nvim/profile.h"
 #include "nvim/buffer.h"
 
 static bool did_syntax_onoff = false;
@@ -542,6 +543,107 @@ void syntax_start(win_T *wp, linenr_T lnum)
   syn_start_line();
 }
 
+// Idle-time precomputation of syntax states, see syntax_idle_work().
+#define SYN_IDLE_SLICE 5      // milliseconds of work per slice
+#define SYN_IDLE_STEP 16      // lines parsed between time checks
+#define SYN_IDLE_AHEAD 2000   // lines below the window done first
+#define SYN_IDLE_DONE 3       // phase after the last one
+
+static struct {
+  win_T *win;                 // window the work is done for
+  synblock_T *block;          // its syntax block
+  varnumber_T changedtick;    // b:changedtick when the work started
+  linenr_T topline;           // w_topline when the work started
+  int phase;                  // range being parsed, see syn_idle_range()
+  linenr_T lnum;              // next line to parse in that range
+} syn_idle = { NULL, NULL, 0, 0, 0, 0 };
+
+/// Get the range of lines that idle work "phase" parses for window "wp".
+/// First the lines just below the window, then the lines above it and then
+/// the rest of the buffer.
+///
+/// @return false when there is no such phase.
+static bool syn_idle_range(win_T *wp, int phase,
+                           linenr_T *start, linenr_T *end)
+{
+  const linenr_T line_count = wp->w_buffer->b_ml.ml_line_count;
+  const linenr_T ahead = MIN(wp->w_botline + SYN_IDLE_AHEAD, line_count);
+
+  switch (phase) {
+    case 0: {
+      *start = wp->w_botline;
+      *end = ahead;
+      return true;
+    }
+    case 1: {
+      *start = 1;
+      *end = wp->w_topline - 1;
+      return true;
+    }
+    case 2: {
+      *start = ahead + 1;
+      *end = line_count;
+      return true;
+    }
+    default: {
+      assert(phase == SYN_IDLE_DONE);
+      return false;
+    }
+  }
+}
+
+/// Parse syntax in the current window for at most SYN_IDLE_SLICE msec, to
+/// store states in b_sst_array[] before they are needed for redrawing.
+/// Called repeatedly while waiting for input.  Starts over when the window,
+/// its text or the top line change.
+///
+/// @return true when called again would do more work.
+bool syntax_idle_work(void)
+{
+  win_T *const wp = curwin;
+
+  if ((State != NORMAL && !(State & INSERT)) || (State & CMDLINE)
+      || updating_screen || got_int || wp->w_buffer->b_ml.ml_mfp == NULL
+      || !syntax_present(wp)) {
+    return false;
+  }
+  const varnumber_T changedtick = buf_get_changedtick(wp->w_buffer);
+  if (syn_idle.win != wp || syn_idle.block != wp->w_s
+      || syn_idle.changedtick != changedtick
+      || syn_idle.topline != wp->w_topline) {
+    syn_idle.win = wp;
+    syn_idle.block = wp->w_s;
+    syn_idle.changedtick = changedtick;
+    syn_idle.topline = wp->w_topline;
+    syn_idle.phase = 0;
+    syn_idle.lnum = 0;
+  }
+
+  proftime_T tm = profile_setlimit(SYN_IDLE_SLICE);
+  linenr_T start;
+  linenr_T end;
+  while (syn_idle_range(wp, syn_idle.phase, &start, &end)) {
+    syn_idle.lnum = MAX(syn_idle.lnum, start);
+    if (syn_idle.lnum > end) {
+      syn_idle.phase++;
+      syn_idle.lnum = 0;
+      continue;
+    }
+    if (profile_passed_limit(tm)) {
+      return true;
+    }
+    const linenr_T lnum = MIN(syn_idle.lnum + SYN_IDLE_STEP, end + 1);
+    g_stats.syn_idle_lines += lnum - syn_idle.lnum;
+    syn_idle.lnum = lnum;
+    syntax_start(wp, MIN(syn_idle.lnum, end));
+    if (got_int || syn_block->b_sst_array == NULL) {
+      break;
+    }
+  }
+  syn_idle.phase = SYN_IDLE_DONE;  // until something changes
+  return false;
+}
+
 /*
  * We cannot simply discard growarrays full of state_items or buf_states; we
  * have to manually release their extmatch pointers first.
@@ -999,6 +1101,7 @@ static void syn_stack_free_block(synblock_T *block)
 void syn_stack_free_all(synblock_T *block)
 {
   syn_stack_free_block(block);
+  line_cache_invalidate();
 
   /* When using "syntax" fold method, must update all folds. */
   FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
@@ -7443,6 +7546,7 @@ void highlight_changed(void)
   int hlcnt;
 
   need_highlight_changed = FALSE;
+  line_cache_invalidate();
 
   /// Translate builtin highlight groups into attributes for quick lookup.
   for (int hlf = 0; hlf < (int)HLF_COUNT; hlf++) {
@@ -18,3 +18,52 @@ func Test_nested_global()
   call assert_equal(['nothing', '++found', 'found bad', 'bad'], getline(1, 4))
   bwipe!
 endfunc
+
+" Marked lines follow the text when commands insert or delete lines.  Moved
+" lines are no longer marked.
+func Test_global_marks_follow_lines()
+  new
+  call setline(1, ['a1', 'b1', 'a2', 'a3', 'b2', 'a4'])
+  g/^/m0
+  call assert_equal(['a4', 'b2', 'a3', 'a2', 'b1', 'a1'], getline(1, '$'))
+
+  call setline(1, ['a1', 'b1', 'a2', 'a3', 'b2', 'a4'])
+  g/a/m$
+  call assert_equal(['b1', 'b2', 'a1', 'a2', 'a3', 'a4'], getline(1, '$'))
+
+  " deleting a marked line below the current one
+  %d
+  call setline(1, ['a1', 'a2', 'b1', 'a3', 'b2'])
+  g/a/.,+1d
+  call assert_equal(['b1'], getline(1, '$'))
+
+  " inserting lines
+  %d
+  call setline(1, ['a1', 'b1', 'a2'])
+  g/a/t.
+  call assert_equal(['a1', 'a1', 'b1', 'a2', 'a2'], getline(1, '$'))
+
+  " a moved line is not visited
+  %d
+  call setline(1, ['a1', 'a2', 'b'])
+  g/a/+1m0
+  call assert_equal(['a2', 'a1', 'b'], getline(1, '$'))
+
+  " joining with the line above
+  %d
+  call setline(1, ['x', 'a1', 'a2', 'b', 'a3'])
+  g/a/-1j
+  call assert_equal(['x a1 a2', 'b a3'], getline(1, '$'))
+  bwipe!
+endfunc
+
+func Test_global_many_lines()
+  new
+  call setline(1, map(range(1, 20000), 'v:val % 3 ? "keep " . v:val : "drop"'))
+  g/drop/d
+  call assert_equal(13334, line('$'))
+  call assert_equal(['keep 1', 'keep 2', 'keep 4'], getline(1, 3))
+  v/[05]$/d
+  call assert_equal(['keep 5', 'keep 10', 'keep 20'], getline(1, 3))
+  bwipe!
+endfunc
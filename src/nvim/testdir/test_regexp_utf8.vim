@@ -31,6 +31,12 @@ func Test_equivalence_re2()
   set re=0
 endfunc
 
+func Test_equivalence_re3()
+  set re=3
+  call s:equivalence_test()
+  set re=0
+endfunc
+
 func s:classes_test()
   set isprint=@,161-255
   call assert_equal('Motörhead', matchstr('Motörhead', '[[:print:]]\+'))
@@ -135,6 +141,12 @@ func Test_classes_re2()
   set re=0
 endfunc
 
+func Test_classes_re3()
+  set re=3
+  call s:classes_test()
+  set re=0
+endfunc
+
 func Test_recursive_substitute()
   new
   s/^/\=execute("s#^##gn")
@@ -146,7 +158,7 @@ endfunc
 func Test_nested_backrefs()
   " Check example in change.txt.
   new
-  for re in range(0, 2)
+  for re in range(0, 3)
     exe 'set re=' . re
     call setline(1, 'aa ab x')
     1s/\(\(a[a-d] \)*\)\(x\)/-\1- -\2- -\3-/
@@ -160,7 +172,7 @@ endfunc
 
 func Test_eow_with_optional()
   let expected = ['abc def', 'abc', 'def', '', '', '', '', '', '', '']
-  for re in range(0, 2)
+  for re in range(0, 3)
     exe 'set re=' . re
     let actual = matchlist('abc def', '\(abc\>\)\?\s*\(def\)')
     call assert_equal(expected, actual)
@@ -168,7 +180,7 @@ func Test_eow_with_optional()
 endfunc
 
 func Test_reversed_range()
-  for re in range(0, 2)
+  for re in range(0, 3)
     exe 'set re=' . re
     call assert_fails('call match("abc def", "[c-a]")', 'E944:')
   endfor
@@ -183,3 +195,92 @@ func Test_large_class()
   call assert_equal(1, "\u3042" =~# '[\u3000-\u4000]')
   set re=0
 endfunc
+
+func Test_dfa_engine()
+  " The DFA engine must give the same result as the NFA engine.
+  let tests = [
+        \ ['^abc', 'abc', 'xabc', 'ab'],
+        \ ['abc$', 'xabc', 'abcx', ''],
+        \ ['^$', '', 'x'],
+        \ ['a\+b*c', 'xaaac', 'xbc', 'aabbc'],
+        \ ['\<foo\>', 'a foo b', 'foobar'],
+        \ ['\(ab\|cd\)\{2}', 'xabcdx', 'abxcd'],
+        \ ['[^a-z]\d\+', 'abc123', 'X9', 'abc'],
+        \ ['\cHELLO', 'say hello', 'help'],
+        \ ['x\%[abc]y', 'xaby', 'xacy', 'xy'],
+        \ ['\s\+\ze\S', 'a  b', 'a  '],
+        \ ['ä\+ö', 'xääö', 'xö', 'aö'],
+        \ ['[[:upper:]][[:lower:]]\+', 'Élan', 'élan'],
+        \ ['e\%1c', 'ea', 'ae'],
+        \ ['\v(a|b)*c$', 'ababc', 'abcd'],
+        \ ['\%^x', 'x', 'yx'],
+        \ ]
+  for [pat; texts] in tests
+    for text in texts
+      for ic in [0, 1]
+        let &ignorecase = ic
+        call assert_equal(match(text, '\%#=2' . pat),
+              \ match(text, '\%#=3' . pat), pat . ' in ' . string(text))
+      endfor
+    endfor
+  endfor
+  set noignorecase
+
+  " Patterns the DFA engine can't handle fall back to the NFA engine.
+  call assert_equal(['abab', 'ab'], matchlist('xabab', '\%#=3\(ab\)\1')[:1])
+  call assert_equal(1, match('xfoobar', '\%#=3foo\(bar\)\@='))
+  call assert_equal(1, match("aa\u0301b", "\\%#=3a\u0301"))
+
+  " Searching in a buffer.
+  new
+  call setline(1, ['one', 'two three', 'four'])
+  set re=3
+  call cursor(1, 1)
+  call assert_equal([2, 5], searchpos('t\w\+e'))
+  call assert_equal([3, 1], searchpos('^f'))
+  call assert_equal([0, 0], searchpos('^t\w*x', 'n'))
+  set re=0
+  bwipe!
+endfunc
+
+func Test_skip_to_literals()
+  " Patterns where a match starts with one of a few texts.
+  let tests = [
+        \ ['\(foo\|bar\|baz\)', 'xx fo ba Bar baz foo'],
+        \ ['\<\(if\|while\)\s*(', 'elif (x) while (y)'],
+        \ ['[Ff]oo\|qux', 'a fOo Foo'],
+        \ ['a\?bc', 'xxbcabc'],
+        \ ['x\(ab\)*y', 'xaby xy'],
+        \ ['\(cat\|dog\)s\@=', 'cat dogs'],
+        \ ['fo\zsobar', 'foobar'],
+        \ ['kelvin\|öl', 'KELVIN ÖL öl'],
+        \ ['é\+', 'cafe café'],
+        \ ]
+  for [pat, text] in tests
+    for ic in [0, 1]
+      let &ignorecase = ic
+      let expected = match(text, '\%#=1' . pat)
+      call assert_equal(expected, match(text, '\%#=2' . pat), pat . ' re=2')
+      call assert_equal(expected, match(text, '\%#=3' . pat), pat . ' re=3')
+      call assert_equal(matchstr(text, '\%#=1' . pat, 3),
+            \ matchstr(text, '\%#=2' . pat, 3), pat . ' from 3')
+    endfor
+  endfor
+
+  " With 'ignorecase' a character matches another one with the same lower
+  " case character, also when it has a different first byte.
+  set ignorecase
+  for re in [2, 3]
+    call assert_equal(3, match('xx K', '\%#=' . re . "\\(\u212a\\|q\\)"))
+    call assert_equal(3, match('xx I', '\%#=' . re . "\\(\u0130\\|q\\)"))
+    call assert_equal(3, match("xx \u212a", '\%#=' . re . '\(k\|q\)'))
+  endfor
+  set noignorecase
+
+  " A collection also matches the composing characters after the character.
+  for re in [1, 2, 3]
+    call assert_equal(1, match("xa\u0301c", '\%#=' . re . '[ab]c'), 're=' . re)
+    call assert_equal(0, match("xa\u0301c", '\%#=' . re . 'x[ab]c'), 're=' . re)
+    call assert_equal(-1, match("xa\u0301c", '\%#=' . re . 'ac'), 're=' . re)
+  endfor
+endfunc
@@ -480,3 +480,71 @@ func Test_look_behind()
   call search(getline("."))
   bwipe!
 endfunc
+
+func Test_searchcount()
+  new
+  set noignorecase cpo&
+  call setline(1, ['foo bar foo', 'bar', 'foofoo', 'Foo'])
+  let @/ = 'foo'
+  call cursor(1, 1)
+  call assert_equal({'current': 1, 'total': 4, 'incomplete': 0}, searchcount())
+  call cursor(1, 5)
+  call assert_equal(1, searchcount().current)
+  call cursor(3, 4)
+  call assert_equal(4, searchcount().current)
+  call cursor(2, 1)
+  call assert_equal(2, searchcount().current)
+
+  set ignorecase
+  call assert_equal(5, searchcount().total)
+  set smartcase
+  call assert_equal({'current': 0, 'total': 1, 'incomplete': 0},
+        \ searchcount({'pattern': 'Foo'}))
+  set noignorecase nosmartcase
+
+  " counts again after a change
+  call append('$', 'foo')
+  call assert_equal(5, searchcount().total)
+
+  " overlapping matches are only counted without "c" in 'cpoptions'
+  call setline(1, 'aaaa')
+  call assert_equal(2, searchcount({'pattern': 'aa'}).total)
+  set cpo-=c
+  call assert_equal(3, searchcount({'pattern': 'aa'}).total)
+  set cpo&
+
+  " matches that depend on the cursor are not remembered
+  call setline(1, ['foo bar', 'bar'])
+  call cursor(1, 5)
+  call assert_equal(1, searchcount({'pattern': '\%#bar'}).total)
+  call cursor(1, 1)
+  call assert_equal(0, searchcount({'pattern': '\%#bar'}).total)
+  call cursor(2, 1)
+  call assert_equal(1, searchcount({'pattern': '\v%#bar'}).total)
+
+  let @/ = ''
+  call assert_equal({}, searchcount())
+  call assert_fails('call searchcount("foo")', 'E715:')
+  bwipe!
+endfunc
+
+func Test_search_multiline_many_lines()
+  new
+  call setline(1, map(range(1, 3000), '"line " . v:val'))
+  call setline(1500, ['abc', 'abc'])
+  for re in range(3)
+    exe 'set re=' . re
+    call cursor(1, 1)
+    call assert_equal(1500, search('\(abc\)\n\1'))
+    call assert_equal(2999, search('line 2999\_s\+line 3000'))
+    call assert_equal(10, search('line 10\nline 11', 'b'))
+    call assert_equal(1, search('^line 1\n\_.*\nline 3000$', 'w'))
+    " a changed line that wasn't written into the memline yet
+    call setline(2000, 'xyz')
+    call assert_equal(1999, search('line 1999\nxyz\nline 2001'))
+    call setline(2000, 'line 2000')
+    call assert_equal(0, search('line 1999\nxyz', 'n'))
+  endfor
+  set re&
+  bwipe!
+endfunc
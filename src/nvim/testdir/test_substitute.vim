@@ -501,3 +501,42 @@ func Test_sub_replace_10()
    call assert_equal('aa2a3a', substitute('123', '1\|\ze', 'a', 'g'))
    call assert_equal('1aaa', substitute('123', '1\zs\|[23]', 'a', 'g'))
 endfunc
+
+" Substituting in many lines: lines are replaced in batches.
+func Test_sub_many_lines()
+  new
+  let lines = map(range(1, 3000), '"line " . v:val . repeat("x", v:val % 50)')
+  call setline(1, lines)
+  let &undolevels = &undolevels
+
+  " Lines get longer, data blocks have to be split.
+  %s/line \(\d\+\)/& and more text for \1/
+  call assert_equal(map(copy(lines),
+        \ 'substitute(v:val, ''line \(\d\+\)'', ''& and more text for \1'', "")'),
+        \ getline(1, '$'))
+  let expected_bytes = 1
+  for l in getline(1, '$')
+    let expected_bytes += len(l) + 1
+  endfor
+  call assert_equal(expected_bytes, line2byte('$') + len(getline('$')) + 1)
+
+  " One undo step restores all lines.
+  undo
+  call assert_equal(lines, getline(1, '$'))
+  call assert_equal(1, line('.'))
+  redo
+  call assert_equal('line 1 and more text for 1x', getline(1))
+
+  " Lines get shorter, only some of them change.
+  call setline(1, lines)
+  let &undolevels = &undolevels
+  %s/line \d*5\zsx*//
+  call assert_equal('line 5', getline(5))
+  call assert_equal(lines[5], getline(6))
+  call assert_equal('line 2995', getline(2995))
+  undo
+  call assert_equal(lines, getline(1, '$'))
+  call assert_equal(5, line('.'))
+
+  bwipe!
+endfunc
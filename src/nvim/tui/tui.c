@@ -31,6 +31,7 @@
 #include "nvim/event/signal.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
+#include "nvim/os/time.h"
 #include "nvim/strings.h"
 #include "nvim/syntax.h"
 #include "nvim/ui_bridge.h"
@@ -46,11 +47,15 @@
 #define CNORM_COMMAND_MAX_SIZE 32
 #define OUTBUF_SIZE 0xffff
 
-#define TOO_MANY_EVENTS 1000000
+// While UI events keep arriving, frames are deferred until the queued events
+// are applied, but not longer than this (nanoseconds).
+#define FRAME_MAX_DELAY (1000000000 / 60)
 #define STARTS_WITH(str, prefix) (strlen(str) >= (sizeof(prefix) - 1) \
     && 0 == memcmp((str), (prefix), sizeof(prefix) - 1))
 #define TMUX_WRAP(is_tmux, seq) ((is_tmux) \
     ? "\x1bPtmux;\x1b" seq "\x1b\\" : seq)
+// Cost of a capability the terminal does not have.
+#define COST_INF (INT_MAX / 4)
 #define LINUXSET0C "\x1b[?0c"
 #define LINUXSET1C "\x1b[?1c"
 
@@ -67,17 +72,25 @@ typedef struct {
   int top, bot, left, right;
 } Rect;
 
+typedef struct {
+  Rect region;
+  int rows;
+} Scroll;
+
 typedef struct {
   UIBridgeData *bridge;
   Loop *loop;
   unibi_var_t params[9];
-  char buf[OUTBUF_SIZE];
+  char bufs[2][OUTBUF_SIZE];  // one is written while the other is filled
+  char *buf;
   size_t bufpos;
   char norm[CNORM_COMMAND_MAX_SIZE];
   char invis[CNORM_COMMAND_MAX_SIZE];
   size_t normlen, invislen;
   TermInput input;
   uv_loop_t write_loop;
+  uv_write_t write_req;
+  bool writing;
   unibi_term *ut;
   union {
     uv_tty_t tty;
@@ -86,9 +99,12 @@ typedef struct {
   bool out_isatty;
   SignalWatcher winch_handle, cont_handle;
   bool cont_received;
-  UGrid grid;
-  kvec_t(Rect) invalid_regions;
-  bool did_resize;
+  UGrid grid;   // terminal screen, as of the last frame
+  UGrid frame;  // screen requested by the UI events, drawn by tui_flush()
+  kvec_t(Scroll) scrolls;  // scrolls of `frame` not yet done on the terminal
+  bool clear_pending;
+  bool frame_scheduled;
+  uint64_t last_frame;
   int row, col;
   int out_fd;
   bool scroll_region_is_full_screen;
@@ -100,10 +116,14 @@ typedef struct {
   bool mouse_enabled;
   bool busy, is_invisible;
   bool cork, overflow;
+  struct {
+    int cr, home, cuf1, cub1, cud1, cuu1;
+  } cost;  // bytes of the parameterless motions, see motion_cost()
   cursorentry_T cursor_shapes[SHAPE_IDX_COUNT];
   HlAttrs clear_attrs;
   kvec_t(HlAttrs) attrs;
   HlAttrs print_attrs;
+  int print_attr_id;  // highlight id of print_attrs, or -1
   bool default_attr;
   ModeShape showing_mode;
   struct {
@@ -116,6 +136,7 @@ typedef struct {
     int resize_screen;
     int reset_scroll_region;
     int set_cursor_style, reset_cursor_style;
+    int sync;
   } unibi_ext;
 } TUIData;
 
@@ -180,7 +201,9 @@ static void terminfo_start(UI *ui)
 {
   TUIData *data = ui->data;
   data->scroll_region_is_full_screen = true;
+  data->buf = data->bufs[0];
   data->bufpos = 0;
+  data->writing = false;
   data->default_attr = false;
   data->is_invisible = true;
   data->busy = false;
@@ -200,6 +223,7 @@ static void terminfo_start(UI *ui)
   data->unibi_ext.reset_scroll_region = -1;
   data->unibi_ext.set_cursor_style = -1;
   data->unibi_ext.reset_cursor_style = -1;
+  data->unibi_ext.sync = -1;
   data->out_fd = 1;
   data->out_isatty = os_isatty(data->out_fd);
 
@@ -243,6 +267,12 @@ static void terminfo_start(UI *ui)
                                     data->norm, sizeof data->norm);
   data->invislen = unibi_pre_fmt_str(data, unibi_cursor_invisible,
                                      data->invis, sizeof data->invis);
+  data->cost.cr = cap_cost(data, unibi_carriage_return, 0, 0);
+  data->cost.home = cap_cost(data, unibi_cursor_home, 0, 0);
+  data->cost.cuf1 = cap_cost(data, unibi_cursor_right, 0, 0);
+  data->cost.cub1 = cap_cost(data, unibi_cursor_left, 0, 0);
+  data->cost.cud1 = cap_cost(data, unibi_cursor_down, 0, 0);
+  data->cost.cuu1 = cap_cost(data, unibi_cursor_up, 0, 0);
   // Set 't_Co' from the result of unibilium & fix_terminfo.
   t_colors = unibi_get_num(data->ut, unibi_max_colors);
   // Enter alternate screen and clear
@@ -296,7 +326,11 @@ static void tui_terminal_start(UI *ui)
 {
   TUIData *data = ui->data;
   data->print_attrs = HLATTRS_INVALID;
+  data->print_attr_id = -1;
   ugrid_init(&data->grid);
+  ugrid_init(&data->frame);
+  kv_size(data->scrolls) = 0;
+  data->clear_pending = false;
   terminfo_start(ui);
   update_size(ui);
   signal_watcher_start(&data->winch_handle, sigwinch_cb, SIGWINCH);
@@ -320,6 +354,7 @@ static void tui_terminal_stop(UI *ui)
   signal_watcher_stop(&data->winch_handle);
   terminfo_stop(ui);
   ugrid_free(&data->grid);
+  ugrid_free(&data->frame);
 }
 
 static void tui_stop(UI *ui)
@@ -344,7 +379,7 @@ static void tui_main(UIBridgeData *bridge, UI *ui)
   ui->data = data;
   data->bridge = bridge;
   data->loop = &tui_loop;
-  kv_init(data->invalid_regions);
+  kv_init(data->scrolls);
   signal_watcher_init(data->loop, &data->winch_handle, ui);
   signal_watcher_init(data->loop, &data->cont_handle, data);
 #ifdef UNIX
@@ -368,6 +403,7 @@ static void tui_main(UIBridgeData *bridge, UI *ui)
 
   // "Active" loop: first ~100 ms of startup.
   for (size_t ms = 0; ms < 100 && !tui_is_stopped(ui);) {
+    wait_for_write(data);
     ms += (loop_poll_events(&tui_loop, 20) ? 20 : 1);
   }
   if (!tui_is_stopped(ui)) {
@@ -378,6 +414,7 @@ static void tui_main(UIBridgeData *bridge, UI *ui)
   }
   // "Passive" (I/O-driven) loop: TUI thread "main loop".
   while (!tui_is_stopped(ui)) {
+    wait_for_write(data);
     loop_poll_events(&tui_loop, -1);  // tui_loop.events is never processed
   }
 
@@ -387,7 +424,7 @@ static void tui_main(UIBridgeData *bridge, UI *ui)
   signal_watcher_close(&data->cont_handle, NULL);
   signal_watcher_close(&data->winch_handle, NULL);
   loop_close(&tui_loop, false);
-  kv_destroy(data->invalid_regions);
+  kv_destroy(data->scrolls);
   kv_destroy(data->attrs);
   xfree(data);
 }
@@ -447,6 +484,7 @@ static bool no_bg(UI *ui, HlAttrs attrs)
 static void update_attrs(UI *ui, HlAttrs attrs)
 {
   TUIData *data = ui->data;
+  data->print_attr_id = -1;
 
   if (!attrs_differ(attrs, data->print_attrs, ui->rgb)) {
     return;
@@ -561,8 +599,10 @@ static void print_cell(UI *ui, UCell *ptr)
     // Printing the next character finally advances the cursor.
     final_column_wrap(ui);
   }
-  update_attrs(ui, ptr->attrs);
-  out(ui, ptr->data, strlen(ptr->data));
+  update_attr_id(ui, ptr->attr);
+  size_t len;
+  const char *text = ugrid_text(ptr, &len);
+  out(ui, text, len);
   grid->col++;
   if (data->immediate_wrap_after_last_column) {
     // Printing at the right margin immediately advances the cursor.
@@ -570,6 +610,41 @@ static void print_cell(UI *ui, UCell *ptr)
   }
 }
 
+/// Like update_attrs(), for highlight id `attr` of the UI events. Needs only an
+/// integer compare if the attributes are current.
+static void update_attr_id(UI *ui, sattr_T attr)
+{
+  TUIData *data = ui->data;
+  if (attr != data->print_attr_id) {
+    update_attrs(ui, kv_A(data->attrs, (size_t)attr));
+    data->print_attr_id = attr;
+  }
+}
+
+/// Cell text is a single ASCII char.
+static bool cell_is_ascii(const UCell *cell)
+{
+  return cell->text[0] > 0 && cell->text[0] < 0x7f && cell->text[1] == NUL;
+}
+
+/// Returns the number of bytes of terminfo string `unibi_index` with
+/// parameters `p1` and `p2`, or COST_INF if the terminal lacks it.
+static int cap_cost(TUIData *data, unsigned int unibi_index, int p1, int p2)
+{
+  const char *str = unibi_get_str(data->ut, unibi_index);
+  if (!str || !*str) {
+    return COST_INF;
+  }
+  unibi_var_t params[9];
+  memset(params, 0, sizeof(params));
+  UNIBI_SET_NUM_VAR(params[0], p1);
+  UNIBI_SET_NUM_VAR(params[1], p2);
+  char buf[64];
+  return (int)unibi_run(str, params, buf, sizeof(buf));
+}
+
+/// Whether the cells can be printed again to move the cursor over them,
+/// without changing attributes.
 static bool cheap_to_print(UI *ui, int row, int col, int next)
 {
   TUIData *data = ui->data;
@@ -577,12 +652,8 @@ static bool cheap_to_print(UI *ui, int row, int col, int next)
   UCell *cell = grid->cells[row] + col;
   while (next) {
     next--;
-    if (attrs_differ(cell->attrs, data->print_attrs, ui->rgb)) {
-      if (data->default_attr) {
-        return false;
-      }
-    }
-    if (strlen(cell->data) > 1) {
+    if (cell_invalid(cell) || cell->attr != data->print_attr_id
+        || !cell_is_ascii(cell)) {
       return false;
     }
     cell++;
@@ -590,9 +661,78 @@ static bool cheap_to_print(UI *ui, int row, int col, int next)
   return true;
 }
 
-/// This optimizes several cases where it is cheaper to do something other
-/// than send a full cursor positioning control sequence.  However, there are
-/// some further optimizations that may seem obvious but that will not work.
+typedef enum {
+  kMoveNone,
+  kMoveStep,   ///< repeated cuf1/cub1/cud1/cuu1
+  kMoveParm,   ///< cuf/cub/cud/cuu
+  kMoveAbs,    ///< hpa/vpa
+  kMovePrint,  ///< print the cells in between (forward only)
+} MoveKind;
+
+/// Finds the cheapest way to move the cursor by `n` rows or columns.
+///
+/// @param step  Cost of the single step capability.
+/// @param parm  Parameterized capability, moving by `abs(n)`.
+/// @param abs_index  Absolute address capability, or -1.
+/// @param to  Target row or column, parameter of `abs_index`.
+/// @param print  Printing the cells in between is possible, for `n` > 0.
+static int motion_cost(TUIData *data, int n, int step, unsigned int parm,
+                       int abs_index, int to, bool print, MoveKind *kind)
+{
+  *kind = kMoveNone;
+  if (n == 0) {
+    return 0;
+  }
+  int count = n > 0 ? n : -n;
+  int best = step < COST_INF ? step * count : COST_INF;
+  *kind = kMoveStep;
+  int cost = cap_cost(data, parm, count, 0);
+  if (cost < best) {
+    best = cost;
+    *kind = kMoveParm;
+  }
+  if (abs_index >= 0) {
+    cost = cap_cost(data, (unsigned int)abs_index, to, 0);
+    if (cost < best) {
+      best = cost;
+      *kind = kMoveAbs;
+    }
+  }
+  if (print && n > 0 && count < best) {
+    best = count;
+    *kind = kMovePrint;
+  }
+  return best;
+}
+
+static void do_motion(UI *ui, MoveKind kind, int n, unsigned int step,
+                      unsigned int parm, int abs_index, int to)
+{
+  TUIData *data = ui->data;
+  switch (kind) {
+    case kMoveNone:
+    case kMovePrint:
+      break;
+    case kMoveStep:
+      for (int i = n > 0 ? n : -n; i > 0; i--) {
+        unibi_out(ui, (int)step);
+      }
+      break;
+    case kMoveParm:
+      UNIBI_SET_NUM_VAR(data->params[0], n > 0 ? n : -n);
+      unibi_out(ui, (int)parm);
+      break;
+    case kMoveAbs:
+      UNIBI_SET_NUM_VAR(data->params[0], to);
+      unibi_out(ui, abs_index);
+      break;
+  }
+}
+
+/// Moves the cursor with the fewest bytes. The terminfo strings of the
+/// candidates are measured by cap_cost(): absolute positioning (cup, home),
+/// carriage return, relative (cuf1, cuf, ...) and column/row addressing (hpa,
+/// vpa), or printing the cells in between again.
 ///
 /// We cannot use VT (ASCII 0/11) for moving the cursor up, because VT means
 /// move the cursor down on a DEC terminal.  Similarly, on a DEC terminal FF
@@ -606,149 +746,88 @@ static void cursor_goto(UI *ui, int row, int col)
   if (row == grid->row && col == grid->col) {
     return;
   }
-  if (0 == row && 0 == col) {
-    unibi_out(ui, unibi_cursor_home);
-    ugrid_goto(grid, row, col);
-    return;
-  }
-  if (0 == col ? col != grid->col :
-      row != grid->row ? false :
-      1 == col ? 2 < grid->col && cheap_to_print(ui, grid->row, 0, col) :
-      2 == col ? 5 < grid->col && cheap_to_print(ui, grid->row, 0, col) :
-      false) {
-    // Motion to left margin from anywhere else, or CR + printing chars is
-    // even less expensive than using BSes or CUB.
-    unibi_out(ui, unibi_carriage_return);
-    ugrid_goto(grid, grid->row, 0);
-  } else if (col > grid->col) {
-      int n = col - grid->col;
-      if (n <= (row == grid->row ? 4 : 2)
-          && cheap_to_print(ui, grid->row, grid->col, n)) {
-        UGRID_FOREACH_CELL(grid, grid->row, grid->row, grid->col, col - 1, {
-          print_cell(ui, cell);
-        });
-      }
-  }
-  if (row == grid->row) {
-    if (col < grid->col
-        // Deferred right margin wrap terminals have inconsistent ideas about
-        // where the cursor actually is during a deferred wrap.  Relative
-        // motion calculations have OBOEs that cannot be compensated for,
-        // because two terminals that claim to be the same will implement
-        // different cursor positioning rules.
-        && (data->immediate_wrap_after_last_column || grid->col < ui->width)) {
-      int n = grid->col - col;
-      if (n <= 4) {  // This might be just BS, so it is considered really cheap.
-        while (n--) {
-          unibi_out(ui, unibi_cursor_left);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_left_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    } else if (col > grid->col) {
-      int n = col - grid->col;
-      if (n <= 2) {
-        while (n--) {
-          unibi_out(ui, unibi_cursor_right);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_right_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
+
+  int best = cap_cost(data, unibi_cursor_address, row, col);
+  bool home = false;
+  if (0 == row && 0 == col && data->cost.home <= best) {
+    best = data->cost.home;
+    home = true;
+  }
+
+  // Relative motion: optional carriage return, then vertical and horizontal
+  // motion.
+  bool relative = false, cr = false;
+  MoveKind vkind = kMoveNone, hkind = kMoveNone;
+  int dy = row - grid->row;
+  bool down = dy > 0;
+  int vcost = motion_cost(data, dy, down ? data->cost.cud1 : data->cost.cuu1,
+                          down ? unibi_parm_down_cursor
+                               : unibi_parm_up_cursor,
+                          unibi_row_address, row, false, &vkind);
+
+  // Deferred right margin wrap terminals have inconsistent ideas about where
+  // the cursor actually is during a deferred wrap.  Relative motion
+  // calculations have OBOEs that cannot be compensated for, because two
+  // terminals that claim to be the same will implement different cursor
+  // positioning rules.  Only a carriage return is safe then.
+  if (data->immediate_wrap_after_last_column || grid->col < ui->width) {
+    int dx = col - grid->col;
+    bool right = dx > 0;
+    MoveKind kind;
+    int cost = vcost
+      + motion_cost(data, dx, right ? data->cost.cuf1 : data->cost.cub1,
+                    right ? unibi_parm_right_cursor : unibi_parm_left_cursor,
+                    unibi_column_address, col,
+                    right && cheap_to_print(ui, row, grid->col, dx), &kind);
+    if (cost < best) {
+      best = cost;
+      relative = true;
+      hkind = kind;
     }
   }
-  if (col == grid->col) {
-    if (row > grid->row) {
-      int n = row - grid->row;
-      if (n <= 4) {  // This might be just LF, so it is considered really cheap.
-        while (n--) {
-          unibi_out(ui, unibi_cursor_down);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_down_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    } else if (row < grid->row) {
-      int n = grid->row - row;
-      if (n <= 2) {
-        while (n--) {
-          unibi_out(ui, unibi_cursor_up);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_up_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
+  if (data->cost.cr < best) {
+    MoveKind kind;
+    int cost = data->cost.cr + vcost
+      + motion_cost(data, col, data->cost.cuf1, unibi_parm_right_cursor,
+                    unibi_column_address, col,
+                    cheap_to_print(ui, row, 0, col), &kind);
+    if (cost < best) {
+      best = cost;
+      relative = cr = true;
+      hkind = kind;
     }
   }
-  unibi_goto(ui, row, col);
-  ugrid_goto(grid, row, col);
-}
 
-static void clear_region(UI *ui, int top, int bot, int left, int right,
-                         HlAttrs attrs)
-{
-  TUIData *data = ui->data;
-  UGrid *grid = &data->grid;
-
-  bool cleared = false;
-
-  // non-BCE terminals can't clear with non-default background color
-  bool can_clear = data->bce || no_bg(ui, attrs);
-
-  if (can_clear && right == ui->width -1) {
-    // Background is set to the default color and the right edge matches the
-    // screen end, try to use terminal codes for clearing the requested area.
-    update_attrs(ui, attrs);
-    if (left == 0) {
-      if (bot == ui->height - 1) {
-        if (top == 0) {
-          unibi_out(ui, unibi_clear_screen);
-          ugrid_goto(&data->grid, top, left);
-        } else {
-          cursor_goto(ui, top, 0);
-          unibi_out(ui, unibi_clr_eos);
-        }
-        cleared = true;
-      }
-    }
-
-    if (!cleared) {
-      // iterate through each line and clear with clr_eol
-      for (int row = top; row <= bot; row++) {
-        cursor_goto(ui, row, left);
-        unibi_out(ui, unibi_clr_eol);
-      }
-      cleared = true;
+  if (!relative) {
+    if (home) {
+      unibi_out(ui, unibi_cursor_home);
+    } else {
+      unibi_goto(ui, row, col);
     }
+    ugrid_goto(grid, row, col);
+    return;
   }
 
-  if (!cleared) {
-    // could not clear using faster terminal codes, refresh the whole region
-    UGRID_FOREACH_CELL(grid, top, bot, left, right, {
-      cursor_goto(ui, row, col);
+  if (cr) {
+    unibi_out(ui, unibi_carriage_return);
+    ugrid_goto(grid, grid->row, 0);
+  }
+  do_motion(ui, vkind, dy, down ? unibi_cursor_down : unibi_cursor_up,
+            down ? unibi_parm_down_cursor : unibi_parm_up_cursor,
+            unibi_row_address, row);
+  ugrid_goto(grid, row, grid->col);
+  int dx = col - grid->col;
+  if (hkind == kMovePrint) {
+    UGRID_FOREACH_CELL(grid, row, row, grid->col, col - 1, {
       print_cell(ui, cell);
     });
-
-    if (data->did_resize && top == 0) {
-      // TODO(bfredl): the first line of the screen doesn't gets properly
-      // cleared after resize by the loop above, so redraw the final state
-      // after the next flush.
-      invalidate(ui, 0, bot, left, right);
-      data->did_resize = false;
-    }
+  } else {
+    do_motion(ui, hkind, dx,
+              dx > 0 ? unibi_cursor_right : unibi_cursor_left,
+              dx > 0 ? unibi_parm_right_cursor : unibi_parm_left_cursor,
+              unibi_column_address, col);
   }
-
-  // restore cursor
-  cursor_goto(ui, data->row, data->col);
+  ugrid_goto(grid, row, col);
 }
 
 static bool can_use_scroll(UI * ui)
@@ -818,17 +897,11 @@ static void reset_scroll_region(UI *ui)
 static void tui_grid_resize(UI *ui, Integer g, Integer width, Integer height)
 {
   TUIData *data = ui->data;
-  UGrid *grid = &data->grid;
-  ugrid_resize(grid, (int)width, (int)height);
-  data->did_resize = true;
-
-  // resize might not always be followed by a clear before flush
-  // so clip the invalid region
-  for (size_t i = 0; i < kv_size(data->invalid_regions); i++) {
-    Rect *r = &kv_A(data->invalid_regions, i);
-    r->bot = MIN(r->bot, grid->height-1);
-    r->right = MIN(r->right, grid->width-1);
-  }
+  ugrid_resize(&data->frame, (int)width, (int)height);
+  // The terminal contents are unknown after a resize, draw everything.
+  ugrid_resize(&data->grid, (int)width, (int)height);
+  invalidate(ui, 0, (int)height - 1, 0, (int)width - 1);
+  kv_size(data->scrolls) = 0;
 
   if (!got_winch) {  // Try to resize the terminal window.
     UNIBI_SET_NUM_VAR(data->params[0], (int)height);
@@ -846,11 +919,9 @@ static void tui_grid_resize(UI *ui, Integer g, Integer width, Integer height)
 static void tui_grid_clear(UI *ui, Integer g)
 {
   TUIData *data = ui->data;
-  UGrid *grid = &data->grid;
-  ugrid_clear(grid);
-  kv_size(data->invalid_regions) = 0;
-  clear_region(ui, 0, grid->height-1, 0, grid->width-1,
-               data->clear_attrs);
+  ugrid_clear(&data->frame);
+  data->clear_pending = true;
+  kv_size(data->scrolls) = 0;
 }
 
 static void tui_grid_cursor_goto(UI *ui, Integer grid, Integer row, Integer col)
@@ -858,7 +929,6 @@ static void tui_grid_cursor_goto(UI *ui, Integer grid, Integer row, Integer col)
   TUIData *data = ui->data;
   data->row = (int)row;
   data->col = (int)col;
-  cursor_goto(ui, (int)row, (int)col);
 }
 
 CursorShape tui_cursor_decode_shape(const char *shape_str)
@@ -989,64 +1059,49 @@ static void tui_grid_scroll(UI *ui, Integer g, Integer top, Integer bot,
                             Integer rows, Integer cols)
 {
   TUIData *data = ui->data;
-  UGrid *grid = &data->grid;
-  ugrid_set_scroll_region(&data->grid, (int)top, (int)bot-1,
+  UGrid *grid = &data->frame;
+  ugrid_set_scroll_region(grid, (int)top, (int)bot-1,
                           (int)left, (int)right-1);
-
-  data->scroll_region_is_full_screen =
-    left == 0 && right == ui->width
-    && top == 0 && bot == ui->height;
-
   int clear_top, clear_bot;
   ugrid_scroll(grid, (int)rows, &clear_top, &clear_bot);
 
-  if (can_use_scroll(ui)) {
-    // Change terminal scroll region and move cursor to the top
-    if (!data->scroll_region_is_full_screen) {
-      set_scroll_region(ui);
-    }
-    cursor_goto(ui, grid->top, grid->left);
-    // also set default color attributes or some terminals can become funny
-    update_attrs(ui, data->clear_attrs);
-
-    if (rows > 0) {
-      if (rows == 1) {
-        unibi_out(ui, unibi_delete_line);
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], (int)rows);
-        unibi_out(ui, unibi_parm_delete_line);
-      }
-    } else {
-      if (rows == -1) {
-        unibi_out(ui, unibi_insert_line);
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], -(int)rows);
-        unibi_out(ui, unibi_parm_insert_line);
+  // Consecutive scrolls of the same region are done as one on the terminal,
+  // the cells in between are fixed up by draw_frame().
+  Rect region = { grid->top, grid->bot, grid->left, grid->right };
+  if (kv_size(data->scrolls)) {
+    Scroll *last = &kv_last(data->scrolls);
+    if (!memcmp(&last->region, &region, sizeof(region))) {
+      last->rows += (int)rows;
+      int height = region.bot - region.top + 1;
+      if (last->rows == 0 || last->rows >= height || -last->rows >= height) {
+        // Nothing is left to move, just redraw the region.
+        (void)kv_pop(data->scrolls);
       }
+      return;
     }
-
-    // Restore terminal scroll region and cursor
-    if (!data->scroll_region_is_full_screen) {
-      reset_scroll_region(ui);
-    }
-    cursor_goto(ui, data->row, data->col);
-
-    if (!(data->bce || no_bg(ui, data->clear_attrs))) {
-      // Scrolling will leave wrong background in the cleared area on non-BCE
-      // terminals. Update the cleared area.
-      clear_region(ui, clear_top, clear_bot, grid->left, grid->right,
-                   data->clear_attrs);
-    }
-  } else {
-    // Mark the entire scroll region as invalid for redrawing later
-    invalidate(ui, grid->top, grid->bot, grid->left, grid->right);
   }
+  kv_push(data->scrolls, ((Scroll) { region, (int)rows }));
 }
 
 static void tui_hl_attr_define(UI *ui, Integer id, HlAttrs attrs,
                                HlAttrs cterm_attrs, Array info)
 {
   TUIData *data = ui->data;
+  if ((size_t)id < kv_size(data->attrs)) {
+    HlAttrs old = kv_A(data->attrs, (size_t)id);
+    if (attrs_differ(old, attrs, true) || attrs_differ(old, attrs, false)) {
+      // The id is redefined, cells drawn with it must be drawn again.
+      UGrid *grid = &data->grid;
+      UGRID_FOREACH_CELL(grid, 0, grid->height - 1, 0, grid->width - 1, {
+        if (cell->attr == id) {
+          cell->attr = -1;
+        }
+      });
+      if (data->print_attr_id == id) {
+        data->print_attr_id = -1;
+      }
+    }
+  }
   kv_a(data->attrs, (size_t)id) = attrs;
 }
 
@@ -1073,40 +1128,247 @@ static void tui_default_colors_set(UI *ui, Integer rgb_fg, Integer rgb_bg,
   data->clear_attrs.cterm_bg_color = (int)cterm_bg;
 
   data->print_attrs = HLATTRS_INVALID;
+  data->print_attr_id = -1;
   invalidate(ui, 0, data->grid.height-1, 0, data->grid.width-1);
 }
 
 static void tui_flush(UI *ui)
+{
+  TUIData *data = ui->data;
+  // Back-pressure: UI events may accumulate much faster than the terminal
+  // device can serve them. Events only update `frame`, so instead of drawing
+  // every flush the frame is drawn after the queued events were applied, or
+  // at most every FRAME_MAX_DELAY. Nothing is lost. #1234 #5396
+  if (os_hrtime() - data->last_frame >= FRAME_MAX_DELAY) {
+    draw_frame(ui);
+  } else if (!data->frame_scheduled) {
+    data->frame_scheduled = true;
+    loop_schedule(data->loop, event_create(tui_frame_event, 1, ui));
+  }
+}
+
+static void tui_frame_event(void **argv)
+{
+  UI *ui = argv[0];
+  if (tui_is_stopped(ui)) {
+    return;
+  }
+  TUIData *data = ui->data;
+  data->frame_scheduled = false;
+  draw_frame(ui);
+}
+
+/// Updates the terminal to show `frame`, with the least output for the
+/// difference to the last frame.
+static void draw_frame(UI *ui)
 {
   TUIData *data = ui->data;
   UGrid *grid = &data->grid;
+  data->last_frame = os_hrtime();
+
+  // Begin synchronized update: the terminal shows the frame only when it is
+  // complete, even if it is written in several parts.
+  UNIBI_SET_NUM_VAR(data->params[0], 1);
+  unibi_out_ext(ui, data->unibi_ext.sync);
+
+  if (data->clear_pending) {
+    data->clear_pending = false;
+    // non-BCE terminals can't clear with non-default background color
+    if (data->bce || no_bg(ui, data->clear_attrs)) {
+      update_attrs(ui, data->clear_attrs);
+      unibi_out(ui, unibi_clear_screen);
+      ugrid_goto(grid, 0, 0);
+      ugrid_clear(grid);
+    }
+  }
 
-  size_t nrevents = loop_size(data->loop);
-  if (nrevents > TOO_MANY_EVENTS) {
-    WLOG("TUI event-queue flooded (thread_events=%zu); purging", nrevents);
-    // Back-pressure: UI events may accumulate much faster than the terminal
-    // device can serve them. Even if SIGINT/CTRL-C is received, user must still
-    // wait for the TUI event-queue to drain, and if there are ~millions of
-    // events in the queue, it could take hours. Clearing the queue allows the
-    // UI to recover. #1234 #5396
-    loop_purge(data->loop);
-    tui_busy_stop(ui);  // avoid hidden cursor
-  }
-
-  while (kv_size(data->invalid_regions)) {
-    Rect r = kv_pop(data->invalid_regions);
-    assert(r.bot < grid->height && r.right < grid->width);
-    UGRID_FOREACH_CELL(grid, r.top, r.bot, r.left, r.right, {
-      cursor_goto(ui, row, col);
-      print_cell(ui, cell);
-    });
+  for (size_t i = 0; i < kv_size(data->scrolls); i++) {
+    Scroll *scroll = &kv_A(data->scrolls, i);
+    draw_scroll(ui, scroll->region, scroll->rows);
+  }
+  kv_size(data->scrolls) = 0;
+
+  assert(grid->height == data->frame.height
+         && grid->width == data->frame.width);
+  for (int row = 0; row < grid->height; row++) {
+    draw_line(ui, row);
   }
 
   cursor_goto(ui, data->row, data->col);
 
+  UNIBI_SET_NUM_VAR(data->params[0], 2);
+  unibi_out_ext(ui, data->unibi_ext.sync);
+
   flush_buf(ui);
 }
 
+/// Scrolls a region of the terminal, if the terminal can do it. The moved
+/// cells need not be redrawn then.
+static void draw_scroll(UI *ui, Rect region, int rows)
+{
+  TUIData *data = ui->data;
+  UGrid *grid = &data->grid;
+  ugrid_set_scroll_region(grid, region.top, region.bot,
+                          region.left, region.right);
+
+  data->scroll_region_is_full_screen =
+    region.left == 0 && region.right == ui->width - 1
+    && region.top == 0 && region.bot == ui->height - 1;
+
+  if (!can_use_scroll(ui)) {
+    return;  // The region is redrawn by draw_line().
+  }
+
+  int clear_top, clear_bot;
+  ugrid_scroll(grid, rows, &clear_top, &clear_bot);
+
+  // Change terminal scroll region and move cursor to the top
+  if (!data->scroll_region_is_full_screen) {
+    set_scroll_region(ui);
+  }
+  cursor_goto(ui, grid->top, grid->left);
+  // also set default color attributes or some terminals can become funny
+  update_attrs(ui, data->clear_attrs);
+
+  if (rows > 0) {
+    if (rows == 1) {
+      unibi_out(ui, unibi_delete_line);
+    } else {
+      UNIBI_SET_NUM_VAR(data->params[0], rows);
+      unibi_out(ui, unibi_parm_delete_line);
+    }
+  } else {
+    if (rows == -1) {
+      unibi_out(ui, unibi_insert_line);
+    } else {
+      UNIBI_SET_NUM_VAR(data->params[0], -rows);
+      unibi_out(ui, unibi_parm_insert_line);
+    }
+  }
+
+  // Restore terminal scroll region
+  if (!data->scroll_region_is_full_screen) {
+    reset_scroll_region(ui);
+  }
+
+  if (!(data->bce || no_bg(ui, data->clear_attrs))) {
+    // Scrolling leaves the wrong background in the cleared area on non-BCE
+    // terminals.
+    invalidate(ui, clear_top, clear_bot, grid->left, grid->right);
+  }
+}
+
+static bool cell_differs(const UCell *a, const UCell *b)
+{
+  return a->attr != b->attr || memcmp(a->text, b->text, UCELL_INLINE);
+}
+
+/// A cell that the terminal can produce by clearing.
+static bool cell_is_clear(const UCell *cell)
+{
+  return cell->attr == 0 && cell->text[0] == ' ' && cell->text[1] == NUL;
+}
+
+/// Outputs cells of `row` starting at `col` (the cursor position), before
+/// `end`. A run of identical cells is done with "rep", or "ech" for cleared
+/// cells, when that is shorter than printing them.
+///
+/// @return number of cells done.
+static int draw_cells(UI *ui, int row, int col, int end)
+{
+  TUIData *data = ui->data;
+  UGrid *grid = &data->grid;
+  UCell *want = data->frame.cells[row];
+  UCell *have = grid->cells[row];
+
+  int n = 1;
+  if (cell_is_ascii(&want[col])) {
+    while (col + n < end && !cell_differs(&want[col], &want[col + n])) {
+      n++;
+    }
+  }
+  // Avoid the right margin, where terminals disagree about the cursor.
+  if (n > 2 && col + n < grid->width) {
+    int print_cost = n;
+    if (cell_is_clear(&want[col])
+        && (data->bce || no_bg(ui, data->clear_attrs))) {
+      MoveKind kind;
+      int cost = cap_cost(data, unibi_erase_chars, n, 0)
+        + motion_cost(data, n, data->cost.cuf1, unibi_parm_right_cursor,
+                      unibi_column_address, col + n, false, &kind);
+      if (cost < print_cost) {
+        update_attrs(ui, data->clear_attrs);
+        UNIBI_SET_NUM_VAR(data->params[0], n);
+        unibi_out(ui, unibi_erase_chars);
+        memcpy(&have[col], &want[col], (size_t)n * sizeof(UCell));
+        return n;  // The cursor stays, the caller moves it.
+      }
+    }
+    if (cap_cost(data, unibi_repeat_char, want[col].text[0], n)
+        < print_cost) {
+      update_attr_id(ui, want[col].attr);
+      UNIBI_SET_NUM_VAR(data->params[0], want[col].text[0]);
+      UNIBI_SET_NUM_VAR(data->params[1], n);
+      unibi_out(ui, unibi_repeat_char);
+      memcpy(&have[col], &want[col], (size_t)n * sizeof(UCell));
+      ugrid_goto(grid, row, col + n);
+      return n;
+    }
+  }
+
+  have[col] = want[col];
+  print_cell(ui, &have[col]);
+  return 1;
+}
+
+/// Prints the cells of `row` that differ from the terminal.
+static void draw_line(UI *ui, int row)
+{
+  TUIData *data = ui->data;
+  UGrid *grid = &data->grid;
+  UCell *want = data->frame.cells[row];
+  UCell *have = grid->cells[row];
+  int width = grid->width;
+
+  // Trailing cleared cells are done with a single clr_eol.
+  int clear_col = width;
+  if (data->bce || no_bg(ui, data->clear_attrs)) {
+    while (clear_col > 0 && cell_is_clear(&want[clear_col - 1])) {
+      clear_col--;
+    }
+  }
+
+  int col = 0;
+  while (col < clear_col) {
+    if (!cell_differs(&want[col], &have[col])) {
+      col++;
+      continue;
+    }
+    int start = col;
+    if (start > 0 && want[start].text[0] == NUL) {
+      start--;  // right half of a double-width char
+    }
+    while (col < clear_col && cell_differs(&want[col], &have[col])) {
+      col++;
+    }
+    for (int c = start; c < col;) {
+      cursor_goto(ui, row, c);
+      c += draw_cells(ui, row, c, col);
+    }
+  }
+
+  for (col = clear_col; col < width; col++) {
+    if (cell_differs(&want[col], &have[col])) {
+      update_attrs(ui, data->clear_attrs);
+      cursor_goto(ui, row, clear_col);
+      unibi_out(ui, unibi_clr_eol);
+      memcpy(&have[clear_col], &want[clear_col],
+             (size_t)(width - clear_col) * sizeof(UCell));
+      break;
+    }
+  }
+}
+
 /// Dumps termcap info to the messages area, if 'verbose' >= 3.
 static void show_termcap_event(void **argv)
 {
@@ -1185,6 +1447,7 @@ static void tui_option_set(UI *ui, String name, Object value)
     ui->rgb = value.data.boolean;
 
     data->print_attrs = HLATTRS_INVALID;
+    data->print_attr_id = -1;
     invalidate(ui, 0, data->grid.height-1, 0, data->grid.width-1);
   }
 }
@@ -1194,62 +1457,32 @@ static void tui_raw_line(UI *ui, Integer g, Integer linerow, Integer startcol,
                          const schar_T *chunk, const sattr_T *attrs)
 {
   TUIData *data = ui->data;
-  UGrid *grid = &data->grid;
+  UGrid *grid = &data->frame;
+  UCell *cells = grid->cells[linerow];
   for (Integer c = startcol; c < endcol; c++) {
-    memcpy(grid->cells[linerow][c].data, chunk[c-startcol], sizeof(schar_T));
-    grid->cells[linerow][c].attrs = kv_A(data->attrs, attrs[c-startcol]);
+    ugrid_set_text(&cells[c], (const char *)chunk[c-startcol]);
+    cells[c].attr = attrs[c-startcol];
   }
-  UGRID_FOREACH_CELL(grid, (int)linerow, (int)linerow, (int)startcol,
-                     (int)endcol-1, {
-    cursor_goto(ui, row, col);
-    print_cell(ui, cell);
-  });
 
   if (clearcol > endcol) {
-    HlAttrs cl_attrs = kv_A(data->attrs, (size_t)clearattr);
     ugrid_clear_chunk(grid, (int)linerow, (int)endcol, (int)clearcol,
-                      cl_attrs);
-    clear_region(ui, (int)linerow, (int)linerow, (int)endcol, (int)clearcol-1,
-                 cl_attrs);
+                      (sattr_T)clearattr);
   }
 }
 
+/// Forgets what the terminal shows in a region, so that the next frame draws
+/// it.
 static void invalidate(UI *ui, int top, int bot, int left, int right)
 {
   TUIData *data = ui->data;
-  Rect *intersects = NULL;
-  // Increase dimensions before comparing to ensure adjacent regions are
-  // treated as intersecting
-  --top;
-  ++bot;
-  --left;
-  ++right;
-
-  for (size_t i = 0; i < kv_size(data->invalid_regions); i++) {
-    Rect *r = &kv_A(data->invalid_regions, i);
-    if (!(top > r->bot || bot < r->top
-          || left > r->right || right < r->left)) {
-      intersects = r;
-      break;
-    }
-  }
-
-  ++top;
-  --bot;
-  ++left;
-  --right;
+  UGRID_FOREACH_CELL(&data->grid, top, bot, left, right, {
+    cell->attr = -1;
+  });
+}
 
-  if (intersects) {
-    // If top/bot/left/right intersects with a invalid rect, we replace it
-    // by the union
-    intersects->top = MIN(top, intersects->top);
-    intersects->bot = MAX(bot, intersects->bot);
-    intersects->left = MIN(left, intersects->left);
-    intersects->right = MAX(right, intersects->right);
-  } else {
-    // Else just add a new entry;
-    kv_push(data->invalid_regions, ((Rect) { top, bot, left, right }));
-  }
+static bool cell_invalid(const UCell *cell)
+{
+  return cell->attr < 0;
 }
 
 static void update_size(UI *ui)
@@ -1342,7 +1575,7 @@ static void out(void *ctx, const char *str, size_t len)
 {
   UI *ui = ctx;
   TUIData *data = ui->data;
-  size_t available = sizeof(data->buf) - data->bufpos;
+  size_t available = OUTBUF_SIZE - data->bufpos;
 
   if (data->cork && data->overflow) {
     return;
@@ -1682,8 +1915,13 @@ static void augment_terminfo(TUIData *data, const char *term,
     || terminfo_is_term_family(term, "iterm2")
     || terminfo_is_term_family(term, "iTerm.app")
     || terminfo_is_term_family(term, "iTerm2.app");
+  bool foot = terminfo_is_term_family(term, "foot");
+  bool contour = terminfo_is_term_family(term, "contour");
+  bool kitty = terminfo_is_term_family(term, "xterm-kitty");
   // None of the following work over SSH; see :help TERM .
   bool iterm_pretending_xterm = xterm && iterm_env;
+  const char *termprg = os_getenv("TERM_PROGRAM");
+  bool wezterm = termprg && strstr(termprg, "WezTerm");
 
   const char * xterm_version = os_getenv("XTERM_VERSION");
   bool true_xterm = xterm && !!xterm_version;
@@ -1756,6 +1994,14 @@ static void augment_terminfo(TUIData *data, const char *term,
         ut, NULL, "\033]12;#%p1%06x\007");
   }
 
+  // Synchronized output (DEC private mode 2026), "Sync" as defined by tmux.
+  data->unibi_ext.sync = unibi_find_ext_str(ut, "Sync");
+  if (-1 == data->unibi_ext.sync && !tmux && !screen
+      && (foot || contour || kitty || wezterm)) {
+    data->unibi_ext.sync = (int)unibi_add_ext_str(ut, "Sync",
+      "\x1b[?2026%?%p1%{1}%-%tl%eh%;");
+  }
+
   /// Terminals usually ignore unrecognized private modes, and there is no
   /// known ambiguity with these. So we just set them unconditionally.
   data->unibi_ext.enable_lr_margin = (int)unibi_add_ext_str(
@@ -1779,9 +2025,12 @@ static void augment_terminfo(TUIData *data, const char *term,
       ut, "ext.disable_mouse", "\x1b[?1002l\x1b[?1006l");
 }
 
+/// Starts writing the output buffer to the terminal. While the terminal takes
+/// the data further output goes to the other buffer; this only waits if the
+/// previous write is still in progress. The write is completed by the next
+/// flush_buf() or by wait_for_write() before the TUI loop waits for events.
 static void flush_buf(UI *ui)
 {
-  uv_write_t req;
   uv_buf_t bufs[3];
   uv_buf_t *bufp = &bufs[0];
   TUIData *data = ui->data;
@@ -1790,6 +2039,8 @@ static void flush_buf(UI *ui)
     return;
   }
 
+  wait_for_write(data);
+
   if (!data->is_invisible) {
     // cursor is visible. Write a "cursor invisible" command before writing the
     // buffer.
@@ -1815,11 +2066,30 @@ static void flush_buf(UI *ui)
     data->is_invisible = data->busy;
   }
 
-  uv_write(&req, STRUCT_CAST(uv_stream_t, &data->output_handle),
-           bufs, (unsigned)(bufp - bufs), NULL);
-  uv_run(&data->write_loop, UV_RUN_DEFAULT);
+  data->writing = true;
+  data->write_req.data = data;
+  uv_write(&data->write_req, STRUCT_CAST(uv_stream_t, &data->output_handle),
+           bufs, (unsigned)(bufp - bufs), write_cb);
+  data->buf = data->buf == data->bufs[0] ? data->bufs[1] : data->bufs[0];
   data->bufpos = 0;
   data->overflow = false;
+
+  uv_run(&data->write_loop, UV_RUN_NOWAIT);
+}
+
+static void write_cb(uv_write_t *req, int status)
+{
+  TUIData *data = req->data;
+  data->writing = false;
+}
+
+/// Waits until the terminal has taken the data of the write started by
+/// flush_buf().
+static void wait_for_write(TUIData *data)
+{
+  while (data->writing) {
+    uv_run(&data->write_loop, UV_RUN_ONCE);
+  }
 }
 
 #if TERMKEY_VERSION_MAJOR > 0 || TERMKEY_VERSION_MINOR > 18
@@ -9,15 +9,24 @@
 #include "nvim/vim.h"
 #include "nvim/ui.h"
 #include "nvim/ugrid.h"
+#include "nvim/map.h"
+#include "nvim/memory.h"
+#include "nvim/lib/kvec.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "ugrid.c.generated.h"
 #endif
 
+// Interned cell texts, shared by all grids so that cells can be copied
+// between them. Only used by the UI thread; never freed, as the distinct
+// texts too long for a cell are few.
+static kvec_t(char *) interned = KV_INITIAL_VALUE;
+static Map(cstr_t, ptr_t) *interned_index = NULL;
+
 void ugrid_init(UGrid *grid)
 {
-  grid->attrs = HLATTRS_INIT;
   grid->cells = NULL;
+  grid->width = grid->height = 0;
 }
 
 void ugrid_free(UGrid *grid)
@@ -44,13 +53,59 @@ void ugrid_resize(UGrid *grid, int width, int height)
 
 void ugrid_clear(UGrid *grid)
 {
-  clear_region(grid, 0, grid->height-1, 0, grid->width-1,
-               HLATTRS_INIT);
+  clear_region(grid, 0, grid->height-1, 0, grid->width-1, 0);
 }
 
-void ugrid_clear_chunk(UGrid *grid, int row, int col, int endcol, HlAttrs attrs)
+void ugrid_clear_chunk(UGrid *grid, int row, int col, int endcol, sattr_T attr)
 {
-  clear_region(grid, row, row, col, endcol-1, attrs);
+  clear_region(grid, row, row, col, endcol-1, attr);
+}
+
+/// Sets the text of a cell.
+void ugrid_set_text(UCell *cell, const char *text)
+{
+  size_t len = strlen(text);
+  if (len <= UCELL_INLINE && *text != UCELL_INTERNED) {
+    memset(cell->text, 0, UCELL_INLINE);
+    memcpy(cell->text, text, len);
+    return;
+  }
+  if (!interned_index) {
+    interned_index = map_new(cstr_t, ptr_t)();
+  }
+  uint32_t index;
+  ptr_t entry = map_get(cstr_t, ptr_t)(interned_index, text);
+  if (entry) {
+    index = (uint32_t)((uintptr_t)entry - 1);
+  } else {
+    index = (uint32_t)kv_size(interned);
+    char *copy = xstrdup(text);
+    kv_push(interned, copy);
+    map_put(cstr_t, ptr_t)(interned_index, copy, (ptr_t)(uintptr_t)(index + 1));
+  }
+  memset(cell->text, 0, UCELL_INLINE);
+  cell->text[0] = UCELL_INTERNED;
+  memcpy(cell->text + 1, &index, sizeof(index));
+}
+
+/// Gets the text of a cell.
+///
+/// @param[out] len  Length of the text, which may not be NUL-terminated.
+const char *ugrid_text(const UCell *cell, size_t *len)
+{
+  if (cell->text[0] == UCELL_INTERNED) {
+    uint32_t index;
+    memcpy(&index, cell->text + 1, sizeof(index));
+    const char *text = kv_A(interned, index);
+    *len = strlen(text);
+    return text;
+  }
+  size_t n = 0;
+  while (n < UCELL_INLINE && cell->text[n]) {
+    n++;
+  }
+  *len = n;
+  return cell->text;
 }
 
 void ugrid_goto(UGrid *grid, int row, int col)
@@ -99,32 +154,16 @@ void ugrid_scroll(UGrid *grid, int count, int *clear_top, int *clear_bot)
     *clear_bot = stop;
     *clear_top = stop + count + 1;
   }
-  clear_region(grid, *clear_top, *clear_bot, grid->left, grid->right,
-               HLATTRS_INIT);
-}
-
-UCell *ugrid_put(UGrid *grid, uint8_t *text, size_t size)
-{
-  UCell *cell = grid->cells[grid->row] + grid->col;
-  cell->data[size] = 0;
-  cell->attrs = grid->attrs;
-  assert(size <= CELLBYTES);
-
-  if (text) {
-    memcpy(cell->data, text, size);
-  }
-
-  grid->col += 1;
-  return cell;
+  clear_region(grid, *clear_top, *clear_bot, grid->left, grid->right, 0);
 }
 
 static void clear_region(UGrid *grid, int top, int bot, int left, int right,
-                         HlAttrs attrs)
+                         sattr_T attr)
 {
   UGRID_FOREACH_CELL(grid, top, bot, left, right, {
-    cell->data[0] = ' ';
-    cell->data[1] = 0;
-    cell->attrs = attrs;
+    memset(cell->text, 0, UCELL_INLINE);
+    cell->text[0] = ' ';
+    cell->attr = attr;
   });
 }
 
@@ -7,18 +7,23 @@
 typedef struct ucell UCell;
 typedef struct ugrid UGrid;
 
-#define CELLBYTES (sizeof(schar_T))
-
+// Bytes of cell text stored in the cell itself. Longer text (a character
+// with combining characters) is interned, see ugrid_set_text().
+#define UCELL_INLINE 6
+// First byte of the text of a cell whose text is interned. It never starts
+// an UTF-8 sequence.
+#define UCELL_INTERNED ((char)0xff)
+
+// Cells are compared with memcmp(): equal text is stored with the same bytes.
 struct ucell {
-  char data[CELLBYTES + 1];
-  HlAttrs attrs;
+  char text[UCELL_INLINE];  ///< NUL-padded, not terminated when full
+  sattr_T attr;             ///< highlight id, interpreted by the UI
 };
 
 struct ugrid {
   int top, bot, left, right;
   int row, col;
   int width, height;
-  HlAttrs attrs;
   UCell **cells;
 };
 
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <limits.h>
+#include <string.h>
 
 #include "nvim/log.h"
 #include "nvim/main.h"
@@ -24,10 +25,15 @@
 
 #define UI(b) (((UIBridgeData *)b)->ui)
 
-// Schedule a function call on the UI bridge thread.
+// Size of the queue of pending UI calls. Must fit the largest raw_line
+// payload twice.
+#define UI_BRIDGE_QUEUE_SIZE (1 << 20)
+
+// Queue a function call for the UI bridge thread. It is run after the next
+// ui_bridge_publish().
 #define UI_BRIDGE_CALL(ui, name, argc, ...) \
-  ((UIBridgeData *)ui)->scheduler( \
-      event_create(ui_bridge_##name##_event, argc, __VA_ARGS__), UI(ui))
+  ui_bridge_push((UIBridgeData *)ui, \
+                 event_create(ui_bridge_##name##_event, argc, __VA_ARGS__))
 
 #define INT2PTR(i) ((void *)(intptr_t)i)
 #define PTR2INT(p) ((Integer)(intptr_t)p)
@@ -70,6 +76,9 @@ UI *ui_bridge_attach(UI *ui, ui_main_fn ui_main, event_scheduler scheduler)
   }
 
   rv->ui_main = ui_main;
+  spscqueue_init(&rv->queue, UI_BRIDGE_QUEUE_SIZE);
+  uv_mutex_init(&rv->queue_mutex);
+  uv_cond_init(&rv->queue_cond);
   uv_mutex_init(&rv->mutex);
   uv_cond_init(&rv->cond);
   uv_mutex_lock(&rv->mutex);
@@ -102,6 +111,53 @@ static void ui_thread_run(void *data)
   bridge->ui_main(bridge, bridge->ui);
 }
 
+/// Reserves a call in the queue, waiting for the UI thread to make room if the
+/// queue is full (back-pressure).
+///
+/// @param[out] payload  Storage of `payload_size` bytes, valid until the
+///                      event handler returns.
+static Event *ui_bridge_reserve(UIBridgeData *bridge, size_t payload_size,
+                                void **payload)
+{
+  Event *event;
+  while (!(event = spscqueue_reserve(&bridge->queue, payload_size, payload))) {
+    ui_bridge_publish(bridge);
+    uv_mutex_lock(&bridge->queue_mutex);
+    if (!spscqueue_has_room(&bridge->queue, payload_size)) {
+      // Timeout only guards against a missed signal.
+      (void)uv_cond_timedwait(&bridge->queue_cond, &bridge->queue_mutex,
+                              10 * 1000000);
+    }
+    uv_mutex_unlock(&bridge->queue_mutex);
+  }
+  return event;
+}
+
+static void ui_bridge_push(UIBridgeData *bridge, Event event)
+{
+  void *payload;
+  *ui_bridge_reserve(bridge, 0, &payload) = event;
+}
+
+/// Hands all queued calls to the UI thread, waking it up if needed.
+static void ui_bridge_publish(UIBridgeData *bridge)
+{
+  if (spscqueue_publish(&bridge->queue)) {
+    bridge->scheduler(event_create(ui_bridge_process_event, 1, bridge),
+                      UI(bridge));
+  }
+}
+
+/// Runs all published calls on the UI thread.
+static void ui_bridge_process_event(void **argv)
+{
+  UIBridgeData *bridge = argv[0];
+  spscqueue_process(&bridge->queue);
+  uv_mutex_lock(&bridge->queue_mutex);
+  uv_cond_signal(&bridge->queue_cond);
+  uv_mutex_unlock(&bridge->queue_mutex);
+}
+
 static void ui_bridge_stop(UI *b)
 {
   // Detach brigde first, so that "stop" is the last event the TUI loop
@@ -110,6 +166,7 @@ static void ui_bridge_stop(UI *b)
   UIBridgeData *bridge = (UIBridgeData *)b;
   bool stopped = bridge->stopped = false;
   UI_BRIDGE_CALL(b, stop, 1, b);
+  ui_bridge_publish(bridge);
   for (;;) {
     uv_mutex_lock(&bridge->mutex);
     stopped = bridge->stopped;
@@ -122,6 +179,9 @@ static void ui_bridge_stop(UI *b)
   uv_thread_join(&bridge->ui_thread);
   uv_mutex_destroy(&bridge->mutex);
   uv_cond_destroy(&bridge->cond);
+  uv_mutex_destroy(&bridge->queue_mutex);
+  uv_cond_destroy(&bridge->queue_cond);
+  spscqueue_destroy(&bridge->queue);
   xfree(bridge->ui);  // Threads joined, now safe to free UI container. #7922
   xfree(b);
 }
@@ -134,9 +194,13 @@ static void ui_bridge_stop_event(void **argv)
 static void ui_bridge_hl_attr_define(UI *ui, Integer id, HlAttrs attrs,
                                      HlAttrs cterm_attrs, Array info)
 {
-  HlAttrs *a = xmalloc(sizeof(HlAttrs));
+  void *payload;
+  Event *event = ui_bridge_reserve((UIBridgeData *)ui, sizeof(HlAttrs),
+                                   &payload);
+  HlAttrs *a = payload;
   *a = attrs;
-  UI_BRIDGE_CALL(ui, hl_attr_define, 3, ui, INT2PTR(id), a);
+  *event = event_create(ui_bridge_hl_attr_define_event, 3, ui, INT2PTR(id),
+                        a);
 }
 static void ui_bridge_hl_attr_define_event(void **argv)
 {
@@ -144,7 +208,6 @@ static void ui_bridge_hl_attr_define_event(void **argv)
   Array info = ARRAY_DICT_INIT;
   ui->hl_attr_define(ui, PTR2INT(argv[1]), *((HlAttrs *)argv[2]),
                      *((HlAttrs *)argv[2]), info);
-  xfree(argv[2]);
 }
 
 static void ui_bridge_raw_line_event(void **argv)
@@ -153,8 +216,6 @@ static void ui_bridge_raw_line_event(void **argv)
   ui->raw_line(ui, PTR2INT(argv[1]), PTR2INT(argv[2]), PTR2INT(argv[3]),
                PTR2INT(argv[4]), PTR2INT(argv[5]), PTR2INT(argv[6]),
                argv[7], argv[8]);
-  xfree(argv[7]);
-  xfree(argv[8]);
 }
 static void ui_bridge_raw_line(UI *ui, Integer grid, Integer row,
                                Integer startcol, Integer endcol,
@@ -162,11 +223,29 @@ static void ui_bridge_raw_line(UI *ui, Integer grid, Integer row,
                                const schar_T *chunk, const sattr_T *attrs)
 {
   size_t ncol = (size_t)(endcol-startcol);
-  schar_T *c = xmemdup(chunk, ncol * sizeof(schar_T));
-  sattr_T *hl = xmemdup(attrs, ncol * sizeof(sattr_T));
-  UI_BRIDGE_CALL(ui, raw_line, 9, ui, INT2PTR(grid), INT2PTR(row),
-                 INT2PTR(startcol), INT2PTR(endcol), INT2PTR(clearcol),
-                 INT2PTR(clearattr), c, hl);
+  void *payload;
+  Event *event = ui_bridge_reserve(
+      (UIBridgeData *)ui, ncol * (sizeof(sattr_T) + sizeof(schar_T)),
+      &payload);
+  // attrs first: schar_T has no alignment, sattr_T does.
+  sattr_T *hl = payload;
+  schar_T *c = (schar_T *)(hl + ncol);
+  memcpy(hl, attrs, ncol * sizeof(sattr_T));
+  memcpy(c, chunk, ncol * sizeof(schar_T));
+  *event = event_create(ui_bridge_raw_line_event, 9, ui, INT2PTR(grid),
+                        INT2PTR(row), INT2PTR(startcol), INT2PTR(endcol),
+                        INT2PTR(clearcol), INT2PTR(clearattr), c, hl);
+}
+
+static void ui_bridge_flush(UI *ui)
+{
+  UI_BRIDGE_CALL(ui, flush, 1, ui);
+  ui_bridge_publish((UIBridgeData *)ui);
+}
+static void ui_bridge_flush_event(void **argv)
+{
+  UI *ui = UI(argv[0]);
+  ui->flush(ui);
 }
 
 
@@ -175,6 +254,7 @@ static void ui_bridge_suspend(UI *b)
   UIBridgeData *data = (UIBridgeData *)b;
   uv_mutex_lock(&data->mutex);
   UI_BRIDGE_CALL(b, suspend, 1, b);
+  ui_bridge_publish(data);
   data->ready = false;
   // Suspend the main thread until CONTINUE is called by the UI thread.
   while (!data->ready) {
@@ -195,6 +275,7 @@ static void ui_bridge_option_set(UI *ui, String name, Object value)
   *copy_value = copy_object(value);
   UI_BRIDGE_CALL(ui, option_set, 4, ui, copy_name.data,
                  INT2PTR(copy_name.size), copy_value);
+  ui_bridge_publish((UIBridgeData *)ui);
   // TODO(bfredl): when/if TUI/bridge teardown is refactored to use events, the
   // commit that introduced this special case can be reverted.
   // For now this is needed for nvim_list_uis().
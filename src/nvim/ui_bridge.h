@@ -7,6 +7,7 @@
 
 #include "nvim/ui.h"
 #include "nvim/event/defs.h"
+#include "nvim/event/spscqueue.h"
 
 typedef struct ui_bridge_data UIBridgeData;
 typedef void(*ui_main_fn)(UIBridgeData *bridge, UI *ui);
@@ -15,6 +16,11 @@ struct ui_bridge_data {
   UI *ui;     // UI pointer that will have its callback called in
               // another thread
   event_scheduler scheduler;
+  // UI calls are written here by the main thread and run by the UI thread.
+  // The UI thread is woken up (through `scheduler`) once per published batch.
+  SPSCQueue queue;
+  uv_mutex_t queue_mutex;
+  uv_cond_t queue_cond;  // signaled by the UI thread after draining `queue`
   uv_thread_t ui_thread;
   ui_main_fn ui_main;
   uv_mutex_t mutex;
@@ -253,6 +253,20 @@ int u_savesub(linenr_T lnum)
   return u_savecommon(lnum - 1, lnum + 1, lnum + 1, FALSE);
 }
 
+/// Save "count" lines starting at "lnum" (used by ":s").
+/// The lines are replaced, the new bottom line is "lnum" + "count".
+/// Careful: may trigger autocommands that reload the buffer.
+/// Returns FAIL when lines could not be saved, OK otherwise.
+int u_savesub_lines(linenr_T lnum, long count)
+{
+  if (undo_off) {
+    return OK;
+  }
+
+  return u_savecommon(lnum - 1, lnum + (linenr_T)count, lnum + (linenr_T)count,
+                      false);
+}
+
 /*
  * A new line is inserted before line "lnum" (used by :s command).
  * The line is inserted, so the new bottom line is lnum + 1.
@@ -0,0 +1,563 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// Searching files for ":vimgrep" on worker threads.
+//
+// Loading a file into a dummy buffer runs autocommands and detects the
+// encoding and fileformat, which is slow.  Files that are not loaded and for
+// which that would not make a difference are read and matched by a pool of
+// threads instead.  The threads work ahead of the main thread, which adds
+// the matches to the quickfix list in the order of the files.  When a file
+// turns out to need the normal way after all, e.g. because it is not UTF-8,
+// it is left to the main thread.
+
+#include <stdbool.h>
+#include <string.h>
+#include <uv.h>
+
+#include "nvim/vim.h"
+#include "nvim/ascii.h"
+#include "nvim/vimgrep.h"
+#include "nvim/buffer.h"
+#include "nvim/charset.h"
+#include "nvim/fileio.h"
+#include "nvim/globals.h"
+#include "nvim/mbyte.h"
+#include "nvim/memory.h"
+#include "nvim/option.h"
+#include "nvim/path.h"
+#include "nvim/quickfix.h"
+#include "nvim/regexp.h"
+#include "nvim/strings.h"
+#include "nvim/lib/kvec.h"
+#include "nvim/os/fileio.h"
+#include "nvim/os/input.h"
+
+/// Number of worker threads.
+#define VGR_THREADS 4
+/// Number of files searched ahead of the one the main thread waits for.
+#define VGR_AHEAD 64
+/// Number of bytes read from a file at a time.
+#define VGR_READ_SIZE 65536
+
+typedef enum {
+  kVgrSkip,     ///< left to the main thread
+  kVgrWaiting,  ///< not searched yet
+  kVgrBusy,     ///< being searched by a worker
+  kVgrDone,     ///< searched, matches are in "matches"
+  kVgrFailed,   ///< could not be searched, left to the main thread
+} VgrState;
+
+typedef struct {
+  char *fname;  ///< full file name
+  VgrState state;
+  kvec_t(vgr_match_T) matches;
+} vgr_file_T;
+
+struct vgr_pool {
+  uv_mutex_t mutex;
+  uv_cond_t work_cond;  ///< signalled when workers may continue
+  uv_cond_t done_cond;  ///< signalled when a worker finished a file
+  uv_thread_t threads[VGR_THREADS];
+  int nthreads;
+
+  vgr_file_T *files;
+  int fcount;
+  int next;             ///< index of the next file for a worker
+  int limit;            ///< workers only search files before this index
+  int freed;            ///< matches of files before this index were freed
+  volatile bool stop;   ///< set to make the workers stop
+
+  // Used by the workers, not changed while they run.
+  regprog_T *prog;
+  bool ic;              ///< ignore case
+  bool global;          ///< find all matches in a line
+  long maxcount;        ///< maximum number of matches in a file
+  buf_T *chartab_buf;   ///< only has b_chartab, for 'iskeyword'
+  bool skip_bom;        ///< 'fileencodings' has "ucs-bom"
+  bool try_latin1;      ///< not UTF-8: read as latin1
+  bool try_unix;        ///< 'fileformats' has "unix"
+  bool try_dos;         ///< 'fileformats' has "dos"
+  bool try_mac;         ///< 'fileformats' has "mac"
+};
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "vimgrep.c.generated.h"
+#endif
+
+/// Start searching the files "fnames[fcount]" for pattern "pat" on worker
+/// threads.  Only files that are not loaded are searched.
+///
+/// @param ic  ignore case
+/// @param flags  VGR_GLOBAL for finding all matches in a line.
+/// @param maxcount  maximum number of matches in a file.
+///
+/// @return NULL when the files can't be searched on worker threads.
+vgr_pool_T *vgr_pool_new(char_u *pat, bool ic, int flags, long maxcount,
+                         char_u **fnames, int fcount)
+{
+  // A dummy buffer gets the global value of 'binary'.
+  long binary = 0;
+  get_option_value((char_u *)"binary", &binary, NULL, OPT_GLOBAL);
+  if (binary || *p_fencs == NUL || *p_ffs == NUL) {
+    return NULL;
+  }
+
+  // 'fileencodings' must start with UTF-8.  When the next one is latin1 a
+  // file that isn't valid UTF-8 can still be read.
+  bool skip_bom = false;
+  bool utf8 = false;
+  bool try_latin1 = false;
+  char_u *p = p_fencs;
+  char_u buf[50];
+  while (*p != NUL) {
+    copy_option_part(&p, buf, sizeof(buf), ",");
+    char_u *enc = enc_canonize(buf);
+    bool is_utf8 = STRCMP(enc, "utf-8") == 0;
+    bool is_latin1 = STRCMP(enc, "latin1") == 0;
+    xfree(enc);
+    if (!utf8 && STRCMP(buf, "ucs-bom") == 0) {
+      skip_bom = true;
+    } else if (is_utf8) {
+      utf8 = true;
+    } else {
+      try_latin1 = utf8 && is_latin1;
+      break;
+    }
+  }
+  if (!utf8) {
+    return NULL;
+  }
+
+  // The workers hold their own reference to the program: the main thread may
+  // drop its reference when switching to another engine.  A program for the
+  // backtracking engine is not shared, then all files are loaded.
+  regprog_T *prog = vim_regcomp(pat, RE_MAGIC);
+  if (prog == NULL) {
+    return NULL;
+  }
+  if (!re_shareable(prog)) {
+    vim_regfree(prog);
+    return NULL;
+  }
+
+  vgr_pool_T *pool = xcalloc(1, sizeof(vgr_pool_T));
+  pool->prog = prog;
+  pool->ic = ic;
+  pool->global = (flags & VGR_GLOBAL) != 0;
+  pool->maxcount = maxcount;
+  pool->skip_bom = skip_bom;
+  pool->try_latin1 = try_latin1;
+  pool->try_unix = vim_strchr(p_ffs, 'u') != NULL;
+  pool->try_dos = vim_strchr(p_ffs, 'd') != NULL;
+  pool->try_mac = vim_strchr(p_ffs, 'm') != NULL;
+  // Like in the dummy buffer a file would be loaded in, use the global
+  // 'iskeyword' and 'lisp' values.
+  pool->chartab_buf = xcalloc(1, sizeof(buf_T));
+  pool->chartab_buf->b_p_isk = p_isk;
+  pool->chartab_buf->b_p_lisp = p_lisp;
+  (void)buf_init_chartab(pool->chartab_buf, false);
+  pool->chartab_buf->b_p_isk = NULL;
+
+  pool->fcount = fcount;
+  pool->files = xcalloc((size_t)fcount, sizeof(vgr_file_T));
+  int nwork = 0;
+  for (int i = 0; i < fcount; i++) {
+    vgr_file_T *file = &pool->files[i];
+    kv_init(file->matches);
+    if (vgr_can_read(fnames[i])) {
+      file->fname = FullName_save((char *)fnames[i], true);
+      file->state = kVgrWaiting;
+      nwork++;
+    } else {
+      file->state = kVgrSkip;
+    }
+  }
+  pool->limit = VGR_AHEAD;
+
+  uv_mutex_init(&pool->mutex);
+  uv_cond_init(&pool->work_cond);
+  uv_cond_init(&pool->done_cond);
+  int nthreads = MIN(nwork, VGR_THREADS);
+  for (int i = 0; i < nthreads; i++) {
+    if (uv_thread_create(&pool->threads[pool->nthreads], vgr_worker,
+                         pool) == 0) {
+      pool->nthreads++;
+    }
+  }
+  if (pool->nthreads == 0) {
+    vgr_pool_free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+/// Check if file "fname" can be read by a worker thread: it is not loaded in
+/// a buffer and loading it in a dummy buffer would not trigger autocommands.
+static bool vgr_can_read(char_u *fname)
+{
+  // Events that load_dummy_buffer() and unload_dummy_buffer() may trigger.
+  static const event_T events[] = {
+    EVENT_BUFNEW, EVENT_BUFADD, EVENT_BUFENTER, EVENT_BUFLEAVE,
+    EVENT_BUFREADCMD, EVENT_FILEREADCMD, EVENT_BUFREADPRE, EVENT_FILEREADPRE,
+    EVENT_BUFREADPOST, EVENT_FILEREADPOST, EVENT_SWAPEXISTS,
+    EVENT_ENCODINGCHANGED, EVENT_FILETYPE, EVENT_SYNTAX, EVENT_BUFHIDDEN,
+    EVENT_BUFUNLOAD, EVENT_BUFDELETE, EVENT_BUFWIPEOUT,
+  };
+
+  buf_T *buf = buflist_findname_exp(fname);
+  if (buf != NULL && buf->b_ml.ml_mfp != NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < ARRAY_SIZE(events); i++) {
+    if (has_autocmd(events[i], fname, NULL)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Wait for the workers to finish searching file "idx".  The matches of files
+/// before "idx" are freed.
+///
+/// @param[out] matches  the matches in the file, when OK is returned.
+/// @param[out] count  number of items in "matches".
+///
+/// @return OK when the file was searched, FAIL when it needs to be loaded in
+///         a buffer and NOTDONE when interrupted.
+int vgr_pool_wait(vgr_pool_T *pool, int idx, vgr_match_T **matches,
+                  size_t *count)
+{
+  vgr_file_T *file = &pool->files[idx];
+
+  for (; pool->freed < idx; pool->freed++) {
+    vgr_free_matches(&pool->files[pool->freed]);
+  }
+
+  uv_mutex_lock(&pool->mutex);
+  if (pool->limit < idx + VGR_AHEAD) {
+    pool->limit = idx + VGR_AHEAD;
+    uv_cond_broadcast(&pool->work_cond);
+  }
+  while (file->state == kVgrWaiting || file->state == kVgrBusy) {
+    // Wake up now and then to check for CTRL-C.
+    (void)uv_cond_timedwait(&pool->done_cond, &pool->mutex, 20000000);
+    if (file->state == kVgrWaiting || file->state == kVgrBusy) {
+      uv_mutex_unlock(&pool->mutex);
+      os_breakcheck();
+      uv_mutex_lock(&pool->mutex);
+      if (got_int) {
+        uv_mutex_unlock(&pool->mutex);
+        return NOTDONE;
+      }
+    }
+  }
+  VgrState state = file->state;
+  uv_mutex_unlock(&pool->mutex);
+
+  if (state != kVgrDone) {
+    return FAIL;
+  }
+  *matches = file->matches.items;
+  *count = kv_size(file->matches);
+  return OK;
+}
+
+/// Stop the workers and free "pool".
+void vgr_pool_free(vgr_pool_T *pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+  uv_mutex_lock(&pool->mutex);
+  pool->stop = true;
+  uv_cond_broadcast(&pool->work_cond);
+  uv_mutex_unlock(&pool->mutex);
+  for (int i = 0; i < pool->nthreads; i++) {
+    uv_thread_join(&pool->threads[i]);
+  }
+  uv_cond_destroy(&pool->done_cond);
+  uv_cond_destroy(&pool->work_cond);
+  uv_mutex_destroy(&pool->mutex);
+
+  for (int i = 0; i < pool->fcount; i++) {
+    vgr_free_matches(&pool->files[i]);
+    kv_destroy(pool->files[i].matches);
+    xfree(pool->files[i].fname);
+  }
+  xfree(pool->files);
+  xfree(pool->chartab_buf);
+  vim_regfree(pool->prog);
+  xfree(pool);
+}
+
+static void vgr_free_matches(vgr_file_T *file)
+{
+  for (size_t i = 0; i < kv_size(file->matches); i++) {
+    xfree(kv_A(file->matches, i).text);
+  }
+  kv_size(file->matches) = 0;
+}
+
+/// Main function of a worker thread: search files until there are none left
+/// or the pool is stopped.
+static void vgr_worker(void *arg)
+{
+  vgr_pool_T *pool = arg;
+
+  uv_mutex_lock(&pool->mutex);
+  while (!pool->stop) {
+    while (pool->next < pool->fcount
+           && pool->files[pool->next].state != kVgrWaiting) {
+      pool->next++;
+    }
+    if (pool->next >= pool->fcount) {
+      break;
+    }
+    if (pool->next >= pool->limit) {
+      uv_cond_wait(&pool->work_cond, &pool->mutex);
+      continue;
+    }
+    vgr_file_T *file = &pool->files[pool->next++];
+    file->state = kVgrBusy;
+    uv_mutex_unlock(&pool->mutex);
+
+    bool ok = vgr_search_file(pool, file, false);
+    if (!ok && pool->try_latin1 && !pool->stop) {
+      vgr_free_matches(file);
+      ok = vgr_search_file(pool, file, true);
+    }
+    if (!ok) {
+      vgr_free_matches(file);
+    }
+
+    uv_mutex_lock(&pool->mutex);
+    file->state = ok ? kVgrDone : kVgrFailed;
+    uv_cond_broadcast(&pool->done_cond);
+  }
+  uv_mutex_unlock(&pool->mutex);
+
+  regexp_free_thread_state();
+}
+
+/// Read file "file" and find matches in it, like it was loaded into a buffer.
+///
+/// @param latin1  convert the text from latin1, otherwise it must be UTF-8.
+///
+/// @return false when the file must be loaded into a buffer to be searched.
+static bool vgr_search_file(vgr_pool_T *pool, vgr_file_T *file, bool latin1)
+{
+  FileDescriptor fp;
+  if (file_open(&fp, file->fname, kFileReadOnly, 0) != 0) {
+    return false;
+  }
+
+  bool ok = true;
+  bool first = true;
+  bool dos = false;
+  linenr_T lnum = 0;
+  size_t len = 0;                 // number of bytes in "data"
+  size_t size = VGR_READ_SIZE + 1;
+  char_u *data = xmalloc(size);
+  char_u *line = NULL;            // converted line for latin1
+  size_t linesize = 0;
+
+  for (;;) {
+    if (size - len < VGR_READ_SIZE + 1) {
+      size = len + VGR_READ_SIZE + 1;
+      data = xrealloc(data, size);
+    }
+    ptrdiff_t n = file_read(&fp, (char *)data + len, VGR_READ_SIZE);
+    if (n < 0) {
+      ok = false;
+      break;
+    }
+    len += (size_t)n;
+    bool eof = n == 0 || fp.eof;
+
+    size_t start = 0;
+    if (first) {
+      first = false;
+      if (!vgr_detect_ff(pool, data, len, &dos)) {
+        ok = false;
+        break;
+      }
+      if (len >= 3 && data[0] == 0xef && data[1] == 0xbb && data[2] == 0xbf
+          && pool->skip_bom) {
+        if (latin1) {
+          // A file with a BOM is not read as latin1.
+          ok = false;
+          break;
+        }
+        start = 3;
+      }
+    }
+
+    // Search all complete lines.  At the end of the file the last line does
+    // not need to end in a NL.
+    while (start < len) {
+      char_u *nl = memchr(data + start, NL, len - start);
+      if (nl == NULL && !eof) {
+        break;
+      }
+      size_t end = nl == NULL ? len : (size_t)(nl - data);
+      size_t next = nl == NULL ? len : end + 1;
+      if (dos && nl != NULL) {
+        if (end == start || data[end - 1] != CAR) {
+          // Not all lines end in CR-LF.
+          ok = false;
+          break;
+        }
+        end--;
+      }
+      char_u *text = data + start;
+      size_t textlen = end - start;
+      if (latin1) {
+        if (linesize < textlen * 2 + 1) {
+          linesize = textlen * 2 + 1;
+          line = xrealloc(line, linesize);
+        }
+        textlen = vgr_latin1_to_utf8(text, textlen, line);
+        text = line;
+      } else if (!vgr_check_utf8(text, textlen)) {
+        ok = false;
+        break;
+      }
+      text[textlen] = NUL;
+      // A NUL in the file is stored as a NL in the buffer.
+      memchrsub(text, NUL, NL, textlen);
+
+      lnum++;
+      if (pool->stop || !vgr_search_line(pool, file, lnum, text)) {
+        ok = false;
+        break;
+      }
+      start = next;
+      if ((long)kv_size(file->matches) >= pool->maxcount) {
+        break;
+      }
+    }
+    if (!ok || eof || (long)kv_size(file->matches) >= pool->maxcount) {
+      break;
+    }
+
+    len -= start;
+    memmove(data, data + start, len);
+  }
+
+  xfree(line);
+  xfree(data);
+  (void)file_close(&fp, false);
+  return ok;
+}
+
+/// Detect the fileformat from the first "len" bytes of a file, like
+/// readfile() does.
+///
+/// @param[out] dos  set to true when lines end in CR-LF.
+///
+/// @return false when the file must be loaded into a buffer.
+static bool vgr_detect_ff(vgr_pool_T *pool, const char_u *data, size_t len,
+                          bool *dos)
+{
+  bool has_nl = false;
+  bool all_crnl = true;
+  bool lone_cr = false;
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == NL) {
+      has_nl = true;
+      if (i == 0 || data[i - 1] != CAR) {
+        all_crnl = false;
+      }
+    } else if (data[i] == CAR && i + 1 < len && data[i + 1] != NL) {
+      lone_cr = true;
+    }
+  }
+
+  if (lone_cr && pool->try_mac) {
+    // Might be a mac file, leave it to readfile().
+    return false;
+  }
+  if (!has_nl) {
+    *dos = false;
+    return true;
+  }
+  if (all_crnl && pool->try_dos) {
+    *dos = true;
+    return true;
+  }
+  *dos = false;
+  return pool->try_unix;
+}
+
+/// Check that "len" bytes at "p" are valid UTF-8.
+static bool vgr_check_utf8(const char_u *p, size_t len)
+{
+  const char_u *end = p + len;
+  while (p < end) {
+    if (*p < 0x80) {
+      p++;
+      continue;
+    }
+    int l = utf_ptr2len_len(p, (int)MIN(end - p, 6));
+    if (l == 1 || l > end - p) {
+      return false;
+    }
+    p += l;
+  }
+  return true;
+}
+
+/// Convert "len" bytes of latin1 text "from" to UTF-8 in "to", which must
+/// have room for twice as many bytes.
+///
+/// @return the number of bytes in "to".
+static size_t vgr_latin1_to_utf8(const char_u *from, size_t len, char_u *to)
+{
+  char_u *d = to;
+  for (size_t i = 0; i < len; i++) {
+    if (from[i] < 0x80) {
+      *d++ = from[i];
+    } else {
+      d += utf_char2bytes(from[i], d);
+    }
+  }
+  return (size_t)(d - to);
+}
+
+/// Find the matches in line "lnum" with text "line" and add them to "file".
+///
+/// @return false when the line must be searched on the main thread.
+static bool vgr_search_line(vgr_pool_T *pool, vgr_file_T *file, linenr_T lnum,
+                            char_u *line)
+{
+  regmatch_T regmatch;
+  regmatch.regprog = pool->prog;
+  regmatch.rm_ic = pool->ic;
+  colnr_T col = 0;
+  colnr_T len = (colnr_T)STRLEN(line);
+
+  for (;;) {
+    int r = vim_regexec_shared(&regmatch, pool->chartab_buf, line, col);
+    if (r == NFA_TOO_EXPENSIVE) {
+      return false;
+    }
+    if (r == 0) {
+      break;
+    }
+    kv_push(file->matches, ((vgr_match_T) {
+      .lnum = lnum,
+      .col = (colnr_T)(regmatch.startp[0] - line),
+      .text = vim_strsave(line),
+    }));
+    if (!pool->global || (long)kv_size(file->matches) >= pool->maxcount) {
+      break;
+    }
+    colnr_T endcol = (colnr_T)(regmatch.endp[0] - line);
+    col = endcol + (col == endcol);
+    if (col > len) {
+      break;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,20 @@
+#ifndef NVIM_VIMGREP_H
+#define NVIM_VIMGREP_H
+
+#include "nvim/types.h"
+#include "nvim/pos.h"
+#include "nvim/regexp_defs.h"
+
+/// A match found by a ":vimgrep" worker thread.
+typedef struct {
+  linenr_T lnum;  ///< line number of the match
+  colnr_T col;    ///< byte index of the start of the match
+  char_u *text;   ///< text of the line
+} vgr_match_T;
+
+typedef struct vgr_pool vgr_pool_T;
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "vimgrep.h.generated.h"
+#endif
+#endif  // NVIM_VIMGREP_H
@@ -3934,6 +3934,7 @@ win_free (
   }
 
   win_free_lsize(wp);
+  kv_destroy(wp->w_vcol_index.vi_cps);
 
   for (i = 0; i < wp->w_tagstacklen; ++i)
     xfree(wp->w_tagstack[i].tagname);
@@ -3953,6 +3954,7 @@ win_free (
   free_jumplist(wp);
 
   qf_free_all(wp);
+  stl_expr_win_free(wp);
 
 
   xfree(wp->w_p_cc_cols);
@@ -4083,6 +4085,7 @@ void win_free_lsize(win_T *wp)
   if (wp != NULL) {
     xfree(wp->w_lines);
     wp->w_lines = NULL;
+    line_cache_free(wp);
   }
 }
 
@@ -12,6 +12,8 @@ local sample_file = 'test/benchmark/samples/re.freeze.txt'
 -- Vim script code that does both the work and the benchmarking of that work.
 local measure_cmd =
     [[call Measure(%d, ']] .. sample_file .. [[', '\s\+\%%#\@<!$', '+5')]]
+local measure_dfa_cmd =
+    [[call Measure(%d, ']] .. sample_file .. [[', '\w\+\s\+$', '+5')]]
 local measure_script = [[
     func! Measure(re, file, pattern, arg)
       let sstart=reltime()
@@ -21,7 +23,7 @@ local measure_script = [[
       call search(a:pattern, '', '', 10000)
       q!
 
-      $put =printf('file: %s, re: %d, time: %s', a:file, a:re, reltimestr(reltime(sstart)))
+      $put =printf('file: %s, re: %d, pattern: %s, time: %s', a:file, a:re, a:pattern, reltimestr(reltime(sstart)))
     endfunc]]
 
 describe('regexp search', function()
@@ -61,4 +63,26 @@ describe('regexp search', function()
     command(string.format(measure_cmd, regexpengine))
     command('write')
   end)
+
+  it('is working with regexpengine=3', function()
+    local regexpengine = 3
+    command(string.format(measure_cmd, regexpengine))
+    command('write')
+  end)
+
+  -- The pattern above uses look-behind, which the DFA engine leaves to the NFA
+  -- engine.  This one can be matched by the DFA.
+  it('is working with regexpengine=2 and a pattern without look-around',
+  function()
+    local regexpengine = 2
+    command(string.format(measure_dfa_cmd, regexpengine))
+    command('write')
+  end)
+
+  it('is working with regexpengine=3 and a pattern without look-around',
+  function()
+    local regexpengine = 3
+    command(string.format(measure_dfa_cmd, regexpengine))
+    command('write')
+  end)
 end)
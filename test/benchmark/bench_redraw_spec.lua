@@ -0,0 +1,143 @@
+-- Benchmark of redrawing: time spent in update_screen() and the UI events
+-- sent to an attached UI, for a few typical workloads.
+--
+-- Results are printed as a table.  When $NVIM_BENCHMARK_OUTPUT is set, they
+-- are also appended to that file as JSON objects, one per line, for tracking
+-- regressions between builds.
+
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command, source = helpers.clear, helpers.command, helpers.source
+local eval, request, retry = helpers.eval, helpers.request, helpers.retry
+
+-- Each scenario has a name, a Vim script run before measuring and the
+-- workload.  A workload is Vim script or a function that does the work.
+-- Vim script workloads need ":redraw" to get a frame drawn.  Scenarios marked
+-- "unix" need a Unix shell.
+local scenarios = {
+  {'scroll with syntax', [[
+    call setline(1, map(range(5000), 'printf("static int f%d(int x) '
+          \ .'{ return x * %d; }  /* comment %d */", v:val, v:val, v:val)'))
+    syntax on
+    set filetype=c
+  ]], [[
+    for i in range(200)
+      execute "normal! \<C-E>"
+      redraw
+    endfor
+    for i in range(40)
+      execute "normal! \<C-F>"
+      redraw
+    endfor
+  ]]},
+  {'split layout', [[
+    call setline(1, map(range(500), 'repeat("word ", v:val % 15)'))
+    for i in range(3)
+      vsplit
+      split
+    endfor
+  ]], [[
+    for i in range(100)
+      wincmd w
+      execute "normal! \<C-E>"
+      redraw
+    endfor
+  ]]},
+  {'statusline items', [[
+    call setline(1, map(range(500), 'repeat("text ", v:val % 15)'))
+    set laststatus=2 ruler
+    set statusline=%f\ %{winnr()}\ %{&filetype}\ %{toupper(mode())}%=%l:%c\ %P
+    for i in range(4)
+      split
+    endfor
+  ]], [[
+    for i in range(200)
+      normal! j
+      if i % 10 == 0
+        wincmd w
+      endif
+      redraw
+    endfor
+  ]]},
+  {'terminal flood', '', function()
+    command('terminal seq 1 20000')
+    retry(nil, 10000, function()
+      assert(eval('jobwait([b:terminal_job_id], 0)[0]') ~= -1)
+    end)
+    command('redraw')
+  end, 'unix'},
+}
+
+local fields = {'frames', 'redraws', 'redraw_ms', 'events', 'bytes',
+                'events_per_frame', 'bytes_per_frame'}
+
+local function measure(setup, workload)
+  source(setup)
+  command('redraw!')
+  local before = request('nvim__stats')
+  if type(workload) == 'function' then
+    workload()
+  else
+    source(workload)
+  end
+  local after = request('nvim__stats')
+  local frames = after.ui_frames - before.ui_frames
+  local events = after.ui_events - before.ui_events
+  local bytes = after.ui_bytes - before.ui_bytes
+  return {
+    frames = frames,
+    redraws = after.redraw - before.redraw,
+    redraw_ms = (after.redraw_time - before.redraw_time) / 1000000,
+    events = events,
+    bytes = bytes,
+    events_per_frame = frames > 0 and events / frames or 0,
+    bytes_per_frame = frames > 0 and bytes / frames or 0,
+  }
+end
+
+local function to_json(name, result)
+  local items = {string.format('"scenario": "%s"', name)}
+  for _, field in ipairs(fields) do
+    table.insert(items, string.format('"%s": %.3f', field, result[field]))
+  end
+  return '{'..table.concat(items, ', ')..'}'
+end
+
+describe('redraw', function()
+  local results = {}
+
+  teardown(function()
+    print ''
+    print(string.format('%-20s %7s %7s %10s %8s %10s %10s %10s',
+                        'scenario', 'frames', 'redraws', 'redraw ms',
+                        'events', 'bytes', 'events/f', 'bytes/f'))
+    for _, r in ipairs(results) do
+      print(string.format('%-20s %7d %7d %10.2f %8d %10d %10.1f %10.1f',
+                          r[1], r[2].frames, r[2].redraws, r[2].redraw_ms,
+                          r[2].events, r[2].bytes, r[2].events_per_frame,
+                          r[2].bytes_per_frame))
+    end
+    local output = os.getenv('NVIM_BENCHMARK_OUTPUT')
+    if output then
+      local f = assert(io.open(output, 'a'))
+      for _, r in ipairs(results) do
+        f:write(to_json(r[1], r[2]), '\n')
+      end
+      f:close()
+    end
+  end)
+
+  for _, scenario in ipairs(scenarios) do
+    local name, setup, workload = scenario[1], scenario[2], scenario[3]
+    it('with '..name, function()
+      if scenario[4] == 'unix' and helpers.pending_win32(pending) then
+        return
+      end
+      clear()
+      local screen = Screen.new(80, 24)
+      screen:attach()
+      table.insert(results, {name, measure(setup, workload)})
+      screen:detach()
+    end)
+  end
+end)
@@ -0,0 +1,71 @@
+-- Benchmark of the amount of output the TUI writes to the terminal.
+
+local helpers = require('test.functional.helpers')(after_each)
+local thelpers = require('test.functional.terminal.helpers')
+local clear, write_file = helpers.clear, helpers.write_file
+local nvim_prog, retry, eval = helpers.nvim_prog, helpers.retry, helpers.eval
+
+-- Terminal output of the TUI is redirected here.
+local output_file = 'Xtui_output.out'
+local script_file = 'Xtui_bench.vim'
+
+-- Each scenario is a Vim script run in a TUI session, which quits after it.
+local scenarios = {
+  {'window borders', [[
+    vsplit
+    split
+    redraw
+  ]]},
+  {'repeated characters', [[
+    call setline(1, map(range(20), 'repeat(v:val % 2 ? "=" : "-", 78)'))
+    redraw
+  ]]},
+  {'whitespace', [[
+    call setline(1, map(range(20), 'repeat(" ", 30).v:val.repeat(" ", 30).v:val'))
+    redraw
+  ]]},
+  {'sparse updates', [[
+    call setline(1, map(range(20), 'repeat("abcdefghij", 7)'))
+    redraw
+    for i in range(1, 20)
+      call setline(i, substitute(getline(i), 'e', 'E', 'g'))
+      redraw
+    endfor
+  ]]},
+}
+
+local function measure(script)
+  write_file(script_file, script..'\nqa!\n')
+  os.remove(output_file)
+  thelpers.screen_setup(17, '["sh", "-c", "'..nvim_prog
+    ..' -u NONE -i NONE --cmd \'set noswapfile\' -S '..script_file
+    ..' > '..output_file..'"]', 80)
+  retry(nil, 10000, function()
+    -- The shell job exits after Nvim has written all its output.
+    assert(eval('jobwait([b:terminal_job_id], 0)[0]') ~= -1)
+  end)
+  local f = assert(io.open(output_file, 'rb'))
+  local size = #f:read('*a')
+  f:close()
+  return size
+end
+
+describe('TUI output', function()
+  local results = {}
+
+  teardown(function()
+    print ''
+    for _, r in ipairs(results) do
+      print(string.format('%-24s %8d bytes', r[1], r[2]))
+    end
+    os.remove(output_file)
+    os.remove(script_file)
+  end)
+
+  for _, scenario in ipairs(scenarios) do
+    it('bytes for '..scenario[1], function()
+      clear()
+      table.insert(results, {scenario[1], measure(scenario[2])})
+    end)
+  end
+end)
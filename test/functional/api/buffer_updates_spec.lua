@@ -260,13 +260,29 @@ describe('API: buffer events:', function()
     tick = tick + 1
     expectn('nvim_buf_lines_event', {b, tick, 2, 3, {'original foo'}, false})
 
-    -- replace parts of several lines line using :s
+    -- replace parts of several lines line using :s, one event is sent for
+    -- each range of changed lines
     tick = reopen(b, origlines)
     command('%s/line [35]/foo/')
     tick = tick + 1
-    expectn('nvim_buf_lines_event', {b, tick, 2, 5, {'original foo',
+    expectn('nvim_buf_lines_event', {b, tick, 2, 3, {'original foo'}, false})
+    expectn('nvim_buf_lines_event', {b, tick, 4, 5, {'original foo'}, false})
+    tick = reopen(b, origlines)
+    command('%s/line [346]/foo/')
+    tick = tick + 1
+    expectn('nvim_buf_lines_event', {b, tick, 2, 4, {'original foo',
+                                                     'original foo'}, false})
+    expectn('nvim_buf_lines_event', {b, tick, 5, 6, {'original foo'}, false})
+
+    -- line breaks in the replacement: one event for all lines in between
+    tick = reopen(b, origlines)
+    command('%s/line \\([35]\\)/\\1\\r/')
+    tick = tick + 1
+    expectn('nvim_buf_lines_event', {b, tick, 2, 5, {'original 3',
+                                           '',
                                            'original line 4',
-                                           'original foo'}, false})
+                                           'original 5',
+                                           ''}, false})
 
     -- type text into the first line of a blank file, one character at a time
     command('enew!')
@@ -4,6 +4,8 @@ local clear = helpers.clear
 local eq = helpers.eq
 local eval = helpers.eval
 local expect_err = helpers.expect_err
+local feed = helpers.feed
+local iswin = helpers.iswin
 local meths = helpers.meths
 local request = helpers.request
 
@@ -34,4 +36,57 @@ describe('nvim_ui_attach()', function()
     expect_err('UI already attached to channel: 1',
                request, 'nvim_ui_attach', 40, 10, { rgb=false })
   end)
+  it('max_fps merges frames without losing grid updates', function()
+    local screen = Screen.new(20, 4)
+    screen:attach({rgb=true, max_fps=2})
+    screen:set_default_attr_ids({[1] = {bold=true, foreground=Screen.colors.Blue}})
+    feed('i')
+    for i = 1, 10 do
+      feed(tostring(i)..'<cr>')
+    end
+    feed('<esc>')
+    screen:expect([[
+      9                   |
+      10                  |
+      ^                    |
+                          |
+    ]])
+    eq(2, meths.list_uis()[1].max_fps)
+    expect_err('max_fps option cannot be changed',
+               request, 'nvim_ui_set_option', 'max_fps', 0)
+  end)
+  it('packed_lines draws the same screen', function()
+    local screen = Screen.new(20, 4)
+    screen:attach({rgb=true, packed_lines=true})
+    screen:set_default_attr_ids({[1] = {bold=true, foreground=Screen.colors.Blue}})
+    feed('iaaaa bb  cc<esc>')
+    screen:expect([[
+      aaaa bb  c^c         |
+      {1:~                   }|
+      {1:~                   }|
+                          |
+    ]])
+    eq(true, meths.list_uis()[1].packed_lines)
+    expect_err('packed_lines option cannot be changed',
+               request, 'nvim_ui_set_option', 'packed_lines', false)
+  end)
+  it('shm_grid draws the same screen', function()
+    if iswin() then
+      pending('shared grid is not supported on Windows', function() end)
+      return
+    end
+    local screen = Screen.new(20, 4)
+    screen:attach({rgb=true, shm_grid=true})
+    screen:set_default_attr_ids({[1] = {bold=true, foreground=Screen.colors.Blue}})
+    feed('iaaaa<cr>bb<cr>cc<cr>dd<esc>')
+    screen:expect([[
+      bb                  |
+      cc                  |
+      d^d                  |
+                          |
+    ]])
+    eq(true, meths.list_uis()[1].shm_grid)
+    expect_err('shm_grid option cannot be changed',
+               request, 'nvim_ui_set_option', 'shm_grid', false)
+  end)
 end)
@@ -156,6 +156,7 @@ describe("ui_options in metadata", function()
     local api = helpers.call('api_info')
     local options = api.ui_options
     eq({'rgb', 'ext_cmdline', 'ext_popupmenu',
-        'ext_tabline', 'ext_wildmenu', 'ext_newgrid', 'ext_hlstate'}, options)
+        'ext_tabline', 'ext_wildmenu', 'ext_newgrid', 'ext_hlstate',
+        'packed_lines', 'max_fps', 'shm_grid'}, options)
   end)
 end)
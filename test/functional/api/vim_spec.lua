@@ -1257,6 +1257,9 @@ describe('API', function()
           ext_newgrid = screen._options.ext_newgrid or false,
           ext_hlstate=false,
           height = 4,
+          max_fps = 0,
+          packed_lines = false,
+          shm_grid = false,
           rgb = true,
           width = 20,
         }
@@ -1273,4 +1276,79 @@ describe('API', function()
     end)
   end)
 
+  describe('nvim_get_search_count', function()
+    it('counts matches of the search pattern', function()
+      meths.buf_set_lines(0, 0, -1, true, {'foo bar foo', 'bar', 'foofoo'})
+      command('let @/ = "foo"')
+      command('call cursor(2, 1)')
+      eq({current=2, total=4, incomplete=false},
+         meths.get_search_count({}))
+      eq({current=1, total=2, incomplete=false},
+         meths.get_search_count({pattern='bar'}))
+      command('let @/ = ""')
+      eq({}, meths.get_search_count({}))
+      expect_err('unexpected key: foo', meths.get_search_count, {foo=1})
+      expect_err('pattern must be a String', meths.get_search_count,
+                 {pattern=1})
+    end)
+
+    it('finishes counting while waiting for input', function()
+      local screen = Screen.new(40, 3)
+      screen:attach()
+      command('set laststatus=2 statusline=%{searchcount().total}')
+      command('call setline(1, repeat(["foo x foo"], 300000))')
+      command('let @/ = "foo"')
+      screen:expect{grid=[[
+        ^foo x foo                               |
+        600000                                  |
+                                                |
+      ]], attr_ignore=true}
+      eq({current=1, total=600000, incomplete=false},
+         meths.get_search_count({}))
+
+      -- setting the search pattern evaluates the status line again
+      command('let @/ = "x"')
+      screen:expect{grid=[[
+        ^foo x foo                               |
+        300000                                  |
+                                                |
+      ]], attr_ignore=true}
+      screen:detach()
+    end)
+  end)
+
+  describe('nvim__stats', function()
+    it('counts redraws and what is sent to UIs', function()
+      local screen = Screen.new(20, 4)
+      screen:attach()
+      command('redraw!')
+      local before = request('nvim__stats')
+      command('call setline(1, "text") | redraw')
+      local after = request('nvim__stats')
+      ok(after.redraw > before.redraw)
+      ok(after.redraw_time > before.redraw_time)
+      ok(after.ui_frames > before.ui_frames)
+      ok(after.ui_events > before.ui_events)
+      ok(after.ui_bytes > before.ui_bytes)
+      screen:detach()
+    end)
+
+    it('counts compiled regexp programs found in the cache', function()
+      local before = request('nvim__stats')
+      command('let g:n = 0 | for i in range(10) | let g:n += match("foo42", \'o\\d\\+\') | endfor')
+      local after = request('nvim__stats')
+      eq(20, eval('g:n'))
+      ok(after.regprog_misses > before.regprog_misses)
+      ok(after.regprog_hits >= before.regprog_hits + 9)
+    end)
+
+    it('keeps matching after the cache is full', function()
+      local before = request('nvim__stats')
+      command('for i in range(100) | call match("x" . i, "x" . i . "$") | endfor')
+      local after = request('nvim__stats')
+      ok(after.regprog_evictions > before.regprog_evictions)
+      eq(0, eval('match("x42", "x42$")'))
+    end)
+  end)
+
 end)
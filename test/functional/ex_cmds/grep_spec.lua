@@ -1,6 +1,7 @@
 local helpers = require('test.functional.helpers')(after_each)
 local clear, feed_command, feed, ok, eval =
   helpers.clear, helpers.feed_command, helpers.feed, helpers.ok, helpers.eval
+local command, eq = helpers.command, helpers.eq
 
 describe(':grep', function()
   before_each(clear)
@@ -19,3 +20,76 @@ describe(':grep', function()
     ok(eval('len(getqflist())') > 9000)  -- IT'S OVER 9000!!1
   end)
 end)
+
+describe(':vimgrep', function()
+  local files = {
+    'Xvimgrep/one.txt', 'Xvimgrep/dos.txt', 'Xvimgrep/latin1.txt',
+    'Xvimgrep/nul.txt', 'Xvimgrep/loaded.txt',
+  }
+
+  before_each(function()
+    clear()
+    helpers.mkdir('Xvimgrep')
+    helpers.write_file(files[1], 'foo bar\nno\nbar foo foo\n')
+    helpers.write_file(files[2], 'foo\r\nxx foo\r\n')
+    helpers.write_file(files[3], 'caf\233 foo\n')
+    helpers.write_file(files[4], 'a\0foo\nfoo')
+    helpers.write_file(files[5], 'nothing\n')
+  end)
+
+  after_each(function()
+    helpers.rmdir('Xvimgrep')
+  end)
+
+  local function entries()
+    return eval([[map(getqflist(), ]]
+                ..[['[bufname(v:val.bufnr), v:val.lnum, v:val.col, v:val.text]')]])
+  end
+
+  it('finds matches in files that are not loaded', function()
+    -- A loaded buffer is searched with its changes.
+    command('set hidden')
+    command('edit Xvimgrep/loaded.txt | call setline(1, "foo loaded") | enew')
+    command('vimgrep /foo/gj Xvimgrep/*.txt')
+    eq({
+      {'Xvimgrep/dos.txt', 1, 1, 'foo'},
+      {'Xvimgrep/dos.txt', 2, 4, 'xx foo'},
+      {'Xvimgrep/latin1.txt', 1, 7, 'café foo'},
+      {'Xvimgrep/loaded.txt', 1, 1, 'foo loaded'},
+      {'Xvimgrep/nul.txt', 1, 3, 'a\nfoo'},
+      {'Xvimgrep/nul.txt', 2, 1, 'foo'},
+      {'Xvimgrep/one.txt', 1, 1, 'foo bar'},
+      {'Xvimgrep/one.txt', 3, 5, 'bar foo foo'},
+      {'Xvimgrep/one.txt', 3, 9, 'bar foo foo'},
+    }, entries())
+  end)
+
+  it('obeys the count and word boundaries', function()
+    command('2vimgrep /\\<foo\\>/gj Xvimgrep/dos.txt Xvimgrep/one.txt')
+    eq({
+      {'Xvimgrep/dos.txt', 1, 1, 'foo'},
+      {'Xvimgrep/dos.txt', 2, 4, 'xx foo'},
+    }, entries())
+  end)
+
+  it('uses the global iskeyword, like a buffer a file is loaded in', function()
+    helpers.write_file('Xvimgrep/isk.txt', 'foo-bar bar\n')
+    command('setlocal iskeyword+=-')
+    local expected = {
+      {'Xvimgrep/isk.txt', 1, 5, 'foo-bar bar'},
+      {'Xvimgrep/isk.txt', 1, 9, 'foo-bar bar'},
+    }
+    command('vimgrep /\\<bar\\>/gj Xvimgrep/isk.txt')
+    eq(expected, entries())
+    -- "\%>0l" makes it load the file in a buffer.
+    command('vimgrep /\\%>0l\\<bar\\>/gj Xvimgrep/isk.txt')
+    eq(expected, entries())
+  end)
+
+  it('uses a buffer for patterns that depend on it', function()
+    command('vimgrep /\\%3lfoo/j Xvimgrep/one.txt')
+    eq({{'Xvimgrep/one.txt', 3, 5, 'bar foo foo'}}, entries())
+    command('vimgrep /no\\nbar/j Xvimgrep/one.txt')
+    eq({{'Xvimgrep/one.txt', 2, 1, 'no'}}, entries())
+  end)
+end)
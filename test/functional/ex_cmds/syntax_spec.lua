@@ -1,8 +1,13 @@
 local helpers = require('test.functional.helpers')(after_each)
 
 local eq = helpers.eq
+local ok = helpers.ok
 local clear = helpers.clear
+local command = helpers.command
+local eval = helpers.eval
 local exc_exec = helpers.exc_exec
+local request = helpers.request
+local retry = helpers.retry
 
 describe(':syntax', function()
   before_each(clear)
@@ -14,4 +19,21 @@ describe(':syntax', function()
          exc_exec('syntax keyword \024 foo bar'))
     end)
   end)
+
+  describe('states', function()
+    it('are computed for lines outside the window while waiting for input',
+    function()
+      local before = request('nvim__stats').syn_idle_lines
+      command('call setline(1, ["/*"] + repeat(["text"], 3000) + ["*/"])')
+      command([[syntax region Comment start=/\/\*/ end=/\*\//]])
+      command('syntax sync fromstart')
+      command('redraw')
+      -- Lines from the one below the window to the last one.
+      local below = eval('line("$") - line("w$")')
+      retry(nil, 10000, function()
+        local lines = request('nvim__stats').syn_idle_lines - before
+        ok(lines >= below)
+      end)
+    end)
+  end)
 end)
@@ -0,0 +1,52 @@
+local helpers = require('test.functional.helpers')(after_each)
+
+local eq = helpers.eq
+local eval = helpers.eval
+local clear = helpers.clear
+local command = helpers.command
+
+describe('virtual columns in a long line', function()
+  before_each(function()
+    clear()
+    -- Every "ab<Tab>" takes 8 screen cells.
+    command('call setline(1, repeat("ab\\t", 5000))')
+    command('set nowrap')
+  end)
+
+  local function virtcol_at(col)
+    command('call cursor(1, '..col..')')
+    return eval('virtcol(".")')
+  end
+
+  it('are computed after the start of the line', function()
+    eq(24001, virtcol_at(9001))
+    eq(24001, virtcol_at(9001))
+    eq(8, virtcol_at(3))
+    command('normal! 20001|')
+    eq(7501, eval('col(".")'))
+    eq(24001, virtcol_at(9001))
+  end)
+
+  it('follow changes of the line', function()
+    eq(40000, virtcol_at(15000))
+    command('call cursor(1, 4)')
+    command('execute "normal! i\\t"')
+    eq(24009, virtcol_at(9002))
+    command('normal! 20009|')
+    eq(7502, eval('col(".")'))
+    command('undo')
+    eq(24001, virtcol_at(9001))
+    eq(40000, virtcol_at(15000))
+    command('call cursor(1, 12001)')
+    command('normal! 8ix')
+    eq(24001, virtcol_at(9001))
+    eq(34665, virtcol_at(13005))
+  end)
+
+  it('follow changes of lines above', function()
+    eq(24001, virtcol_at(9001))
+    command('call append(0, "first")')
+    command('call cursor(2, 9001)')
+    eq(24001, eval('virtcol(".")'))
+  end)
+end)
@@ -61,8 +61,8 @@ describe(':set validation', function()
     should_fail('timeoutlen', -1, 'E487')
     should_fail('history', 1000000, 'E474')
     should_fail('regexpengine', -1, 'E474')
-    should_fail('regexpengine', 3, 'E474')
-    should_succeed('regexpengine', 2)
+    should_fail('regexpengine', 4, 'E474')
+    should_succeed('regexpengine', 3)
     should_fail('report', -1, 'E487')
     should_succeed('report', 0)
     should_fail('scrolloff', -1, 'E49')
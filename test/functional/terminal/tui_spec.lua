@@ -202,6 +202,21 @@ describe('tui', function()
     ]])
   end)
 
+  it('draws the final state after a flood of redraws', function()
+    screen.timeout = 60000
+    feed_data(':for i in range(1, 3000) | call append(0, "line ".i)'
+              ..' | redraw | endfor\n')
+    screen:expect([[
+      {1:l}ine 3000                                         |
+      line 2999                                         |
+      line 2998                                         |
+      line 2997                                         |
+      {5:[No Name] [+]                                     }|
+                                                        |
+      {3:-- TERMINAL --}                                    |
+    ]])
+  end)
+
   it('allows termguicolors to be set at runtime', function()
     screen:set_option('rgb', true)
     screen:set_default_attr_ids({
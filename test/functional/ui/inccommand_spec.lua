@@ -1261,6 +1261,52 @@ describe("inccommand=nosplit", function()
     ]])
   end)
 
+  it('previews a pattern that gets longer or shorter', function()
+    feed(":%s/tw")
+    screen:expect{any=[[{12:tw}o lines]]}
+    feed("o l")
+    screen:expect{any=[[{12:two l}ines]]}
+    feed("x")
+    screen:expect([[
+      Inc substitution on |
+      two lines           |
+      Inc substitution on |
+      two lines           |
+                          |
+      {15:~                   }|
+      {15:~                   }|
+      {15:~                   }|
+      {15:~                   }|
+      :%s/two lx^          |
+    ]])
+    feed("<bs><bs><bs><bs><bs>")
+    screen:expect([[
+      Inc subs{12:t}itution on |
+      {12:t}wo lines           |
+      Inc subs{12:t}itution on |
+      {12:t}wo lines           |
+                          |
+      {15:~                   }|
+      {15:~                   }|
+      {15:~                   }|
+      {15:~                   }|
+      :%s/t^               |
+    ]])
+    feed("i")
+    screen:expect([[
+      Inc subs{12:ti}tution on |
+      two lines           |
+      Inc subs{12:ti}tution on |
+      two lines           |
+                          |
+      {15:~                   }|
+      {15:~                   }|
+      {15:~                   }|
+      {15:~                   }|
+      :%s/ti^              |
+    ]])
+  end)
+
   it('never shows preview buffer', function()
     feed_command("set hlsearch")
 
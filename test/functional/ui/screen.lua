@@ -71,6 +71,7 @@
 -- To help write screen tests, see Screen:snapshot_util().
 -- To debug screen tests, see Screen:redraw_debug().
 
+local mpack = require('mpack')
 local global_helpers = require('test.helpers')
 local shallowcopy = global_helpers.shallowcopy
 local helpers = require('test.functional.helpers')(nil)
@@ -613,6 +614,17 @@ end
 
 function Screen:_handle_grid_line(grid, row, col, items)
   assert(grid == 1)
+  if type(items) == 'string' then
+    -- packed_lines: a stream of msgpack-encoded cells
+    local unpacker = mpack.Unpacker()
+    local packed, pos = items, 1
+    items = {}
+    while pos <= #packed do
+      local item
+      item, pos = unpacker(packed, pos)
+      table.insert(items, item)
+    end
+  end
   local line = self._rows[row+1]
   local colpos = col+1
   local hl = self._clear_attrs
@@ -633,6 +645,51 @@ function Screen:_handle_grid_line(grid, row, col, items)
   end
 end
 
+function Screen:_handle_grid_shm(grid, path)
+  assert(grid == 1)
+  self._shm_path = path
+  self._shm_pending = {}
+end
+
+local function shm_u32(data, pos)
+  local b1, b2, b3, b4 = string.byte(data, pos, pos+3)
+  return b1 + b2*256 + b3*65536 + b4*16777216
+end
+
+function Screen:_handle_grid_dirty(grid, top, bot, left, right)
+  assert(grid == 1)
+  table.insert(self._shm_pending, {top, bot, left, right})
+  local file = assert(io.open(self._shm_path, 'rb'))
+  local data = file:read('*a')
+  file:close()
+  -- header: magic, version, width, height, cell_size, seq (little-endian)
+  local width, cell_size = shm_u32(data, 9), shm_u32(data, 17)
+  local seq = shm_u32(data, 21)
+  file = assert(io.open(self._shm_path, 'rb'))
+  local header = file:read(32)
+  file:close()
+  if seq % 2 == 1 or shm_u32(header, 21) ~= seq then
+    -- nvim is already writing the next batch: retry with its grid_dirty
+    return
+  end
+  for _, rect in ipairs(self._shm_pending) do
+    for row = rect[1], rect[2]-1 do
+      for col = rect[3], rect[4]-1 do
+        local pos = 33 + (row*width + col)*cell_size
+        local text = string.sub(data, pos, pos+29)
+        text = string.sub(text, 1, (string.find(text, '\0', 1, true) or 31)-1)
+        local lo, hi = string.byte(data, pos+30, pos+31)
+        local hl_id = lo + hi*256
+        local cell = self._rows[row+1][col+1]
+        cell.text = text
+        cell.hl_id = hl_id
+        cell.attrs = hl_id == 0 and self._clear_attrs or self._attr_table[hl_id]
+      end
+    end
+  end
+  self._shm_pending = {}
+end
+
 function Screen:_handle_bell()
   self.bell = true
 end
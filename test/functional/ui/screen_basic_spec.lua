@@ -845,3 +845,98 @@ end)
 describe("Screen (line-based)", function()
   screen_tests(true)
 end)
+
+describe('Screen redraw of unchanged lines', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(30, 5)
+    screen:attach()
+    screen:set_default_attr_ids({
+      [1] = {bold = true, foreground = Screen.colors.Blue1},
+      [2] = {foreground = Screen.colors.Red},
+      [3] = {foreground = Screen.colors.Blue},
+      [4] = {foreground = Screen.colors.Brown},
+      [5] = {bold = true, foreground = Screen.colors.Brown},
+    })
+    insert([[
+      foo
+      bar
+      foo]])
+  end)
+
+  it('follows highlight changes', function()
+    command('syntax keyword Foo foo')
+    command('highlight Foo guifg=Red')
+    screen:expect([[
+      {2:foo}                           |
+      bar                           |
+      {2:fo^o}                           |
+      {1:~                             }|
+                                    |
+    ]])
+    command('highlight Foo guifg=Blue')
+    command('redraw!')
+    screen:expect([[
+      {3:foo}                           |
+      bar                           |
+      {3:fo^o}                           |
+      {1:~                             }|
+                                    |
+    ]])
+  end)
+
+  it('follows option changes', function()
+    command('redraw!')
+    command('set list listchars=eol:$')
+    screen:expect([[
+      foo{1:$}                          |
+      bar{1:$}                          |
+      fo^o{1:$}                          |
+      {1:~                             }|
+                                    |
+    ]])
+  end)
+
+  it('follows synmaxcol changes', function()
+    command('syntax keyword Foo foo')
+    command('highlight Foo guifg=Red')
+    command('call setline(1, "foo foo foo")')
+    feed('2G')
+    screen:expect([[
+      {2:foo} {2:foo} {2:foo}                   |
+      ^bar                           |
+      {2:foo}                           |
+      {1:~                             }|
+                                    |
+    ]])
+    command('setlocal synmaxcol=4')
+    screen:expect([[
+      {2:foo} foo foo                   |
+      ^bar                           |
+      {2:foo}                           |
+      {1:~                             }|
+                                    |
+    ]])
+  end)
+
+  it('follows the cursor with relativenumber', function()
+    command('set relativenumber')
+    screen:expect([[
+      {4:  2 }foo                       |
+      {4:  1 }bar                       |
+      {5:  0 }fo^o                       |
+      {1:~                             }|
+                                    |
+    ]])
+    feed('gg')
+    screen:expect([[
+      {5:  0 }^foo                       |
+      {4:  1 }bar                       |
+      {4:  2 }foo                       |
+      {1:~                             }|
+                                    |
+    ]])
+  end)
+end)
@@ -402,6 +402,147 @@ describe('search highlighting', function()
     ]])
   end)
 
+  it('finds the match for a longer pattern with incsearch', function()
+    feed_command('set nohlsearch')
+    feed_command('set incsearch')
+    insert([[
+      foo bar
+      foo baz
+      food]])
+
+    feed("gg/fo")
+    screen:expect([[
+      foo bar                                 |
+      {3:fo}o baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /fo^                                     |
+    ]])
+
+    feed("od")
+    screen:expect([[
+      foo bar                                 |
+      foo baz                                 |
+      {3:food}                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /food^                                   |
+    ]])
+
+    feed("<bs>")
+    screen:expect([[
+      foo bar                                 |
+      {3:foo} baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /foo^                                    |
+    ]])
+
+    feed(" bar")
+    screen:expect([[
+      {3:foo bar}                                 |
+      foo baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /foo bar^                                |
+    ]])
+
+    feed("x")
+    screen:expect([[
+      foo bar                                 |
+      foo baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /foo barx^                               |
+    ]])
+
+    feed("<bs><cr>")
+    screen:expect([[
+      ^foo bar                                 |
+      foo baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /foo bar                                |
+    ]])
+  end)
+
+  it('highlights a longer pattern when the shorter one had no match', function()
+    feed_command('set hlsearch incsearch')
+    insert([[
+      foo bar
+      foo baz
+      food]])
+
+    feed('gg/bar<cr>')
+    screen:expect([[
+      foo {2:^bar}                                 |
+      foo baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /bar                                    |
+    ]])
+
+    feed('/zz')
+    screen:expect([[
+      foo bar                                 |
+      foo baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /zz^                                     |
+    ]])
+
+    feed('q')
+    screen:expect([[
+      foo bar                                 |
+      foo baz                                 |
+      food                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /zzq^                                    |
+    ]])
+
+    -- no match after the cursor with 'nowrapscan'
+    feed('<esc>')
+    command('set nowrapscan')
+    feed('G$/foo')
+    screen:expect([[
+      {2:foo} bar                                 |
+      {2:foo} baz                                 |
+      {2:foo}d                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /foo^                                    |
+    ]])
+
+    feed('d')
+    screen:expect([[
+      foo bar                                 |
+      foo baz                                 |
+      {2:food}                                    |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /food^                                   |
+    ]])
+  end)
+
   it('works with multiline regexps', function()
     feed_command('set hlsearch')
     feed('4oa  repeated line<esc>')
@@ -487,5 +628,68 @@ describe('search highlighting', function()
     ]])
 
   end)
+
+  it('is updated when the text or the meaning of the pattern changes',
+  function()
+    insert('foo-bar\nfoo bar')
+    feed('gg/\\<foo\\><cr>')
+    screen:expect([[
+      {2:foo}-bar                                 |
+      {2:^foo} bar                                 |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /\<foo\>                                |
+    ]])
+
+    command('setlocal iskeyword+=-')
+    feed('<C-L>')
+    screen:expect([[
+      foo-bar                                 |
+      {2:^foo} bar                                 |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+
+    command('call setline(2, "food bar")')
+    screen:expect([[
+      foo-bar                                 |
+      ^food bar                                |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+  end)
+
+  it('follows the cursor with a pattern using \\%#', function()
+    insert('foo bar baz')
+    command([[call matchadd('Search', '\%#\w\+')]])
+    feed('0')
+    screen:expect([[
+      {2:^foo} bar baz                             |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+    feed('w')
+    screen:expect([[
+      foo {2:^bar} baz                             |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+  end)
 end)
 
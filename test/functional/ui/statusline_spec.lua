@@ -0,0 +1,113 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command, feed = helpers.clear, helpers.command, helpers.feed
+local eq, eval, source = helpers.eq, helpers.eval, helpers.source
+local read_file = helpers.read_file
+
+describe('statusline %{} item', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 4)
+    screen:attach()
+    screen:set_default_attr_ids({
+      [1] = {bold = true, foreground = Screen.colors.Blue1},
+      [2] = {bold = true, reverse = true},
+    })
+    source([[
+      let g:calls = 0
+      let g:text = 'one'
+      function! Item()
+        let g:calls += 1
+        return g:text
+      endfunction
+      set laststatus=2 statusline=%{Item()}
+    ]])
+    screen:expect([[
+      ^                    |
+      {1:~                   }|
+      {2:one                 }|
+                          |
+    ]])
+  end)
+
+  after_each(function()
+    os.remove('Xstl_profile')
+    helpers.rmdir('Xstl_dir')
+  end)
+
+  it('is not evaluated again when nothing changed', function()
+    local calls = eval('g:calls')
+    command('redraw!')
+    eq(calls, eval('g:calls'))
+  end)
+
+  it('is evaluated again after a variable is set', function()
+    local calls = eval('g:calls')
+    command('let g:text = "two"')
+    command('redraw!')
+    eq(calls + 1, eval('g:calls'))
+    screen:expect([[
+      ^                    |
+      {1:~                   }|
+      {2:two                 }|
+                          |
+    ]])
+  end)
+
+  it('is evaluated again after a change of the buffer', function()
+    local calls = eval('g:calls')
+    feed('ix<esc>')
+    screen:expect([[
+      ^x                   |
+      {1:~                   }|
+      {2:one                 }|
+                          |
+    ]])
+    eq(true, eval('g:calls') > calls)
+  end)
+
+  it('is evaluated again by :redrawstatus', function()
+    local calls = eval('g:calls')
+    command('redrawstatus')
+    eq(calls + 1, eval('g:calls'))
+  end)
+
+  it('is evaluated again after the directory changed', function()
+    helpers.mkdir('Xstl_dir')
+    command([[set statusline=%{getcwd()=~#'Xstl_dir$'?'in':'out'}]])
+    screen:expect([[
+      ^                    |
+      {1:~                   }|
+      {2:out                 }|
+                          |
+    ]])
+    for _, cd in ipairs({'cd', 'lcd', 'tcd'}) do
+      command(cd..' Xstl_dir')
+      screen:expect([[
+        ^                    |
+        {1:~                   }|
+        {2:in                  }|
+                            |
+      ]])
+      command(cd..' ..')
+      screen:expect([[
+        ^                    |
+        {1:~                   }|
+        {2:out                 }|
+                            |
+      ]])
+    end
+  end)
+
+  it('is profiled', function()
+    command('profile start Xstl_profile')
+    command('redrawstatus')
+    command('redraw!')
+    command('profile dump')
+    local profile = read_file('Xstl_profile')
+    eq(true, profile:find('STATUSLINE ITEMS SORTED ON TOTAL TIME', 1, true) ~= nil)
+    eq(true, profile:find('%d+      1 [ 0-9.]+  %%{Item%(%)}') ~= nil)
+  end)
+end)
@@ -17,3 +17,35 @@ const char *ut_multiqueue_get(MultiQueue *this)
   Event event = multiqueue_get(this);
   return event.argv[0];
 }
+
+static void ut_multiqueue_count(void **argv)
+{
+  (*(size_t *)argv[0])++;
+}
+
+/// Simulates a job-output flood: `rounds` times, pushes `batch` events spread
+/// over `nchildren` child queues of a fresh parent, then drains the parent.
+///
+/// @return number of events processed.
+size_t ut_multiqueue_flood(size_t nchildren, size_t rounds, size_t batch)
+{
+  size_t processed = 0;
+  MultiQueue *parent = multiqueue_new_parent(NULL, NULL);
+  MultiQueue **children = malloc(nchildren * sizeof(MultiQueue *));
+  for (size_t i = 0; i < nchildren; i++) {
+    children[i] = multiqueue_new_child(parent);
+  }
+  for (size_t r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < batch; i++) {
+      multiqueue_put(children[i % nchildren], ut_multiqueue_count, 1,
+                     &processed);
+    }
+    multiqueue_process_events(parent);
+  }
+  for (size_t i = 0; i < nchildren; i++) {
+    multiqueue_free(children[i]);
+  }
+  multiqueue_free(parent);
+  free(children);
+  return processed;
+}
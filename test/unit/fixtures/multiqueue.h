@@ -2,3 +2,4 @@
 
 void ut_multiqueue_put(MultiQueue *queue, const char *str);
 const char *ut_multiqueue_get(MultiQueue *queue);
+size_t ut_multiqueue_flood(size_t nchildren, size_t rounds, size_t batch);
@@ -0,0 +1,35 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <stdbool.h>
+#include <string.h>
+#include "nvim/event/spscqueue.h"
+#include "spscqueue.h"
+
+static char drained[4096];
+
+static void ut_spscqueue_append(void **argv)
+{
+  strcat(drained, argv[0]);
+}
+
+/// Queues a copy of `str` inside the queue, unpublished.
+bool ut_spscqueue_push(SPSCQueue *q, const char *str)
+{
+  void *payload;
+  Event *event = spscqueue_reserve(q, strlen(str) + 1, &payload);
+  if (!event) {
+    return false;
+  }
+  strcpy(payload, str);
+  *event = event_create(ut_spscqueue_append, 1, payload);
+  return true;
+}
+
+/// Processes published events, returns the concatenation of their strings.
+const char *ut_spscqueue_drain(SPSCQueue *q)
+{
+  drained[0] = 0;
+  spscqueue_process(q);
+  return drained;
+}
@@ -0,0 +1,4 @@
+#include "nvim/event/spscqueue.h"
+
+bool ut_spscqueue_push(SPSCQueue *q, const char *str);
+const char *ut_spscqueue_drain(SPSCQueue *q);
@@ -0,0 +1,31 @@
+-- Microbenchmark for the multiqueue: measures events per second while a few
+-- child queues (jobs/channels) flood their parent (the event loop queue).
+
+local helpers = require("test.unit.helpers")(after_each)
+local itp = helpers.gen_itp(it)
+
+local cimport = helpers.cimport
+local eq = helpers.eq
+
+local multiqueue = cimport("./test/unit/fixtures/multiqueue.h")
+
+describe("multiqueue benchmark", function()
+  local function flood(nchildren, rounds, batch)
+    local start = os.clock()
+    local processed = tonumber(multiqueue.ut_multiqueue_flood(nchildren,
+                                                              rounds, batch))
+    local elapsed = os.clock() - start
+    eq(rounds * batch, processed)
+    print(string.format(
+      '\nmultiqueue flood: %d children, %d x %d events: %.0f events/s',
+      nchildren, rounds, batch, processed / math.max(elapsed, 1e-9)))
+  end
+
+  itp('job-output flood with small batches', function()
+    flood(4, 20000, 16)
+  end)
+
+  itp('job-output flood with large batches', function()
+    flood(4, 50, 10000)
+  end)
+end)
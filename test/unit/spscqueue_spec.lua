@@ -0,0 +1,71 @@
+local helpers = require("test.unit.helpers")(after_each)
+local itp = helpers.gen_itp(it)
+
+local ffi = helpers.ffi
+local eq = helpers.eq
+local child_call_once = helpers.child_call_once
+local child_cleanup_once = helpers.child_cleanup_once
+
+local spscqueue = helpers.cimport("./test/unit/fixtures/spscqueue.h")
+
+describe('spscqueue', function()
+  -- Small enough to make records wrap around after a few pushes.
+  local capacity = 1024
+  local q
+
+  local function push(str)
+    return spscqueue.ut_spscqueue_push(q, str)
+  end
+
+  local function drain()
+    return ffi.string(spscqueue.ut_spscqueue_drain(q))
+  end
+
+  before_each(function()
+    child_call_once(function()
+      q = ffi.new('SPSCQueue[1]')
+      spscqueue.spscqueue_init(q, capacity)
+    end)
+    child_cleanup_once(function()
+      spscqueue.spscqueue_destroy(q)
+    end)
+  end)
+
+  itp('does not run events before they are published', function()
+    eq(true, push('a'))
+    eq(true, push('b'))
+    eq('', drain())
+    eq(true, spscqueue.spscqueue_publish(q))
+    eq('ab', drain())
+    eq('', drain())
+  end)
+
+  itp('requests a single wakeup per drain', function()
+    push('a')
+    eq(true, spscqueue.spscqueue_publish(q))
+    push('b')
+    eq(false, spscqueue.spscqueue_publish(q))
+    eq('ab', drain())
+    push('c')
+    eq(true, spscqueue.spscqueue_publish(q))
+    eq('c', drain())
+  end)
+
+  itp('reports full and keeps order across wrap-around', function()
+    local payload = string.rep('x', 200)
+    local pushed = 0
+    while push(payload) do
+      pushed = pushed + 1
+    end
+    assert(pushed > 0)
+    eq(false, spscqueue.spscqueue_has_room(q, #payload + 1))
+    spscqueue.spscqueue_publish(q)
+    eq(string.rep(payload, pushed), drain())
+    for i = 1, 20 do
+      eq(true, push(tostring(i)))
+      eq(true, push(payload))
+      spscqueue.spscqueue_publish(q)
+      eq(tostring(i) .. payload, drain())
+    end
+  end)
+end)